@@ -0,0 +1,229 @@
+#include "defs.h"
+#include <sys/mman.h>
+
+/* The block the calling thread allocates from without the lock, and the arena epoch it was
+   carved in. Epochs are unique across arenas, so a block never outlives its arena's reset. */
+typedef struct RunArenaBlockType {
+    uint64_t epoch;
+    uintptr_t cursor;
+    uintptr_t end;
+} RunArenaBlockType;
+
+static _Thread_local RunArenaBlockType arenaBlock;
+static atomic_uint_fast64_t arenaEpochs = 1;
+
+/************************************************************************************************
+ * Function: uintptr_t alignUp(uintptr_t address, size_t align)
+ * Description: This function rounds an address up to a power-of-two alignment.
+ * Parameters:
+ *      - uintptr_t address: The address.
+ *      - size_t align: The alignment.
+ * Return: The aligned address.
+ ************************************************************************************************/
+static uintptr_t alignUp(uintptr_t address, size_t align) {
+    return (address + align - 1) & ~(uintptr_t)(align - 1);
+}
+
+/************************************************************************************************
+ * Function: uintptr_t chunkData(RunArenaChunkType *chunk)
+ * Description: This function gives where the usable bytes of a chunk start, a cache line past
+ *              its header.
+ * Parameters:
+ *      - RunArenaChunkType *chunk: The chunk.
+ * Return: The address of its first usable byte.
+ ************************************************************************************************/
+static uintptr_t chunkData(RunArenaChunkType *chunk) {
+    return (uintptr_t)chunk + CACHE_LINE;
+}
+
+/************************************************************************************************
+ * Function: void initRunArena(RunArenaType *arena)
+ * Description: This function creates an empty arena. Chunks are mapped as runs need them.
+ * Parameters:
+ *      - RunArenaType *arena: The arena.
+ * Return: None
+ ************************************************************************************************/
+void initRunArena(RunArenaType *arena) {
+    pthread_mutex_init(&arena->lock, NULL);
+    arena->chunks = arena->last = arena->current = NULL;
+    arena->used = 0;
+    arena->reserved = 0;
+    arena->epoch = atomic_fetch_add(&arenaEpochs, 1);
+    arena->carveDirect = C_FALSE;
+}
+
+/************************************************************************************************
+ * Function: void *carveArena(RunArenaType *arena, size_t size, size_t align)
+ * Description: This function takes bytes from the arena's current chunk under its lock, moving
+ *              on to the next chunk kept from earlier runs, or mapping a new one as large as
+ *              everything mapped so far, when it is full.
+ * Parameters:
+ *      - RunArenaType *arena: The arena.
+ *      - size_t size: How many bytes.
+ *      - size_t align: Their alignment, a power of two no larger than a page.
+ * Return: The bytes.
+ ************************************************************************************************/
+static void *carveArena(RunArenaType *arena, size_t size, size_t align) {
+    pthread_mutex_lock(&arena->lock);
+
+    for (;;) {
+        RunArenaChunkType *chunk = arena->current;
+
+        if (chunk != NULL) {
+            uintptr_t start = alignUp(chunkData(chunk) + arena->used, align);
+            if (start + size <= chunkData(chunk) + chunk->size) {
+                arena->used = start + size - chunkData(chunk);
+                pthread_mutex_unlock(&arena->lock);
+                return (void *)start;
+            }
+            if (chunk->next != NULL) {
+                arena->current = chunk->next;
+                arena->used = 0;
+                continue;
+            }
+        }
+
+        size_t chunkSize = (arena->reserved > RUN_ARENA_CHUNK_SIZE) ? arena->reserved : RUN_ARENA_CHUNK_SIZE;
+        if (chunkSize < size + align) {
+            chunkSize = alignUp(size + align, RUN_ARENA_CHUNK_SIZE);
+        }
+
+        RunArenaChunkType *grown = mmap(NULL, chunkSize + CACHE_LINE, PROT_READ | PROT_WRITE,
+                                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (grown == MAP_FAILED) {
+            perror("Failed to grow run arena");
+            exit(EXIT_FAILURE);
+        }
+
+        grown->next = NULL;
+        grown->size = chunkSize;
+        if (arena->last != NULL) {
+            arena->last->next = grown;
+        } else {
+            arena->chunks = grown;
+        }
+        arena->last = grown;
+        arena->current = grown;
+        arena->used = 0;
+        arena->reserved += chunkSize;
+    }
+}
+
+/************************************************************************************************
+ * Function: void *arenaAlloc(RunArenaType *arena, size_t size, size_t align)
+ * Description: This function allocates from a run arena. Small allocations bump the calling
+ *              thread's block, which takes no lock; the block is refilled from the arena when it
+ *              runs out or belongs to an older epoch. Large ones, and every one from a
+ *              carveDirect arena, are carved directly. The bytes are not cleared and stay
+ *              allocated until the arena is reset.
+ * Parameters:
+ *      - RunArenaType *arena: The arena.
+ *      - size_t size: How many bytes.
+ *      - size_t align: Their alignment, a power of two no larger than a page.
+ * Return: The bytes.
+ ************************************************************************************************/
+void *arenaAlloc(RunArenaType *arena, size_t size, size_t align) {
+    if (arena->carveDirect) {
+        return carveArena(arena, size, align);
+    }
+
+    uintptr_t start = alignUp(arenaBlock.cursor, align);
+
+    if (arenaBlock.epoch == arena->epoch && start + size <= arenaBlock.end) {
+        arenaBlock.cursor = start + size;
+        return (void *)start;
+    }
+
+    if (size + align > RUN_ARENA_BLOCK_SIZE / 4) {
+        return carveArena(arena, size, align);
+    }
+
+    arenaBlock.cursor = (uintptr_t)carveArena(arena, RUN_ARENA_BLOCK_SIZE, CACHE_LINE);
+    arenaBlock.end = arenaBlock.cursor + RUN_ARENA_BLOCK_SIZE;
+    arenaBlock.epoch = arena->epoch;
+
+    start = alignUp(arenaBlock.cursor, align);
+    arenaBlock.cursor = start + size;
+    return (void *)start;
+}
+
+/************************************************************************************************
+ * Function: void *arenaGrow(RunArenaType *arena, void *old, size_t oldSize, size_t size, size_t align)
+ * Description: This function is realloc for arrays living in an arena: the contents move to a
+ *              new allocation and the old one is left for the next reset, so callers should grow
+ *              geometrically.
+ * Parameters:
+ *      - RunArenaType *arena: The arena.
+ *      - void *old: The array, or NULL.
+ *      - size_t oldSize: Its size in bytes.
+ *      - size_t size: The size it needs.
+ *      - size_t align: Its alignment.
+ * Return: The grown array.
+ ************************************************************************************************/
+void *arenaGrow(RunArenaType *arena, void *old, size_t oldSize, size_t size, size_t align) {
+    void *grown = arenaAlloc(arena, size, align);
+
+    if (old != NULL) {
+        memcpy(grown, old, (oldSize < size) ? oldSize : size);
+    }
+    return grown;
+}
+
+/************************************************************************************************
+ * Function: void resetRunArena(RunArenaType *arena)
+ * Description: This function gives back everything allocated from the arena in O(1): the next
+ *              allocation starts again at the beginning of its first chunk, and blocks threads
+ *              still hold are invalidated by the new epoch. The chunks stay mapped (and their
+ *              pages committed) for the next run. No thread may be allocating from it.
+ * Parameters:
+ *      - RunArenaType *arena: The arena.
+ * Return: None
+ ************************************************************************************************/
+void resetRunArena(RunArenaType *arena) {
+    arena->current = arena->chunks;
+    arena->used = 0;
+    arena->epoch = atomic_fetch_add(&arenaEpochs, 1);
+}
+
+/************************************************************************************************
+ * Function: void sealRunArena(RunArenaType *arena)
+ * Description: This function makes everything allocated from the arena read-only, for data built
+ *              once and then shared by every run (the house topology). A stray write faults
+ *              instead of corrupting another run, and forked workers keep sharing the pages.
+ *              Nothing may be allocated from the arena afterwards.
+ * Parameters:
+ *      - RunArenaType *arena: The arena.
+ * Return: None
+ ************************************************************************************************/
+void sealRunArena(RunArenaType *arena) {
+    for (RunArenaChunkType *chunk = arena->chunks; chunk != NULL; chunk = chunk->next) {
+        if (mprotect(chunk, chunk->size + CACHE_LINE, PROT_READ) != 0) {
+            perror("Failed to seal arena");
+        }
+    }
+
+    // Blocks still open on this thread must not be bumped into the sealed pages
+    arena->epoch = atomic_fetch_add(&arenaEpochs, 1);
+}
+
+/************************************************************************************************
+ * Function: void releaseRunArena(RunArenaType *arena)
+ * Description: This function unmaps every chunk of the arena once its worker is done with it.
+ * Parameters:
+ *      - RunArenaType *arena: The arena.
+ * Return: None
+ ************************************************************************************************/
+void releaseRunArena(RunArenaType *arena) {
+    RunArenaChunkType *chunk = arena->chunks;
+
+    while (chunk != NULL) {
+        RunArenaChunkType *next = chunk->next;
+        munmap(chunk, chunk->size + CACHE_LINE);
+        chunk = next;
+    }
+
+    resetRunArena(arena);
+    arena->chunks = arena->last = arena->current = NULL;
+    arena->reserved = 0;
+    pthread_mutex_destroy(&arena->lock);
+}
@@ -0,0 +1,275 @@
+#include "defs.h"
+#include <stdarg.h>
+
+/* Agent turns hold this shared; a sampled check or a checkpoint holds it exclusively, so it sees
+   the house between turns. */
+static pthread_rwlock_t checkLock = PTHREAD_RWLOCK_WRITER_NONRECURSIVE_INITIALIZER_NP;
+static atomic_ullong checkedTurns = 0;
+
+/************************************************************************************************
+ * Function: void reportViolation(const char *where, const char *format, ...)
+ * Description: This function reports the first invariant found broken and stops the program.
+ * Parameters:
+ *      - const char *where: When the check ran.
+ *      - const char *format: The printf style description of the violation.
+ *      - ...: The format arguments.
+ * Return: None (does not return)
+ ************************************************************************************************/
+static void reportViolation(const char *where, const char *format, ...) {
+    va_list args;
+
+    fflush(stdout);
+    fprintf(stderr, "[CHECK] Invariant violated %s: ", where);
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fprintf(stderr, "\n");
+    exit(EXIT_FAILURE);
+}
+
+/************************************************************************************************
+ * Function: void checkEvidenceList(const GhostEvidenceListType *list, const char *owner, const char *where)
+ * Description: This function checks that a hunter's evidence list ends (no cycle), that its tail
+ *              is its last node and that every piece of evidence has a valid type.
+ * Parameters:
+ *      - const GhostEvidenceListType *list: The list.
+ *      - const char *owner: The hunter owning it, for the report.
+ *      - const char *where: When the check ran.
+ * Return: None
+ ************************************************************************************************/
+static void checkEvidenceList(const GhostEvidenceListType *list, const char *owner, const char *where) {
+    const EvidenceNodeType *slow = list->head;
+    const EvidenceNodeType *fast = list->head;
+
+    while (fast != NULL && fast->next != NULL) {
+        slow = slow->next;
+        fast = fast->next->next;
+        if (slow == fast) {
+            reportViolation(where, "the evidence list of [%s] loops", owner);
+        }
+    }
+
+    const EvidenceNodeType *last = NULL;
+    int length = 0;
+
+    for (const EvidenceNodeType *node = list->head; node != NULL; node = node->next, length++) {
+        if (node->data == NULL || (unsigned)node->data->evidenceType >= EVIDENCE_TYPES) {
+            reportViolation(where, "evidence %d of [%s] has no valid type", length, owner);
+        }
+        last = node;
+    }
+
+    if (list->tail != last) {
+        reportViolation(where, "the evidence list of [%s] has %d nodes but its tail is not the last one", owner, length);
+    }
+}
+
+/************************************************************************************************
+ * Function: void checkEvidenceChannel(const EvidenceChannelType *channel, int type, const RoomType *room, const char *where)
+ * Description: This function checks that a room's evidence channel holds only evidence of the
+ *              channel's type, that the tail of its settled part is its last node and that its
+ *              count is the number of pieces it holds.
+ * Parameters:
+ *      - const EvidenceChannelType *channel: The channel.
+ *      - int type: The evidence type of the channel.
+ *      - const RoomType *room: The room, for the report.
+ *      - const char *where: When the check ran.
+ * Return: None
+ ************************************************************************************************/
+static void checkEvidenceChannel(const EvidenceChannelType *channel, int type, const RoomType *room, const char *where) {
+    const EvidenceChannelNodeType *last = NULL;
+    int held = 0;
+
+    for (const EvidenceChannelNodeType *node = channel->pending; node != NULL; node = node->next, held++) {
+        if ((int)node->evidence.evidenceType != type) {
+            reportViolation(where, "the [%s] channel of [%s] holds [%s] evidence", evidenceTypeToString(type),
+                            room->topology->name, evidenceTypeToString(node->evidence.evidenceType));
+        }
+        last = node;
+    }
+
+    if (channel->pendingTail != last) {
+        reportViolation(where, "the [%s] channel of [%s] has a tail that is not its last node", evidenceTypeToString(type), room->topology->name);
+    }
+
+    for (const EvidenceChannelNodeType *node = atomic_load((_Atomic(EvidenceChannelNodeType *) *)&channel->incoming); node != NULL; node = node->next) {
+        held++;
+    }
+
+    if (atomic_load((atomic_int *)&channel->count) != held) {
+        reportViolation(where, "the [%s] channel of [%s] counts %d pieces but holds %d", evidenceTypeToString(type),
+                        room->topology->name, atomic_load((atomic_int *)&channel->count), held);
+    }
+}
+
+/************************************************************************************************
+ * Function: void checkHouse(HouseType *house, const char *where)
+ * Description: This function validates the structural invariants of a house no agent is
+ *              changing: every hunter still hunting is listed in exactly one room, the one it is
+ *              in, and finished hunters in none; a room only points at the ghost if the ghost is
+ *              there (the ghost is not linked into its first room until it moves); evidence lists
+ *              and channels end at their tails; and the house's evidenceCollected counts every
+ *              piece a hunter collected beyond its second. The first violation stops the program.
+ * Parameters:
+ *      - HouseType *house: The house.
+ *      - const char *where: When the check runs, for the report.
+ * Return: None
+ ************************************************************************************************/
+void checkHouse(HouseType *house, const char *where) {
+    HunterListType *hunters = house->hunters;
+    GhostType *ghost = house->ghost;
+    int *listed = calloc(hunters->size + 1, sizeof(int));
+    int expectedTotal = 0;
+
+    if (listed == NULL) {
+        perror("Failed to allocate invariant check");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < hunters->size; i++) {
+        HunterType *hunter = hunters->hunterList[i];
+
+        if (hunter->id != i) {
+            reportViolation(where, "hunter %d of the house, [%s], has id %d", i, hunter->name, hunter->id);
+        }
+        checkEvidenceList(hunter->ghostEvidence, hunter->name, where);
+
+        if (hunter->evidenceCollected > 2) {
+            expectedTotal += hunter->evidenceCollected - 2;
+        }
+    }
+
+    for (int r = 0; r < house->roomCount; r++) {
+        RoomType *room = &house->rooms[r];
+
+        if (room->id != r) {
+            reportViolation(where, "room %d of the house, [%s], has id %d", r, room->topology->name, room->id);
+        }
+        if (room->hunterCount < 0 || room->hunterCount > MAX_HUNTERS) {
+            reportViolation(where, "[%s] lists %d hunters", room->topology->name, room->hunterCount);
+        }
+
+        for (int i = 0; i < room->hunterCount; i++) {
+            HunterType *hunter = room->hunters[i];
+
+            if (hunter == NULL || hunter->id < 0 || hunter->id >= hunters->size || hunters->hunterList[hunter->id] != hunter) {
+                reportViolation(where, "[%s] lists a hunter that is not in the house", room->topology->name);
+            }
+            if (hunter->room != room) {
+                reportViolation(where, "[%s] lists [%s], who is in [%s]", room->topology->name, hunter->name,
+                                hunter->room ? hunter->room->topology->name : "no room");
+            }
+            if (hunter->done) {
+                reportViolation(where, "[%s] still lists [%s], who finished", room->topology->name, hunter->name);
+            }
+            listed[hunter->id]++;
+        }
+
+        if (room->ghost != NULL && (room->ghost != ghost || ghost->room != room)) {
+            reportViolation(where, "[%s] points at the ghost, which is in [%s]", room->topology->name,
+                            ghost->room ? ghost->room->topology->name : "no room");
+        }
+
+        for (int type = 0; type < EVIDENCE_TYPES; type++) {
+            checkEvidenceChannel(&room->evidence[type], type, room, where);
+        }
+    }
+
+    for (int i = 0; i < hunters->size; i++) {
+        HunterType *hunter = hunters->hunterList[i];
+
+        if (listed[i] != (hunter->done ? 0 : 1)) {
+            reportViolation(where, "[%s] (%s) is listed in %d rooms", hunter->name,
+                            hunter->done ? "finished" : "hunting", listed[i]);
+        }
+    }
+
+    if (atomic_load(&house->evidenceCollected) != expectedTotal) {
+        reportViolation(where, "the house counts %d collections but the hunters' evidenceCollected add up to %d",
+                        atomic_load(&house->evidenceCollected), expectedTotal);
+    }
+
+    free(listed);
+}
+
+/************************************************************************************************
+ * Function: int turnsLocked(void)
+ * Description: This function tells whether agent turns take the check lock: with --check, and
+ *              with --checkpoint so the snapshot is taken between turns.
+ * Parameters: None
+ * Return: C_TRUE if they do, C_FALSE otherwise.
+ ************************************************************************************************/
+static int turnsLocked(void) {
+    return gameOptions.checkEvery > 0 || gameOptions.checkpointPath != NULL;
+}
+
+/************************************************************************************************
+ * Function: void enterCheckedTurn(void)
+ * Description: This function marks the start of an agent turn for the invariant checker and
+ *              checkpoints. It does nothing unless --check or --checkpoint is on.
+ * Parameters: None
+ * Return: None
+ ************************************************************************************************/
+void enterCheckedTurn(void) {
+    if (turnsLocked()) {
+        pthread_rwlock_rdlock(&checkLock);
+    }
+}
+
+/************************************************************************************************
+ * Function: void leaveCheckedTurn(HouseType *house, const char *agent)
+ * Description: This function marks the end of an agent turn and, on every --check'th turn of
+ *              the game, waits for the other agents to finish theirs and checks the house.
+ * Parameters:
+ *      - HouseType *house: The house.
+ *      - const char *agent: The agent whose turn ended, for the report.
+ * Return: None
+ ************************************************************************************************/
+void leaveCheckedTurn(HouseType *house, const char *agent) {
+    if (!turnsLocked()) {
+        return;
+    }
+
+    pthread_rwlock_unlock(&checkLock);
+
+    if (gameOptions.checkEvery <= 0) {
+        return;
+    }
+
+    unsigned long long turn = atomic_fetch_add_explicit(&checkedTurns, 1, memory_order_relaxed) + 1;
+    if (turn % (unsigned long long)gameOptions.checkEvery != 0) {
+        return;
+    }
+
+    char where[MAX_STR + 64];
+    snprintf(where, sizeof(where), "after turn %llu (%s)", turn, agent);
+
+    pthread_rwlock_wrlock(&checkLock);
+    checkHouse(house, where);
+    pthread_rwlock_unlock(&checkLock);
+}
+
+/************************************************************************************************
+ * Function: void pauseTurns(void)
+ * Description: This function waits until every agent is between turns and keeps new turns from
+ *              starting until resumeTurns. The caller must not be inside a turn of its own.
+ * Parameters: None
+ * Return: None
+ ************************************************************************************************/
+void pauseTurns(void) {
+    if (turnsLocked()) {
+        pthread_rwlock_wrlock(&checkLock);
+    }
+}
+
+/************************************************************************************************
+ * Function: void resumeTurns(void)
+ * Description: This function lets the turns held back by pauseTurns go on.
+ * Parameters: None
+ * Return: None
+ ************************************************************************************************/
+void resumeTurns(void) {
+    if (turnsLocked()) {
+        pthread_rwlock_unlock(&checkLock);
+    }
+}
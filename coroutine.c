@@ -0,0 +1,336 @@
+#include "defs.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+
+/* One agent of a coroutine-run house: its context, the thread body it runs, the house it plays
+   in and when it may run again. order breaks ties between agents due at the same time, first
+   come first served. sliced is set once its stack slice has been set up (and guarded). */
+typedef struct CoroutineType {
+    ucontext_t context;
+    void *(*body)(void *);
+    void *arg;
+    RngType *rng;
+    int house;
+    uint64_t wakeAt;
+    uint64_t order;
+    int finished;
+    int sliced;
+} CoroutineType;
+
+/* The scheduler: every agent not running is in the heap, earliest wakeAt first, whichever house
+   it plays in. The stacks are slices of one mapping. With --guard-stacks each slice starts with
+   a guard page, so an agent overflowing its stack faults instead of writing into its
+   neighbour's; every guard splits the mapping, and once the kernel runs out of mappings the
+   later slices go unguarded. House h owns the houseAgents agent slots from h * houseAgents,
+   and playing[h] counts those still running. */
+typedef struct CoroutineEngineType {
+    ucontext_t scheduler;
+    CoroutineType *coroutines;
+    int houseAgents;
+    int *playing;
+    int *heap;
+    int heapSize;
+    uint64_t nextOrder;
+    char *stacks;
+    size_t stacksSize;
+    size_t guardSize;
+    int guarded;
+} CoroutineEngineType;
+
+static _Thread_local CoroutineEngineType *currentEngine = NULL;
+static _Thread_local CoroutineType *currentCoroutine = NULL;
+
+/************************************************************************************************
+ * Function: int coroutineBefore(const CoroutineEngineType *engine, int a, int b)
+ * Description: This function orders two agents by when they are due, then by arrival.
+ * Parameters:
+ *      - const CoroutineEngineType *engine: The engine.
+ *      - int a: An agent.
+ *      - int b: Another agent.
+ * Return: Whether a runs before b.
+ ************************************************************************************************/
+static int coroutineBefore(const CoroutineEngineType *engine, int a, int b) {
+    const CoroutineType *first = &engine->coroutines[a];
+    const CoroutineType *second = &engine->coroutines[b];
+
+    return first->wakeAt < second->wakeAt || (first->wakeAt == second->wakeAt && first->order < second->order);
+}
+
+/************************************************************************************************
+ * Function: void pushCoroutine(CoroutineEngineType *engine, int index)
+ * Description: This function queues an agent to run at its wakeAt.
+ * Parameters:
+ *      - CoroutineEngineType *engine: The engine.
+ *      - int index: The agent.
+ * Return: None
+ ************************************************************************************************/
+static void pushCoroutine(CoroutineEngineType *engine, int index) {
+    int child = engine->heapSize++;
+
+    engine->coroutines[index].order = engine->nextOrder++;
+
+    while (child > 0) {
+        int parent = (child - 1) / 2;
+        if (!coroutineBefore(engine, index, engine->heap[parent])) {
+            break;
+        }
+        engine->heap[child] = engine->heap[parent];
+        child = parent;
+    }
+    engine->heap[child] = index;
+}
+
+/************************************************************************************************
+ * Function: int popCoroutine(CoroutineEngineType *engine)
+ * Description: This function takes the agent due first off the queue.
+ * Parameters:
+ *      - CoroutineEngineType *engine: The engine, with at least one agent queued.
+ * Return: The agent.
+ ************************************************************************************************/
+static int popCoroutine(CoroutineEngineType *engine) {
+    int top = engine->heap[0];
+    int last = engine->heap[--engine->heapSize];
+    int parent = 0;
+
+    while (2 * parent + 1 < engine->heapSize) {
+        int child = 2 * parent + 1;
+        if (child + 1 < engine->heapSize && coroutineBefore(engine, engine->heap[child + 1], engine->heap[child])) {
+            child++;
+        }
+        if (!coroutineBefore(engine, engine->heap[child], last)) {
+            break;
+        }
+        engine->heap[parent] = engine->heap[child];
+        parent = child;
+    }
+    engine->heap[parent] = last;
+
+    return top;
+}
+
+/************************************************************************************************
+ * Function: void coroutineMain(int index)
+ * Description: This function is where every coroutine starts: it runs the agent's thread body
+ *              and, when that returns, goes back to the scheduler for good.
+ * Parameters:
+ *      - int index: The agent.
+ * Return: None
+ ************************************************************************************************/
+static void coroutineMain(int index) {
+    CoroutineType *coroutine = &currentEngine->coroutines[index];
+
+    coroutine->body(coroutine->arg);
+    coroutine->finished = C_TRUE;
+}
+
+/************************************************************************************************
+ * Function: void addCoroutine(CoroutineEngineType *engine, int index, int house, void *(*body)(void *), void *arg, RngType *rng)
+ * Description: This function creates the coroutine of an agent on its own slice of the stack
+ *              region, behind a guard page with --guard-stacks, and queues it to run now. A slot used again by a
+ *              later house keeps its slice (and guard).
+ * Parameters:
+ *      - CoroutineEngineType *engine: The engine.
+ *      - int index: The agent slot.
+ *      - int house: The index of the house the agent plays in.
+ *      - void *(*body)(void *): The agent's thread body (hunterThread or ghostThread).
+ *      - void *arg: The agent.
+ *      - RngType *rng: The agent's generator, bound whenever it runs.
+ * Return: None
+ ************************************************************************************************/
+static void addCoroutine(CoroutineEngineType *engine, int index, int house, void *(*body)(void *), void *arg, RngType *rng) {
+    CoroutineType *coroutine = &engine->coroutines[index];
+
+    coroutine->body = body;
+    coroutine->arg = arg;
+    coroutine->rng = rng;
+    coroutine->house = house;
+    coroutine->wakeAt = 0;
+    coroutine->finished = C_FALSE;
+
+    if (getcontext(&coroutine->context) != 0) {
+        perror("Failed to create coroutine");
+        exit(EXIT_FAILURE);
+    }
+    char *slice = engine->stacks + (size_t)index * (engine->guardSize + COROUTINE_STACK_SIZE);
+
+    // Stacks grow down, so the guard goes below the slice, above the previous agent's stack
+    if (!coroutine->sliced && engine->guarded && mprotect(slice, engine->guardSize, PROT_NONE) != 0) {
+        fprintf(stderr, "Warning: could not guard the stack of coroutine agent %d (%s); it and every later agent run without a guard page\n",
+                index, strerror(errno));
+        engine->guarded = C_FALSE;
+    }
+    coroutine->sliced = C_TRUE;
+
+    coroutine->context.uc_stack.ss_sp = slice + engine->guardSize;
+    coroutine->context.uc_stack.ss_size = COROUTINE_STACK_SIZE;
+    coroutine->context.uc_link = &engine->scheduler;
+    makecontext(&coroutine->context, (void (*)(void))coroutineMain, 1, index);
+
+    pushCoroutine(engine, index);
+}
+
+/************************************************************************************************
+ * Function: int onCoroutine(void)
+ * Description: This function tells whether the caller runs as a coroutine, where blocking has
+ *              to yield to the scheduler instead.
+ * Parameters: None
+ * Return: C_TRUE on a coroutine, C_FALSE on an ordinary thread.
+ ************************************************************************************************/
+int onCoroutine(void) {
+    return currentCoroutine != NULL;
+}
+
+/************************************************************************************************
+ * Function: void agentRest(uint64_t nanoseconds)
+ * Description: This function is an agent's rest between turns. A thread sleeps; a coroutine
+ *              yields and is resumed once the time has passed and every agent due before it
+ *              has run, so a rest of 0 lets the others take a turn.
+ * Parameters:
+ *      - uint64_t nanoseconds: How long to rest.
+ * Return: None
+ ************************************************************************************************/
+void agentRest(uint64_t nanoseconds) {
+    if (currentCoroutine == NULL) {
+        struct timespec sleepTime;
+        sleepTime.tv_sec = nanoseconds / 1000000000ULL;
+        sleepTime.tv_nsec = nanoseconds % 1000000000ULL;
+        nanosleep(&sleepTime, NULL);
+        return;
+    }
+
+    CoroutineType *coroutine = currentCoroutine;
+    coroutine->wakeAt = monotonicNanoseconds() + nanoseconds;
+    swapcontext(&coroutine->context, &currentEngine->scheduler);
+}
+
+/************************************************************************************************
+ * Function: void addHouseCoroutines(CoroutineEngineType *engine, int house, HouseType *played)
+ * Description: This function queues every agent of a house that has not finished yet on the
+ *              house's agent slots.
+ * Parameters:
+ *      - CoroutineEngineType *engine: The engine.
+ *      - int house: The index of the house.
+ *      - HouseType *played: The house.
+ * Return: None
+ ************************************************************************************************/
+static void addHouseCoroutines(CoroutineEngineType *engine, int house, HouseType *played) {
+    HunterListType *hunters = played->hunters;
+    int index = house * engine->houseAgents;
+
+    if (hunters->size + 1 > engine->houseAgents) {
+        fprintf(stderr, "A house has more agents than its coroutine slots\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < hunters->size; i++) {
+        if (!hunters->hunterList[i]->done) {
+            addCoroutine(engine, index++, house, hunterThread, hunters->hunterList[i], &hunters->hunterList[i]->rng);
+        }
+    }
+    addCoroutine(engine, index++, house, ghostThread, played->ghost, &played->ghost->rng);
+
+    engine->playing[house] = index - house * engine->houseAgents;
+}
+
+/************************************************************************************************
+ * Function: void runCoroutineHouses(HouseType **houses, int count, RunArenaType *arena, CoroutineRefillType refill, void *context)
+ * Description: This function plays houses on the calling thread with every agent of every house
+ *              as a coroutine running its usual thread body. Rests and contended room locks
+ *              yield to a scheduler that resumes the agent due first, whichever house it is in,
+ *              and the thread only sleeps when no agent is due. Agents are switched only where
+ *              they would block, never in the middle of a turn. The houses share nothing but
+ *              the thread: each ends on its own state. As soon as the last agent of a house
+ *              finishes, refill is called (on the scheduler, outside every coroutine); if it
+ *              puts another house in its place, that house is played on the same agent slots
+ *              while the others go on. Every house, refills included, may have at most as many
+ *              hunters as the largest of the houses given.
+ * Parameters:
+ *      - HouseType **houses: The houses to play in; refill may replace them.
+ *      - int count: How many.
+ *      - RunArenaType *arena: Where the engine's own memory comes from; it must outlive the
+ *        houses, which refill may reset.
+ *      - CoroutineRefillType refill: Called with context when a house has finished, or NULL.
+ *      - void *context: Passed to refill.
+ * Return: None
+ ************************************************************************************************/
+void runCoroutineHouses(HouseType **houses, int count, RunArenaType *arena, CoroutineRefillType refill, void *context) {
+    CoroutineEngineType engine;
+    int houseAgents = 0;
+
+    for (int h = 0; h < count; h++) {
+        if (houses[h]->hunters->size + 1 > houseAgents) {
+            houseAgents = houses[h]->hunters->size + 1;
+        }
+    }
+
+    int capacity = count * houseAgents;
+
+    memset(&engine, 0, sizeof(engine));
+    engine.houseAgents = houseAgents;
+    engine.coroutines = arenaAlloc(arena, capacity * sizeof(CoroutineType), CACHE_LINE);
+    memset(engine.coroutines, 0, capacity * sizeof(CoroutineType));
+    engine.playing = arenaAlloc(arena, count * sizeof(int), _Alignof(int));
+    engine.heap = arenaAlloc(arena, capacity * sizeof(int), _Alignof(int));
+    engine.guarded = gameOptions.guardStacks;
+    engine.guardSize = engine.guarded ? (size_t)sysconf(_SC_PAGESIZE) : 0;
+    engine.stacksSize = (size_t)capacity * (engine.guardSize + COROUTINE_STACK_SIZE);
+
+    // One reserved region for every stack: pages are only committed as agents touch them
+    engine.stacks = mmap(NULL, engine.stacksSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+
+    if (engine.stacks == MAP_FAILED) {
+        perror("Failed to allocate coroutines");
+        exit(EXIT_FAILURE);
+    }
+
+    currentEngine = &engine;
+
+    for (int h = 0; h < count; h++) {
+        addHouseCoroutines(&engine, h, houses[h]);
+    }
+
+    while (engine.heapSize > 0) {
+        CoroutineType *coroutine = &engine.coroutines[popCoroutine(&engine)];
+
+        if (coroutine->wakeAt > monotonicNanoseconds()) {
+            struct timespec wakeTime;
+            wakeTime.tv_sec = coroutine->wakeAt / 1000000000ULL;
+            wakeTime.tv_nsec = coroutine->wakeAt % 1000000000ULL;
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeTime, NULL) == EINTR) {
+            }
+        }
+
+        currentCoroutine = coroutine;
+        bindRng(coroutine->rng);
+        swapcontext(&engine.scheduler, &coroutine->context);
+        currentCoroutine = NULL;
+
+        if (!coroutine->finished) {
+            pushCoroutine(&engine, (int)(coroutine - engine.coroutines));
+        } else if (--engine.playing[coroutine->house] == 0 && refill != NULL) {
+            int house = coroutine->house;
+
+            bindRng(NULL);
+            if (refill(context, house)) {
+                addHouseCoroutines(&engine, house, houses[house]);
+            }
+        }
+    }
+
+    bindRng(NULL);
+    currentEngine = NULL;
+    munmap(engine.stacks, engine.stacksSize);
+}
+
+/************************************************************************************************
+ * Function: void runCoroutineHouse(HouseType *house)
+ * Description: This function plays a single house with runCoroutineHouses.
+ * Parameters:
+ *      - HouseType *house: The house to play in.
+ * Return: None
+ ************************************************************************************************/
+void runCoroutineHouse(HouseType *house) {
+    runCoroutineHouses(&house, 1, house->arena, NULL, NULL);
+}
@@ -1,3 +1,5 @@
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,6 +9,11 @@
 #include <pthread.h>
 #include <semaphore.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <getopt.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 
 #define INVALID_EVIDENCE_TOOL -1
 
@@ -16,6 +23,10 @@
 #define C_TRUE              1
 #define C_FALSE             0
 #define MAX_HUNTERS         4
+#define EVIDENCE_TYPES      4
+#define GHOST_TYPES         4
+#define EVIDENCE_PER_GHOST  3
+#define SEARCH_TABLE_MAX_ROOMS 1024
 #define HUNTER_WAIT        5000
 #define GHOST_WAIT         600
 #define FEAR_MAX        10
@@ -27,140 +38,704 @@
 //#define FEAR_RATE           1
 #define USLEEP_TIME     50000
 #define ALL_ROOMS        13
+#define TELEMETRY_MAX_ROOMS 64
+#define TELEMETRY_FLUSH_EVERY 32
+#define WAKE_IDLE_TURNS    8
+#define CACHE_LINE          64
+#define SHARD_EVIDENCE_MAX  32
+#define COROUTINE_STACK_SIZE (64 * 1024)
+#define RUN_ARENA_CHUNK_SIZE (1 << 20)
+#define RUN_ARENA_BLOCK_SIZE (16 * 1024)
+#define TELEMETRY_MAGIC    0x50505431
+#define LATENCY_SUB_BITS   6
+#define LATENCY_MAX_BITS   41
+#define LATENCY_FLUSH_EVERY (1 << 20)
 #define C_MISC_ERROR       -1
 #define C_NO_ROOM_ERROR    -2
 #define C_ARR_ERROR        -3
+#define C_HANDED_OFF        2
 #define UNKNOWN_GHOST      -4
+#define REPLAY_GHOST       -1
 
 typedef enum { EMF, TEMPERATURE, FINGERPRINTS, SOUND } EvidenceClassType;
 typedef enum { POLTERGEIST, BANSHEE, BULLIES, PHANTOM } GhostClassType;
+/* Registry entry for an evidence type; the ghostly range is declared as written and compiled into
+   ghostlyAbove/ghostlyUpTo by compileRegistry. */
+typedef struct EvidenceInfoType {
+    const char *name;
+    float standardMin;
+    float standardMax;
+    float ghostMin;
+    float ghostMax;
+    double ghostlyLow;
+    int lowInclusive;
+    double ghostlyHigh;
+    int highInclusive;
+    float ghostlyAbove;
+    float ghostlyUpTo;
+} EvidenceInfoType;
+
+/* Registry entry for a ghost type: the evidence types it leaves, as a mask and (compiled) a list. */
+typedef struct GhostInfoType {
+    const char *name;
+    unsigned evidenceMask;
+    EvidenceClassType leaves[EVIDENCE_PER_GHOST];
+} GhostInfoType;
+
+extern EvidenceInfoType evidenceRegistry[];
+extern GhostInfoType ghostRegistry[];
+
+typedef enum { OUTCOME_HUNTERS_WIN, OUTCOME_GHOST_WIN, OUTCOME_UNDETERMINED } GameOutcomeType;
+typedef enum { HOUSE_FIXED, HOUSE_GRID, HOUSE_TREE, HOUSE_GEOMETRIC, HOUSE_SMALL_WORLD } HouseKindType;
+typedef enum { DEGREE_FIXED, DEGREE_UNIFORM, DEGREE_POWER_LAW } DegreeDistributionType;
+typedef enum { EVICT_OLDEST, EVICT_MUNDANE } EvictPolicyType;
+typedef enum { RESULTS_JSONL, RESULTS_CSV } ResultsFormatType;
+typedef enum { PIN_OFF, PIN_COMPACT, PIN_SPREAD } PinModeType;
 enum LoggerDetails { LOG_FEAR, LOG_BORED, LOG_EVIDENCE, LOG_SUFFICIENT, LOG_INSUFFICIENT, LOG_UNKNOWN };
 
+typedef struct RngType {
+    uint64_t state;
+} RngType;
 
 int randInt(int, int);
 float randFloat(float, float);
+void seedRng(RngType *, uint64_t);
+void bindRng(RngType *);
+uint64_t nextRandom(void);
+uint64_t randomDraws(void);
+
+/* Everything a run allocates comes from its worker's arena and is given back all at once by
+   resetRunArena. Chunks are kept across resets, so a batch worker's next run reuses them. Threads
+   carve RUN_ARENA_BLOCK_SIZE blocks under the lock and allocate from them without it; a reset
+   changes the epoch, which invalidates every block handed out before. An arena whose thread
+   allocates from other arenas in between (a house pool slot) is carveDirect: it is carved from
+   for every allocation, so switching arenas never strands the rest of a block. */
+typedef struct RunArenaChunkType {
+    struct RunArenaChunkType *next;
+    size_t size;
+} RunArenaChunkType;
+
+typedef struct RunArenaType {
+    pthread_mutex_t lock;
+    RunArenaChunkType *chunks;
+    RunArenaChunkType *last;
+    RunArenaChunkType *current;
+    size_t used;
+    size_t reserved;
+    uint64_t epoch;
+    int carveDirect;
+} RunArenaType;
+
+void initRunArena(RunArenaType *);
+void *arenaAlloc(RunArenaType *, size_t, size_t);
+void *arenaGrow(RunArenaType *, void *, size_t, size_t, size_t);
+void resetRunArena(RunArenaType *);
+void sealRunArena(RunArenaType *);
+void releaseRunArena(RunArenaType *);
 
 typedef struct EvidenceNode {
     struct EvidenceType* data;
     struct EvidenceNode* next;
 } EvidenceNodeType;
 
-typedef struct RoomNode {
-    struct RoomType* data;
-    struct RoomNode* next;
-} RoomNodeType;
-
 typedef struct GhostEvidenceList {
     EvidenceNodeType* head;
     EvidenceNodeType* tail;
 } GhostEvidenceListType;
 
-typedef struct RoomList {
-    RoomNodeType* head;
-    RoomNodeType* tail;
-    int size;
-} RoomListType;
-
+/* Each hunter is its own cache-line aligned allocation. What other threads read (its name, tool
+   and evidence list) comes first; what its own thread writes every turn starts on a fresh line,
+   so one hunter's turns never invalidate a line another thread is reading. */
 typedef struct HunterType {
-    struct RoomType *room;
+    _Alignas(CACHE_LINE) int id;
     EvidenceClassType evidence;
     GhostEvidenceListType *ghostEvidence;
+    struct HouseType *house;
     char name[MAX_STR];
+    _Alignas(CACHE_LINE) struct RoomType *room;
     int fear;
     int timer;
     int restDuration;
     int evidenceCollected;
-
+    int steps;
+    int done;
+    int idle;
+    unsigned wakeSeen;
+    RngType rng;
+    int routeTarget;
+    int routeLength;
+    int routeCapacity;
+    int *route;
 } HunterType;
 
 typedef struct GhostType {
-    GhostClassType ghostType;
+    _Alignas(CACHE_LINE) GhostClassType ghostType;
     struct RoomType *room;
     int boredomDuration;
     int restDuration;
+    int steps;
+    RngType rng;
+    struct HouseType *house;
 } GhostType;
 
+typedef struct EvidenceType {
+    EvidenceClassType evidenceType;
+    float readingInfo;
+} EvidenceType;
+
+typedef struct EvidenceChannelNode {
+    struct EvidenceChannelNode* next;
+    EvidenceType evidence;
+} EvidenceChannelNodeType;
+
+/* Evidence memory a house hands out again once it is given back: a room channel node, or a
+   hunter's copy with its list node. While spare, a slot is linked through next. */
+typedef union EvidenceSlotType {
+    union EvidenceSlotType *next;
+    EvidenceChannelNodeType channel;
+    struct {
+        EvidenceNodeType node;
+        EvidenceType evidence;
+    } copy;
+} EvidenceSlotType;
+
+/* Evidence of one type left in a room. Any thread pushes onto the incoming stack; the one hunter
+   holding taking moves it, oldest first, to the pending list and takes from there. count is
+   what both hold together; with --evidence-cap the holder of taking evicts down to the cap and
+   gives the evicted nodes back to house. */
+typedef struct EvidenceChannelType {
+    _Atomic(EvidenceChannelNodeType *) incoming;
+    EvidenceChannelNodeType *pending;
+    EvidenceChannelNodeType *pendingTail;
+    atomic_int count;
+    atomic_flag taking;
+    struct HouseType *house;
+} EvidenceChannelType;
+
+/* The part of a room no run ever changes: its name and the ids of the rooms it connects to. */
+typedef struct RoomTopologyType {
+    const char *name;
+    const int32_t *connected;
+    int connectedCount;
+} RoomTopologyType;
+
+/* A floor plan built once and then only read: the rooms' names and connections and, for houses
+   of up to SEARCH_TABLE_MAX_ROOMS rooms played with directed search, the search tables. Any
+   number of runs, concurrent or forked, play on one topology, which lives in an arena sealed
+   read-only once it is built (or points into a mapped house image). */
+typedef struct HouseTopologyType {
+    int roomCount;
+    int connectionCount;
+    const RoomTopologyType *rooms;
+    const uint16_t *nextHop;
+    const uint16_t *distance;
+} HouseTopologyType;
+
+/* The state of a room in one run, laid out for the agent step: the semaphore and the wakeup
+   counters on the first cache line (written on every lock and event), occupancy on the second and
+   the evidence channels on the next two. Rooms of a run live in one cache-line-aligned array
+   indexed by id, so a room finds its neighbours (connectedRoom) from its topology's ids. */
 typedef struct RoomType {
-    sem_t semaphore;
-    char name[MAX_STR];
-    RoomListType* connectedRooms;
-    GhostEvidenceListType* evidenceList;
-    struct HunterListType *hunters;
+    _Alignas(CACHE_LINE) sem_t semaphore;
+    atomic_uint wakeSeq;
+    atomic_int sleepers;
+    _Alignas(CACHE_LINE) int id;
+    int hunterCount;
+    struct HunterType *hunters[MAX_HUNTERS];
     struct GhostType *ghost;
+    const RoomTopologyType *topology;
+    atomic_int evidenceHints;
+    _Alignas(CACHE_LINE) EvidenceChannelType evidence[EVIDENCE_TYPES];
 } RoomType;
 
 typedef struct HunterListType {
     int size;
-    HunterType *hunterList[MAX_HUNTERS];
-    
+    int capacity;
+    HunterType **hunterList;
+    RunArenaType *arena;
 } HunterListType;
 
-typedef struct EvidenceType {
-    EvidenceClassType evidenceType;
-    float readingInfo;
-} EvidenceType;
-
-typedef struct {
+typedef struct HouseType {
     GhostType* ghost;
     HunterListType *hunters;
-    RoomListType* rooms;
+    RoomType *rooms;
+    int roomCount;
+    const HouseTopologyType *topology;
+    RngType rng;
+    atomic_int gameOver;
+    atomic_int evidenceCollected;
+    struct SearchTableType *search;
+    RunArenaType *arena;
+    _Atomic(EvidenceSlotType *) spareEvidence;
 } HouseType; 
 
+/* Directed search: which rooms hold evidence of each type, and how to get there. Houses of up to
+   SEARCH_TABLE_MAX_ROOMS rooms get all-pairs next-hop and distance tables; larger ones are
+   searched breadth-first on demand. */
+typedef struct SearchTableType {
+    int roomCount;
+    RoomType *rooms;
+    const uint16_t *nextHop;
+    const uint16_t *distance;
+    atomic_int hinted[EVIDENCE_TYPES];
+} SearchTableType;
+
+/* A floor plan compiled into a position independent file (see houseimage.c) and mapped
+   read-only: the house topology points into it for names, connections and search tables.
+   Sections are found through offsets from the start of the file. */
+typedef struct HouseImageType {
+    const void *base;
+    size_t size;
+    int roomCount;
+    int connectionCount;
+    const int32_t *first;
+    const int32_t *adjacency;
+    const char (*names)[MAX_STR];
+    const uint16_t *nextHop;
+    const uint16_t *distance;
+} HouseImageType;
+
+/* A floor plan as plain data: rooms are ids 0..roomCount-1 (0 is the van), edges are id pairs. */
+typedef struct HouseLayoutType {
+    int roomCount;
+    int edgeCount;
+    int edgeCapacity;
+    int *edges;
+    char (*names)[MAX_STR];
+} HouseLayoutType;
+
+typedef struct HouseGenSpecType {
+    HouseKindType kind;
+    int rooms;
+    double degree;
+    DegreeDistributionType distribution;
+    double rewire;
+} HouseGenSpecType;
+
+typedef struct GameOptionsType {
+    int hunterRestDuration;
+    int ghostRestDuration;
+    uint64_t seed;
+    int hasSeed;
+    int quiet;
+    const char *checkpointPath;
+    int checkpointAt;
+    const char *restorePath;
+    int forks;
+    int runs;
+    int jobs;
+    int houses;
+    int poolWorkers;
+    const char *telemetryName;
+    HouseGenSpecType houseSpec;
+    const char *houseFile;
+    const char *saveHousePath;
+    const char *compileHousePath;
+    const char *houseImagePath;
+    int hunters;
+    int shards;
+    int processes;
+    int directedSearch;
+    const char *recordPath;
+    const char *replayPath;
+    int checkEvery;
+    int eventWakeups;
+    int evidenceCap;
+    EvictPolicyType evictPolicy;
+    const char *resultsPath;
+    ResultsFormatType resultsFormat;
+    int latency;
+    int stats;
+    int profile;
+    int coroutines;
+    int guardStacks;
+    int tickWorkers;
+    PinModeType pinMode;
+    int numa;
+} GameOptionsType;
+
+extern GameOptionsType gameOptions;
+
+/* Record/replay: recording serializes agent turns and logs them, replaying re-executes them in order. */
+typedef enum { REPLAY_OFF, REPLAY_RECORDING, REPLAY_REPLAYING } ReplayModeType;
+extern ReplayModeType replayMode;
+
+typedef enum { SHARD_HUNTER, SHARD_GHOST } ShardMessageKindType;
+
+/* What a process needs to take over an agent another process was running. */
+typedef struct ShardAgentStateType {
+    int owner;
+    int room;
+    int fear;
+    int timer;
+    int boredom;
+    int evidenceCollected;
+    int steps;
+    int evidenceCount;
+    uint64_t rng;
+    EvidenceType evidence[SHARD_EVIDENCE_MAX];
+} ShardAgentStateType;
+
+/* An agent moving into a room owned by another shard; state is only filled in across processes. */
+typedef struct ShardMessageType {
+    ShardMessageKindType kind;
+    int agent;
+    int room;
+    int active;
+    int remote;
+    ShardAgentStateType state;
+} ShardMessageType;
+
+typedef struct ShardQueueSlotType {
+    atomic_size_t sequence;
+    ShardMessageType message;
+} ShardQueueSlotType;
+
+/* Bounded lock-free multi-producer queue (sequence numbered ring); only the owning shard pops. */
+typedef struct ShardQueueType {
+    _Alignas(CACHE_LINE) atomic_size_t tail;
+    _Alignas(CACHE_LINE) size_t head;
+    size_t mask;
+    ShardQueueSlotType *slots;
+} ShardQueueType;
+
+typedef struct ShardType {
+    int id;
+    int process;
+    struct ShardedHouseType *sharded;
+    ShardQueueType inbox;
+    HunterType **hunters;
+    int hunterCount;
+    int hunterCapacity;
+    GhostType *ghost;
+    HunterType *pendingHunter;
+    GhostType *pendingGhost;
+    uint64_t steps;
+    uint64_t handoffs;
+    pthread_t thread;
+} ShardType;
+
+/* Owner-computes view of a house: every room belongs to exactly one shard (worker thread).
+   Lives in shared memory so that shards forked into other processes see the same queues. */
+typedef struct ShardedHouseType {
+    HouseType *house;
+    int shardCount;
+    int processCount;
+    ShardType *shards;
+    RoomType *rooms;
+    int *roomShard;
+    atomic_int *occupancy;
+    ShardAgentStateType *results;
+    atomic_int activeAgents;
+    atomic_int gameOver;
+    atomic_int evidenceCollected;
+} ShardedHouseType;
+
+extern _Thread_local ShardType *currentShard;
+
+/* Live counters published in a POSIX shared memory segment and read by pp-top. Every field is
+   written with relaxed atomics; the reader only needs eventually consistent numbers. */
+typedef struct TelemetryType {
+    uint32_t magic;
+    int32_t pid;
+    atomic_int finished;
+    atomic_int roomCount;
+    atomic_int hunterCount;
+    atomic_int ghostBoredom;
+    atomic_int ghostRoom;
+    _Atomic uint64_t runsCompleted;
+    _Atomic uint64_t runsHuntersWon;
+    _Atomic uint64_t runsGhostWon;
+    _Atomic uint64_t agentSteps;
+    _Atomic uint64_t evidenceProduced;
+    _Atomic uint64_t evidenceCollected;
+    _Atomic uint64_t moves;
+    _Atomic uint64_t moveFailures;
+    atomic_int hunterFear[MAX_HUNTERS];
+    atomic_int hunterTimer[MAX_HUNTERS];
+    atomic_int roomOccupancy[TELEMETRY_MAX_ROOMS];
+    char hunterNames[MAX_HUNTERS][MAX_STR];
+    char roomNames[TELEMETRY_MAX_ROOMS][MAX_STR];
+} TelemetryType;
+
+extern TelemetryType *telemetry;
+
+#define TELEMETRY_ADD(counter, amount) \
+    do { if (telemetry != NULL) atomic_fetch_add_explicit(&telemetry->counter, (amount), memory_order_relaxed); } while (0)
+#define TELEMETRY_SET(field, value) \
+    do { if (telemetry != NULL) atomic_store_explicit(&telemetry->field, (value), memory_order_relaxed); } while (0)
+
+/* The counters every agent step adds to are summed per thread and published every
+   TELEMETRY_FLUSH_EVERY additions and when the thread stops, not on every step. */
+typedef struct TelemetryPendingType {
+    uint64_t agentSteps;
+    uint64_t evidenceProduced;
+    uint64_t evidenceCollected;
+    uint64_t moves;
+    uint64_t moveFailures;
+    int updates;
+} TelemetryPendingType;
+
+extern _Thread_local TelemetryPendingType telemetryPending;
+
+#define TELEMETRY_COUNT(counter, amount) \
+    do { if (telemetry != NULL) { telemetryPending.counter += (amount); \
+         if (++telemetryPending.updates >= TELEMETRY_FLUSH_EVERY) telemetryFlush(); } } while (0)
+
+/* Streaming run statistics (--stats): for every metric the count, the Welford mean and sum of
+   squared deviations, the minimum and the maximum. A worker accumulates only its own runs and
+   the accumulators are merged once workers finish, so they take the same space for any number
+   of runs. Outcomes are 0/1 samples, so their mean is the rate. */
+typedef enum {
+    RUN_STAT_HUNTERS_WIN, RUN_STAT_GHOST_WIN, RUN_STAT_UNDETERMINED, RUN_STAT_STEPS, RUN_STAT_WALL,
+    RUN_STAT_FEAR, RUN_STAT_EVIDENCE, RUN_STATS
+} RunStatKindType;
+
+typedef struct StatAccumulatorType {
+    uint64_t count;
+    double mean;
+    double m2;
+    double min;
+    double max;
+} StatAccumulatorType;
+
+typedef struct RunStatsType {
+    StatAccumulatorType metrics[RUN_STATS];
+} RunStatsType;
+
+/* Latency histograms (--latency) in nanoseconds. Bucket boundaries are log-linear: below
+   2 * LATENCY_SUB_BUCKETS every value has a bucket, above that every power of two is split into
+   LATENCY_SUB_BUCKETS, so any value is known to within 1/LATENCY_SUB_BUCKETS. Values of
+   2^LATENCY_MAX_BITS ns (about 36 minutes) or more share the last bucket. */
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+#define LATENCY_BUCKETS     ((LATENCY_MAX_BITS - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS)
+
+typedef enum {
+    LATENCY_RUN_WALL, LATENCY_RUN_CPU, LATENCY_GRAB_EVIDENCE, LATENCY_REPOSITION,
+    LATENCY_VERIFY_EVIDENCE, LATENCY_NEW_EVIDENCE, LATENCY_ROOM_LOCK, LATENCY_KINDS
+} LatencyKindType;
+
+/* The merged histograms live in a shared mapping, so threads, forked continuations and shard
+   processes all add their samples to the same counts. */
+typedef struct LatencyHistogramsType {
+    _Atomic uint64_t counts[LATENCY_KINDS][LATENCY_BUCKETS];
+    _Atomic uint64_t max[LATENCY_KINDS];
+} LatencyHistogramsType;
+
+extern LatencyHistogramsType *latency;
+
+#define LATENCY_START() ((latency != NULL) ? monotonicNanoseconds() : 0)
+#define LATENCY_RECORD(kind, started) \
+    do { if (latency != NULL) recordLatency((kind), monotonicNanoseconds() - (started)); } while (0)
+
+/* Per-phase profile (--profile) of the hunter and ghost threads. Each thread charges the clock
+   ticks since its last phase switch to the phase it was in; lock waits and logging are entered
+   from whatever phase the thread is in and return to it. */
+typedef enum { PROFILE_SLEEP, PROFILE_LOCK, PROFILE_ACTION, PROFILE_LOGGING, PROFILE_CHECK, PROFILE_PHASES } ProfilePhaseType;
+typedef enum { PROFILE_HUNTER, PROFILE_GHOST, PROFILE_AGENTS } ProfileAgentType;
+
+typedef struct ProfileTotalsType {
+    _Atomic uint64_t ticks[PROFILE_AGENTS][PROFILE_PHASES];
+    _Atomic uint64_t turns[PROFILE_AGENTS];
+    _Atomic uint64_t threads[PROFILE_AGENTS];
+} ProfileTotalsType;
+
+extern ProfileTotalsType *profile;
+
+#define PROFILE_TURN() do { if (profile != NULL) profileTurn(); } while (0)
+#define PROFILE_PHASE(phase) do { if (profile != NULL) profileSwitch(phase); } while (0)
+#define PROFILE_ENTER(phase) ((profile != NULL) ? profileSwitch(phase) : -1)
+#define PROFILE_LEAVE(previous) do { if ((previous) >= 0) profileSwitch((ProfilePhaseType)(previous)); } while (0)
+
 void *ghostThread(void*);
 void *hunterThread(void*);
+int hunterStep(HunterType*);
+int hunterKeepsHunting(HunterType*);
+int hunterTurn(HunterType*);
+void finishHunter(HunterType*);
+int ghostStep(GhostType*);
+int ghostKeepsHaunting(GhostType*);
+int ghostTurn(GhostType*, int);
+void lockRoom(RoomType*);
+int tryLockRoom(RoomType*);
+void unlockRoom(RoomType*);
+void dropEvidence(RoomType*, EvidenceChannelNodeType*);
+int beginTakingEvidence(EvidenceChannelType*);
+void endTakingEvidence(EvidenceChannelType*);
+EvidenceChannelNodeType* settleEvidence(EvidenceChannelType*);
+EvidenceChannelNodeType* takeEvidence(EvidenceChannelType*);
+EvidenceChannelNodeType *newChannelEvidence(HouseType*);
+void recycleChannelEvidence(HouseType*, EvidenceChannelNodeType*);
+EvidenceNodeType *newHunterEvidence(HouseType*);
+void recycleHunterEvidence(HouseType*, EvidenceNodeType*);
+void lockRoomEvidence(RoomType*);
+void wakeRoom(RoomType*);
+void wakeHouse(HouseType*);
+void parkInRoom(RoomType*, unsigned, int);
+void unlockRoomEvidence(RoomType*);
+
+void printUsage(const char *);
+void parseGameOptions(int, char *[], GameOptionsType *);
+void setupHouse(HouseType*, RunArenaType*, const HouseTopologyType*);
+void defaultHouseLayout(HouseLayoutType*);
+void initHouseLayout(HouseLayoutType*, int);
+void addLayoutEdge(HouseLayoutType*, int, int);
+void layoutRoomName(const HouseLayoutType*, int, char*);
+void releaseHouseLayout(HouseLayoutType*);
+void buildTopologyFromLayout(HouseTopologyType*, RunArenaType*, const HouseLayoutType*, int);
+int generateHouseLayout(HouseLayoutType*, const HouseGenSpecType*);
+int parseHouseKind(const char*);
+int parseDegreeDistribution(const char*);
+int saveHouseLayout(const HouseLayoutType*, const char*);
+int loadHouseLayout(HouseLayoutType*, const char*);
+int compileHouseImage(const HouseLayoutType*, const char*);
+int loadHouseImage(HouseImageType*, const char*);
+void releaseHouseImage(HouseImageType*);
+void buildTopologyFromImage(HouseTopologyType*, RunArenaType*, const HouseImageType*);
+void runContinuations(const void *, size_t);
+void playRuns(RunArenaType *, const HouseTopologyType *, uint64_t, int, int, int[], RunStatsType *);
+void runJobs(const HouseTopologyType *, uint64_t, int[], RunStatsType *);
+void runHousePool(const HouseTopologyType *, uint64_t, int[], RunStatsType *);
+void seedHouse(HouseType*, uint64_t);
+void releaseHouse(HouseType*);
+GameOutcomeType runGame(HouseType*);
+GameOutcomeType runTimedGame(HouseType*, uint64_t*);
+GameOutcomeType reportGame(HouseType*);
+GameOutcomeType decideOutcome(HunterListType *, GhostType*, int);
+void logEvent(const char *format, ...);
+
+void computeNextHopTables(const RoomTopologyType *, int, uint16_t *, uint16_t *);
+void buildSearchTable(HouseType *);
+void releaseSearchScratch(void);
+void markEvidenceHint(HouseType *, RoomType *, EvidenceClassType);
+void clearEvidenceHint(HouseType *, RoomType *, EvidenceClassType);
+RoomType *chooseSearchRoom(HunterType *);
+
+/* Called by runCoroutineHouses once every agent of a house has finished: it may put another house
+   in the same place of the houses array and return C_TRUE to have it played on the agent slots
+   the finished one used. */
+typedef int (*CoroutineRefillType)(void *context, int house);
+
+void runShardedHouse(HouseType *, int, int);
+void runThreadedHouse(HouseType *);
+void runCoroutineHouse(HouseType *);
+void runCoroutineHouses(HouseType **, int, RunArenaType *, CoroutineRefillType, void *);
+void runTickHouse(HouseType *, int);
+int onCoroutine(void);
+void agentRest(uint64_t);
+int shardCountEvidence(ShardType *);
+int shardMoveHunter(ShardType *, HunterType *, RoomType *);
+int shardHandOffGhost(ShardType *, GhostType *);
+
+int startRecording(const char *, HouseType *);
+int stopRecording(void);
+int openReplay(const char *, uint64_t *);
+void replayHouse(HouseType *);
+void beginTurn(int);
+void endTurn(int, const RngType *);
+int noteRoomLock(RoomType *, int);
+
+void checkHouse(HouseType *, const char *);
+void enterCheckedTurn(void);
+void leaveCheckedTurn(HouseType *, const char *);
+void pauseTurns(void);
+void resumeTurns(void);
+
+int openTelemetry(const char *);
+void closeTelemetry(void);
+void telemetryBeginRun(HouseType *);
+void telemetryEndRun(GameOutcomeType);
+void telemetryFlush(void);
+void telemetryHunter(HunterType *);
+void telemetryRoom(RoomType *);
+
+void initRunStats(RunStatsType *);
+void addRunStats(RunStatsType *, HouseType *, GameOutcomeType, uint64_t);
+void mergeRunStats(RunStatsType *, const RunStatsType *);
+void printRunStats(const RunStatsType *);
+
+int openLatency(void);
+void closeLatency(void);
+void recordLatency(LatencyKindType, uint64_t);
+void latencyFlush(void);
+uint64_t processCpuNanoseconds(void);
+
+int openProfile(void);
+void closeProfile(void);
+void profileStart(ProfileAgentType);
+int profileSwitch(ProfilePhaseType);
+void profileTurn(void);
+void profileStop(void);
+
+int loadTopology(PinModeType);
+void printTopology(void);
+int workerNode(int);
+void placeCurrentWorker(int);
+int createWorkerThread(pthread_t *, int, void *(*)(void *), void *);
+void bindToWorkerNode(void *, size_t, int);
+
+int openResults(const char *, ResultsFormatType);
+void flushResults(void);
+void closeResults(void);
+uint64_t monotonicNanoseconds(void);
+void writeResult(HouseType *, GameOutcomeType, int, const uint64_t *, uint64_t);
 
-void populateRooms(HouseType*);
+int saveHouseSnapshot(HouseType *, const char *);
+int checkpointHouse(HouseType *, const char *);
+const void *mapHouseSnapshot(const char *, size_t *);
+void unmapHouseSnapshot(const void *, size_t);
+int restoreHouseSnapshot(HouseType *, RunArenaType *, const void *, size_t);
 
-void initListOfHunters(HunterListType*); //g
-void initializeHouse(HouseType*); //g
-void initializeRoom(RoomType *room, const char *name);//g
-void initListOfRooms(RoomListType**);//g
+void initListOfHunters(HunterListType*, RunArenaType *); //g
+void initializeHouse(HouseType*, RunArenaType *); //g
+void buildHouseRooms(HouseType *, const HouseTopologyType *);
+RoomType *connectedRoom(RoomType *, int);
+void initializeRoom(RoomType *room, const RoomTopologyType *topology);//g
 void initListOfGhosts(GhostEvidenceListType *);
 void initializeGhost(GhostClassType, RoomType*, int, GhostType *);
 void initializeEvidence(GhostEvidenceListType *);
-void initializeHunter(char* , RoomType *, int, int, HunterType **);
-void connectRooms(RoomType*, RoomType*);
-void addRoom(RoomListType*, RoomNodeType*);
-extern int totalEvidenceCollected;
+void initializeHunter(char* , RoomType *, int, int, RunArenaType *, HunterType **);
 bool appendHunterToList(HunterListType *hunters, HunterType *hunter);
 int assignHunterToRoom(RoomType*, HunterType*);
-RoomNodeType* randomRoom(RoomNodeType* head);
+RoomType* randomRoom(HouseType *);
 int randomTool(int * , int *);
 int findingGhost(HunterListType*);
 int getFearLevel(HunterListType *);
-void getWinner(HunterListType *, GhostType*, int);
+GameOutcomeType getWinner(HunterListType *, GhostType*, int);
 void addHunterEvidence(GhostEvidenceListType*, EvidenceNodeType*);
 void newRandomEvidence(GhostType*);
+EvidenceChannelNodeType *makeGhostEvidence(GhostType*);
+void leaveGhostEvidence(GhostType*, EvidenceChannelNodeType*);
 float createGhostType(EvidenceClassType);
 void moveGhost(GhostType*);
+RoomType *chooseGhostMove(GhostType*);
+void placeGhost(GhostType*, RoomType*);
 int isGhostHere(GhostType*);
 int randomGhostEvidence(GhostClassType);
 int didHunterFindGhost(HunterType*);
 int containsEvidence(HunterType*);
 int verifyEvidence(HunterType*);
 int grabEvidence(HunterType*);
+int collectEvidence(HunterType*);
 int repositionHunter(HunterType*);
+RoomType *chooseHunterMove(HunterType*);
+int moveHunter(HunterType*, RoomType*);
 int removeEvidence(GhostEvidenceListType *, EvidenceNodeType *);
 int isEvidenceFromGhost(EvidenceType*);
 float createStandardValue(EvidenceClassType);
 const char* evidenceTypeToString(EvidenceClassType evidence);
 const char* ghostTypeToString(GhostClassType ghost);
-GhostEvidenceListType* copyEvidence(GhostEvidenceListType *);
+void compileRegistry(void);
+int identifyGhost(unsigned);
+GhostEvidenceListType* copyEvidence(GhostEvidenceListType *, RunArenaType *);
 int isDuplicate(GhostEvidenceListType *, EvidenceNodeType*);
 void addRoomEvidence(GhostEvidenceListType *, EvidenceNodeType*);
 void rerepositionHunter(HunterType *, int);
 void printHunter(const HunterType *hunter);
 void printGhost(const GhostType *ghost);
 void printGhostEvidenceList(const GhostEvidenceListType *ghostEvidenceList, const char* indents);
-void displayRoomList(RoomListType*);
-void releaseHunterResources(HunterType *); 
-void freeGhost(GhostType *);
 void freeRoom(RoomType *);
-void cleanUpEvidenceData(GhostEvidenceListType *);
-void releaseEvidenceNodes(GhostEvidenceListType *);
-void releaseEvidenceList(GhostEvidenceListType *);
-void releaseRoomList(RoomListType *);
-void releaseConnectedRooms(RoomListType*);
+void releaseHouseRooms(HouseType *);
 
 
 
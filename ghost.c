@@ -18,28 +18,6 @@ void initListOfGhosts(GhostEvidenceListType *ghostEvidenceList) {
 
 
 
-/********************************************************************************
- * Function: RoomNodeType* getRandomRoom(RoomNodeType *head)
- * Description: Retrieves a randomly selected room node from the given list of rooms.
- * Parameters:
- *   - RoomNodeType *head: Pointer to the head of the list of rooms.
- * Returns: RoomNodeType* - Pointer to the randomly selected room node.
- * CHATGPT ACCESSED DECEMBER 2ND 2023
- **********************************************************************/
-RoomNodeType* getRandomRoom(RoomNodeType *head) {
-    int roomInt = randInt(1, ALL_ROOMS);
-    RoomNodeType *traverseRoomNode = head;
-
-    int i = 1;
-    while (i < roomInt && traverseRoomNode != NULL) {
-        traverseRoomNode = traverseRoomNode->next;
-        i++;
-    }
-
-    return traverseRoomNode;
-}
-
-
 /* *******************************************************************************************
  * Function: void *ghostThread(void *arg)
  * Description: This function represents the behavior of a ghost in a multi-threaded environment. The ghost
@@ -47,72 +25,127 @@ RoomNodeType* getRandomRoom(RoomNodeType *head) {
  *              After waking up, it checks if the ghost is present at the current location. If so, it randomly
  *              decides to either perform a random move or create new random evidence. If the ghost is not
  *              present, it randomly decides to move or create new random evidence, while decrementing the
- *              boredomDuration in the GhostType structure.
+ *              boredomDuration in the GhostType structure. When a checkpoint was requested, the
+ *              whole house is written to a snapshot after the configured number of ghost steps.
  * Parameters:
  *      - void *arg: A pointer to a GhostType structure, representing the ghost's characteristics.
  * Return: NULL
  * CHATGPT ACCESSED DECEMBER 2ND 2023
  ********************************************************************************************/
 void *ghostThread(void *arg) {
-    srand(time(NULL));
-
     GhostType *ghostPointer = (GhostType*) arg;
+    bindRng(&ghostPointer->rng);
+    profileStart(PROFILE_GHOST);
+
+    int steps = 0;
 
     do {
-        sleep(ghostPointer->restDuration);
+        PROFILE_TURN();
+        agentRest((uint64_t)ghostPointer->restDuration * 1000000000);
+    } while (ghostTurn(ghostPointer, ++steps));
+
+    profileStop();
+    telemetryFlush();
+    latencyFlush();
+    bindRng(NULL);
+    return NULL;
+}
 
-        if (isGhostHere(ghostPointer)) {
-            int pickMove = randInt(0, 2);
+/* *******************************************************************************************
+ * Function: int ghostTurn(GhostType *ghostPointer, int step)
+ * Description: This function takes one turn of a thread-run ghost: the checkpoint, if this is
+ *              the step it was requested after, and a step. With --record or --replay the turn
+ *              is logged or checked as a whole; with --check the house may be validated after it.
+ * Parameters:
+ *      - GhostType *ghostPointer: The ghost taking its turn.
+ *      - int step: The number of this turn, counting from 1.
+ * Return: C_TRUE while the ghost keeps haunting, C_FALSE once it is done.
+ ********************************************************************************************/
+int ghostTurn(GhostType *ghostPointer, int step) {
+    PROFILE_PHASE(PROFILE_ACTION);
 
-            ghostPointer->boredomDuration = BOREDOM_MAX;
+    // Taken before the turn starts: the checkpoint waits for every other agent to end theirs
+    if (gameOptions.checkpointPath != NULL && step == gameOptions.checkpointAt) {
+        checkpointHouse(ghostPointer->house, gameOptions.checkpointPath);
+    }
 
-            if (pickMove) {
-                newRandomEvidence(ghostPointer);
-            }
+    beginTurn(REPLAY_GHOST);
+    enterCheckedTurn();
 
-        } else {
-            int pickMoveI = randInt(0, 3);
+    int haunting = ghostStep(ghostPointer);
 
-            ghostPointer->boredomDuration--;
+    leaveCheckedTurn(ghostPointer->house, "the ghost");
+    endTurn(REPLAY_GHOST, &ghostPointer->rng);
+    return haunting;
+}
 
-            if (pickMoveI == 0) {
-                moveGhost(ghostPointer);
-            } else if (pickMoveI == 1) {
+/* *******************************************************************************************
+ * Function: int ghostStep(GhostType *ghostPointer)
+ * Description: This function performs one turn of the ghost. With hunters in its room the ghost
+ *              stays interested (boredom is reset) and may leave evidence; otherwise it gets more
+ *              bored and either moves or leaves evidence.
+ * Parameters:
+ *      - GhostType *ghostPointer: The ghost taking its turn.
+ * Return: C_TRUE while the ghost keeps haunting, C_FALSE once it is bored or the game is over.
+ ********************************************************************************************/
+int ghostStep(GhostType *ghostPointer) {
+    ghostPointer->steps++;
+
+    if (isGhostHere(ghostPointer)) {
+        int pickMove = randInt(0, 2);
+
+        ghostPointer->boredomDuration = BOREDOM_MAX;
 
-                newRandomEvidence(ghostPointer);
-            }
+        if (pickMove) {
+            uint64_t started = LATENCY_START();
+            newRandomEvidence(ghostPointer);
+            LATENCY_RECORD(LATENCY_NEW_EVIDENCE, started);
         }
-    } while (ghostPointer->boredomDuration > 0);
 
-    return NULL;
+    } else {
+        int pickMoveI = randInt(0, 3);
+
+        ghostPointer->boredomDuration--;
+
+        if (pickMoveI == 0) {
+            moveGhost(ghostPointer);
+        } else if (pickMoveI == 1) {
+            uint64_t started = LATENCY_START();
+            newRandomEvidence(ghostPointer);
+            LATENCY_RECORD(LATENCY_NEW_EVIDENCE, started);
+        }
+    }
+
+    TELEMETRY_COUNT(agentSteps, 1);
+    TELEMETRY_SET(ghostBoredom, ghostPointer->boredomDuration);
+
+    PROFILE_PHASE(PROFILE_CHECK);
+    return ghostKeepsHaunting(ghostPointer);
+}
+
+/* *******************************************************************************************
+ * Function: int ghostKeepsHaunting(GhostType *ghostPointer)
+ * Description: This function decides, at the end of the ghost's step, whether it goes on: it
+ *              stops once it is bored or the game is over.
+ * Parameters:
+ *      - GhostType *ghostPointer: The ghost.
+ * Return: C_TRUE while the ghost keeps haunting, C_FALSE once it is done.
+ ********************************************************************************************/
+int ghostKeepsHaunting(GhostType *ghostPointer) {
+    return ghostPointer->boredomDuration > 0 && !atomic_load(&ghostPointer->house->gameOver);
 }
 
 /* *******************************************************************************************
  * Function: int randomGhostEvidence(GhostClassType ghostType)
  * Description: This function generates a random ghost evidence based on the specified ghost type.
- *              The function uses an array, ghostPointerArray, to map ghost types to possible evidence
- *              values. Depending on the ghost type, certain indices in the array are set to specific values.
- *              The function then returns a random value from the array using the randInt function.
+ *              It picks one of the evidence types the ghost registry lists for that ghost.
  * Parameters:
  *      - GhostClassType ghostType: An enumeration representing the type of ghost.
  * Return: An integer representing the randomly generated ghost evidence.
  * CHATGPT ACCESSED DECEMBER 2ND 2023
  ********************************************************************************************/
 int randomGhostEvidence(GhostClassType ghostType) {
-    int ghostPointerArray[3] = {0};
-
-    if (ghostType == BANSHEE) {
-        ghostPointerArray[2] = 3;
-    } else if (ghostType == POLTERGEIST) {
-        ghostPointerArray[1] = 1;
-        ghostPointerArray[2] = 2;
-    } else if (ghostType == BULLIES) {
-        ghostPointerArray[1] = 2;
-    } else if (ghostType == PHANTOM) {
-        ghostPointerArray[0] = 1;
-    }
-
-    return ghostPointerArray[randInt(0, 3)];
+    return ghostRegistry[ghostType].leaves[randInt(0, EVIDENCE_PER_GHOST)];
 }
 
 
@@ -151,21 +184,11 @@ void addRoomEvidence(GhostEvidenceListType *list, EvidenceNodeType* evidenceNode
  * CHATGPT ACCESSED DECEMBER 2ND 2023
  ********************************************************************************************/
 float createGhostType(EvidenceClassType evidenceType) {
-    struct {
-        float min;
-        float max;
-    } ranges[] = {
-        {4.7, 5.0},       
-        {-10.0, 1.0},      
-        {1, 1},              
-        {65.0, 75.0}         
-    };
-
-    if (evidenceType < 0 || evidenceType >= sizeof(ranges) / sizeof(ranges[0])) {
+    if (evidenceType < 0 || evidenceType >= EVIDENCE_TYPES) {
         return C_MISC_ERROR;
     }
 
-    return randFloat(ranges[evidenceType].min, ranges[evidenceType].max);
+    return randFloat(evidenceRegistry[evidenceType].ghostMin, evidenceRegistry[evidenceType].ghostMax);
 }
 
 
@@ -181,7 +204,7 @@ float createGhostType(EvidenceClassType evidenceType) {
  * CHATGPT ACCESSED DECEMBER 2ND 2023
  ********************************************************************************************/
 int isGhostHere(GhostType *currGhost) {
-    return (currGhost->room->hunters->size > 0) ? 1 : 0;
+    return (currGhost->room->hunterCount > 0) ? 1 : 0;
 }
 
 
@@ -200,7 +223,7 @@ int isGhostHere(GhostType *currGhost) {
 void printGhost(const GhostType *ghost) {
     puts("\n*** GHOST REPORT ***");
     printf("Type of Specter: %s\n", ghostTypeToString(ghost->ghostType));
-    printf("Ghostly Location: %s\n", ghost->room->name);
+    printf("Ghostly Location: %s\n", ghost->room->topology->name);
     printf("Boredom Countdown: %d\n", ghost->boredomDuration);
     puts("*** END OF GHOST REPORT ***\n");
 }
@@ -229,24 +252,3 @@ void printGhostEvidenceList(const GhostEvidenceListType *ghostEvidenceList, cons
         } while (evidenceNode != NULL);
     }
 }
-
-
-
-/* *******************************************************************************************
- * Function: void freeGhost(GhostType *ghost)
- * Description: This function frees the memory allocated for the given ghost and its associated
- *              evidence list. It disconnects the evidence list from the room, releases the memory
- *              for the evidence list, and finally frees the memory for the ghost.
- * Parameters:
- *      - GhostType *ghost: A pointer to the GhostType representing the ghost to be freed.
- * Return: None
- * CHATGPT ACCESSED DECEMBER 2ND 2023
- ********************************************************************************************/
-void freeGhost(GhostType *ghost) {
-    GhostType *ghostToDelete = ghost;
-    GhostEvidenceListType *evidenceListToDelete = ghost->room->evidenceList;
-
-    ghostToDelete->room->evidenceList = NULL;  // Disconnect the evidence list from the room
-    releaseEvidenceList(evidenceListToDelete);    // Free the evidence list
-    free(ghostToDelete);                        // Free the ghost
-}
@@ -1,60 +1,92 @@
 #include "defs.h"
 
 /* *******************************************************************************************
- * Function: void populateRooms(HouseType* house)
- * Description: This function populates the given house with rooms. It creates an array of room names,
- *              initializes RoomType structures for each room, creates RoomNodeType structures, assigns
- *              the RoomType structures to the RoomNodeType structures, and adds the rooms to the house.
+ * Function: void defaultHouseLayout(HouseLayoutType *layout)
+ * Description: This function describes the standard 13 room floor plan as a layout: the room
+ *              names in order (the van first) and the connections between them.
  * Parameters:
- *      - HouseType* house: A pointer to the HouseType representing the house to be populated.
+ *      - HouseLayoutType *layout: The layout to fill.
  * Return: None
- * CHATGPT ACCESSED DECEMBER 2ND 2023
  ********************************************************************************************/
-void populateRooms(HouseType* house) {
+void defaultHouseLayout(HouseLayoutType *layout) {
     const char* roomNames[] = {"Van", "Hallway", "Master Bedroom", "Boy's Bedroom", "Bathroom", "Basement", "Basement Hallway", "Right Storage Room", "Left Storage Room", "Kitchen", "Living Room", "Garage", "Utility Room"};
+    const int connections[][2] = {{0, 1}, {1, 2}, {1, 3}, {1, 4}, {1, 9}, {1, 5}, {5, 6}, {6, 7}, {6, 8}, {9, 10}, {9, 11}, {11, 12}};
     int numRooms = sizeof(roomNames) / sizeof(roomNames[0]);
-    RoomType* rooms[numRooms];
-    RoomNodeType* roomNodes[numRooms];
 
+    initHouseLayout(layout, numRooms);
+    layout->names = malloc(numRooms * sizeof(*layout->names));
     for (int i = 0; i < numRooms; i++) {
-        rooms[i] = calloc(1, sizeof(RoomType));
-        initializeRoom(rooms[i], roomNames[i]);
-        roomNodes[i] = calloc(1, sizeof(RoomNodeType));
-        roomNodes[i]->data = rooms[i];
-        addRoom(house->rooms, roomNodes[i]);
+        strncpy(layout->names[i], roomNames[i], MAX_STR);
     }
 
-    connectRooms(rooms[0], rooms[1]);
-    connectRooms(rooms[1], rooms[2]);
-    connectRooms(rooms[1], rooms[3]);
-    connectRooms(rooms[1], rooms[4]);
-    connectRooms(rooms[1], rooms[9]);
-    connectRooms(rooms[1], rooms[5]);
-    connectRooms(rooms[5], rooms[6]);
-    connectRooms(rooms[6], rooms[7]);
-    connectRooms(rooms[6], rooms[8]);
-    connectRooms(rooms[9], rooms[10]);
-    connectRooms(rooms[9], rooms[11]);
-    connectRooms(rooms[11], rooms[12]);
+    for (int i = 0; i < (int)(sizeof(connections) / sizeof(connections[0])); i++) {
+        addLayoutEdge(layout, connections[i][0], connections[i][1]);
+    }
 }
 
 /* *******************************************************************************************
- * Function: void initializeHouse(HouseType *house)
- * Description: This function initializes a HouseType structure by allocating memory for the ghost,
- *              rooms, and hunters. It also initializes the list of hunters if the allocation is
- *              successful.
+ * Function: void initializeHouse(HouseType *house, RunArenaType *arena)
+ * Description: This function initializes a HouseType structure by allocating memory for the ghost
+ *              (on its own cache lines) and hunters, leaving it without rooms until they are built. It also initializes the
+ *              list of hunters and clears the game over flag. Everything the house allocates during the
+ *              run comes from the given arena; its spare evidence starts empty, as the slots of
+ *              the last run went back with the arena's reset.
  * Parameters:
  *      - HouseType *house: A pointer to the HouseType structure to be initialized.
+ *      - RunArenaType *arena: The run arena of the worker playing the house.
  * Return: None
  * CHATGPT ACCESSED DECEMBER 2ND 2023
  ********************************************************************************************/
-void initializeHouse(HouseType *house) {
-    house->ghost = (GhostType*)calloc(1, sizeof(GhostType));
-    house->rooms = (RoomListType*)calloc(1, sizeof(RoomListType));
-    house->hunters = (HunterListType*)calloc(1, sizeof(HunterListType));
+void initializeHouse(HouseType *house, RunArenaType *arena) {
+    house->arena = arena;
+    house->ghost = (GhostType*)arenaAlloc(arena, sizeof(GhostType), CACHE_LINE);
+    memset(house->ghost, 0, sizeof(GhostType));
+    house->rooms = NULL;
+    house->roomCount = 0;
+    house->topology = NULL;
+    house->hunters = (HunterListType*)arenaAlloc(arena, sizeof(HunterListType), _Alignof(HunterListType));
+    atomic_init(&house->gameOver, C_FALSE);
+    atomic_init(&house->evidenceCollected, 0);
+    atomic_init(&house->spareEvidence, NULL);
+    house->search = NULL;
     
-    if (house->hunters != NULL) {
-        initListOfHunters(house->hunters);
+    initListOfHunters(house->hunters, arena);
+}
+
+
+
+/* *******************************************************************************************
+ * Function: void seedHouse(HouseType *house, uint64_t seed)
+ * Description: This function seeds the house generator and every agent generator from a single
+ *              seed. Each agent gets its own stream (seed + agent index) so the interleaving of
+ *              threads does not change which numbers an agent draws.
+ * Parameters:
+ *      - HouseType *house: The house whose generators are seeded.
+ *      - uint64_t seed: The base seed.
+ * Return: None
+ ********************************************************************************************/
+void seedHouse(HouseType *house, uint64_t seed) {
+    seedRng(&house->rng, seed);
+    seedRng(&house->ghost->rng, seed + 1);
+
+    for (int i = 0; i < house->hunters->size; i++) {
+        seedRng(&house->hunters->hunterList[i]->rng, seed + 2 + i);
     }
 }
 
+/* *******************************************************************************************
+ * Function: void releaseHouse(HouseType *house)
+ * Description: This function releases every resource owned by the house. Its memory (hunters,
+ *              ghost, rooms, evidence, search tables) all lives in the run arena, which is reset
+ *              in one step for the worker's next run, so only the room semaphores are walked.
+ * Parameters:
+ *      - HouseType *house: The house to release.
+ * Return: None
+ ********************************************************************************************/
+void releaseHouse(HouseType *house) {
+    releaseHouseRooms(house);
+    house->search = NULL;
+    house->hunters = NULL;
+    house->ghost = NULL;
+    resetRunArena(house->arena);
+}
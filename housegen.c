@@ -0,0 +1,652 @@
+#include "defs.h"
+
+#define LAYOUT_MAGIC "PPHOUSE"
+#define LAYOUT_VERSION 1
+
+typedef struct EdgeSetType {
+    uint64_t *keys;
+    size_t capacity;
+} EdgeSetType;
+
+/* *******************************************************************************************
+ * Function: void initHouseLayout(HouseLayoutType *layout, int roomCount)
+ * Description: This function prepares an empty layout for the given number of rooms. Rooms of
+ *              a layout without a name table are called "Van" (room 0) and "Room <id>".
+ * Parameters:
+ *      - HouseLayoutType *layout: The layout to initialize.
+ *      - int roomCount: The number of rooms.
+ * Return: None
+ ********************************************************************************************/
+void initHouseLayout(HouseLayoutType *layout, int roomCount) {
+    layout->roomCount = roomCount;
+    layout->edgeCount = 0;
+    layout->edgeCapacity = 0;
+    layout->edges = NULL;
+    layout->names = NULL;
+}
+
+/* *******************************************************************************************
+ * Function: void addLayoutEdge(HouseLayoutType *layout, int a, int b)
+ * Description: This function appends an undirected connection between rooms a and b.
+ * Parameters:
+ *      - HouseLayoutType *layout: The layout.
+ *      - int a: The first room id.
+ *      - int b: The second room id.
+ * Return: None
+ ********************************************************************************************/
+void addLayoutEdge(HouseLayoutType *layout, int a, int b) {
+    if (layout->edgeCount == layout->edgeCapacity) {
+        layout->edgeCapacity = layout->edgeCapacity ? layout->edgeCapacity * 2 : 64;
+        layout->edges = realloc(layout->edges, (size_t)layout->edgeCapacity * 2 * sizeof(int));
+        if (layout->edges == NULL) {
+            perror("Failed to allocate memory for house edges");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    layout->edges[2 * layout->edgeCount] = a;
+    layout->edges[2 * layout->edgeCount + 1] = b;
+    layout->edgeCount++;
+}
+
+/* *******************************************************************************************
+ * Function: void layoutRoomName(const HouseLayoutType *layout, int id, char *name)
+ * Description: This function writes the name of a layout room into a MAX_STR buffer.
+ * Parameters:
+ *      - const HouseLayoutType *layout: The layout.
+ *      - int id: The room id.
+ *      - char *name: Receives the name.
+ * Return: None
+ ********************************************************************************************/
+void layoutRoomName(const HouseLayoutType *layout, int id, char *name) {
+    if (layout->names != NULL) {
+        strncpy(name, layout->names[id], MAX_STR - 1);
+        name[MAX_STR - 1] = '\0';
+    } else if (id == 0) {
+        strcpy(name, "Van");
+    } else {
+        snprintf(name, MAX_STR, "Room %d", id);
+    }
+}
+
+/* *******************************************************************************************
+ * Function: void releaseHouseLayout(HouseLayoutType *layout)
+ * Description: This function frees the edge and name tables of a layout.
+ * Parameters:
+ *      - HouseLayoutType *layout: The layout to release.
+ * Return: None
+ ********************************************************************************************/
+void releaseHouseLayout(HouseLayoutType *layout) {
+    free(layout->edges);
+    free(layout->names);
+    layout->edges = NULL;
+    layout->names = NULL;
+    layout->edgeCount = layout->edgeCapacity = 0;
+}
+
+/* *******************************************************************************************
+ * Function: void buildTopologyFromLayout(HouseTopologyType *topology, RunArenaType *arena, const HouseLayoutType *layout, int withTables)
+ * Description: This function builds the topology of a layout in an arena: the rooms in id order
+ *              and their connections back to back, each room's in edge order (which fixes the
+ *              order of every connected slice, and with it the random choices agents make).
+ *              Houses small enough get their search tables too when asked.
+ * Parameters:
+ *      - HouseTopologyType *topology: The topology to fill.
+ *      - RunArenaType *arena: The arena everything is allocated from.
+ *      - const HouseLayoutType *layout: The layout to build.
+ *      - int withTables: Whether to compute the search tables (directed search).
+ * Return: None
+ ********************************************************************************************/
+void buildTopologyFromLayout(HouseTopologyType *topology, RunArenaType *arena, const HouseLayoutType *layout, int withTables) {
+    int n = layout->roomCount;
+    int connections = 2 * layout->edgeCount;
+    RoomTopologyType *rooms = arenaAlloc(arena, (size_t)n * sizeof(RoomTopologyType), CACHE_LINE);
+    int32_t *adjacency = arenaAlloc(arena, ((size_t)connections + 1) * sizeof(int32_t), CACHE_LINE);
+    char (*names)[MAX_STR] = arenaAlloc(arena, (size_t)n * MAX_STR, CACHE_LINE);
+    int *filled = calloc((size_t)n + 1, sizeof(int));
+
+    if (filled == NULL) {
+        perror("Failed to allocate memory for rooms");
+        exit(EXIT_FAILURE);
+    }
+
+    // filled[r + 1] counts room r's connections, then becomes where its slice starts
+    for (int e = 0; e < connections; e++) {
+        filled[layout->edges[e] + 1]++;
+    }
+    for (int r = 0; r < n; r++) {
+        filled[r + 1] += filled[r];
+        layoutRoomName(layout, r, names[r]);
+        rooms[r].name = names[r];
+        rooms[r].connected = adjacency + filled[r];
+        rooms[r].connectedCount = 0;
+    }
+
+    for (int e = 0; e < layout->edgeCount; e++) {
+        int a = layout->edges[2 * e];
+        int b = layout->edges[2 * e + 1];
+
+        adjacency[filled[a] + rooms[a].connectedCount++] = b;
+        adjacency[filled[b] + rooms[b].connectedCount++] = a;
+    }
+
+    topology->roomCount = n;
+    topology->connectionCount = connections;
+    topology->rooms = rooms;
+    topology->nextHop = topology->distance = NULL;
+
+    if (withTables && n <= SEARCH_TABLE_MAX_ROOMS) {
+        uint16_t *nextHop = arenaAlloc(arena, (size_t)n * n * sizeof(uint16_t), CACHE_LINE);
+        uint16_t *distance = arenaAlloc(arena, (size_t)n * n * sizeof(uint16_t), CACHE_LINE);
+
+        computeNextHopTables(rooms, n, nextHop, distance);
+        topology->nextHop = nextHop;
+        topology->distance = distance;
+    }
+
+    free(filled);
+}
+
+/* *******************************************************************************************
+ * Function: int findRoot(int *parent, int id)
+ * Description: This function finds the union-find representative of a room, halving paths.
+ * Parameters:
+ *      - int *parent: The union-find parent table.
+ *      - int id: The room id.
+ * Return: The representative id.
+ ********************************************************************************************/
+static int findRoot(int *parent, int id) {
+    while (parent[id] != id) {
+        parent[id] = parent[parent[id]];
+        id = parent[id];
+    }
+    return id;
+}
+
+/* *******************************************************************************************
+ * Function: void connectComponents(HouseLayoutType *layout)
+ * Description: This function makes a layout connected by chaining every disconnected component
+ *              to the one holding the van, so every room is reachable by hunters.
+ * Parameters:
+ *      - HouseLayoutType *layout: The layout to repair.
+ * Return: None
+ ********************************************************************************************/
+static void connectComponents(HouseLayoutType *layout) {
+    int *parent = malloc((size_t)layout->roomCount * sizeof(int));
+    for (int i = 0; i < layout->roomCount; i++) {
+        parent[i] = i;
+    }
+
+    for (int e = 0; e < layout->edgeCount; e++) {
+        int a = findRoot(parent, layout->edges[2 * e]);
+        int b = findRoot(parent, layout->edges[2 * e + 1]);
+        if (a != b) {
+            parent[a] = b;
+        }
+    }
+
+    int previous = 0;
+    for (int i = 1; i < layout->roomCount; i++) {
+        int root = findRoot(parent, i);
+        int vanRoot = findRoot(parent, 0);
+        if (root != vanRoot) {
+            addLayoutEdge(layout, previous, i);
+            parent[root] = vanRoot;
+        }
+        previous = i;
+    }
+
+    free(parent);
+}
+
+/* *******************************************************************************************
+ * Function: int insertEdge(EdgeSetType *set, int a, int b)
+ * Description: This function records an undirected edge in an open addressing hash set.
+ * Parameters:
+ *      - EdgeSetType *set: The set, sized for at least twice the expected edges.
+ *      - int a: The first room id.
+ *      - int b: The second room id.
+ * Return: C_TRUE if the edge is new, C_FALSE if it was already present.
+ ********************************************************************************************/
+static int insertEdge(EdgeSetType *set, int a, int b) {
+    uint64_t key = a < b ? ((uint64_t)a << 32 | (uint32_t)b) : ((uint64_t)b << 32 | (uint32_t)a);
+    key++;
+
+    size_t slot = (key * 0x9E3779B97F4A7C15ULL) & (set->capacity - 1);
+    while (set->keys[slot] != 0) {
+        if (set->keys[slot] == key) {
+            return C_FALSE;
+        }
+        slot = (slot + 1) & (set->capacity - 1);
+    }
+
+    set->keys[slot] = key;
+    return C_TRUE;
+}
+
+/* *******************************************************************************************
+ * Function: int drawBranching(const HouseGenSpecType *spec)
+ * Description: This function draws the number of children of a tree room from the configured
+ *              degree distribution, with mean spec->degree.
+ * Parameters:
+ *      - const HouseGenSpecType *spec: The generator settings.
+ * Return: The number of children.
+ ********************************************************************************************/
+static int drawBranching(const HouseGenSpecType *spec) {
+    switch (spec->distribution) {
+        case DEGREE_UNIFORM:
+            return randInt(0, (int)(2 * spec->degree) + 1);
+        case DEGREE_POWER_LAW: {
+            /* Pareto with shape 2: mean is twice the scale */
+            float u = randFloat(0.0001f, 1.0f);
+            return (int)(spec->degree / 2.0 / sqrt(u));
+        }
+        default:
+            return (int)(spec->degree + 0.5);
+    }
+}
+
+/* *******************************************************************************************
+ * Function: void generateGrid(HouseLayoutType *layout, const HouseGenSpecType *spec)
+ * Description: This function lays the rooms out row by row on a square grid. Rooms connect to
+ *              their horizontal and vertical neighbors, and also diagonally when degree >= 8.
+ * Parameters:
+ *      - HouseLayoutType *layout: The layout to fill.
+ *      - const HouseGenSpecType *spec: The generator settings.
+ * Return: None
+ ********************************************************************************************/
+static void generateGrid(HouseLayoutType *layout, const HouseGenSpecType *spec) {
+    int n = layout->roomCount;
+    int width = (int)ceil(sqrt((double)n));
+
+    for (int i = 0; i < n; i++) {
+        int column = i % width;
+        if (column + 1 < width && i + 1 < n) {
+            addLayoutEdge(layout, i, i + 1);
+        }
+        if (i + width < n) {
+            addLayoutEdge(layout, i, i + width);
+        }
+        if (spec->degree >= 8) {
+            if (column + 1 < width && i + width + 1 < n) {
+                addLayoutEdge(layout, i, i + width + 1);
+            }
+            if (column > 0 && i + width - 1 < n) {
+                addLayoutEdge(layout, i, i + width - 1);
+            }
+        }
+    }
+}
+
+/* *******************************************************************************************
+ * Function: void generateTree(HouseLayoutType *layout, const HouseGenSpecType *spec)
+ * Description: This function grows a tree breadth first from the van. Every room gets a number
+ *              of children drawn from the degree distribution; a room that would end the tree
+ *              early still gets one child.
+ * Parameters:
+ *      - HouseLayoutType *layout: The layout to fill.
+ *      - const HouseGenSpecType *spec: The generator settings.
+ * Return: None
+ ********************************************************************************************/
+static void generateTree(HouseLayoutType *layout, const HouseGenSpecType *spec) {
+    int next = 1;
+
+    for (int parent = 0; parent < next && next < layout->roomCount; parent++) {
+        int children = drawBranching(spec);
+        if (children < 1 && parent == next - 1) {
+            children = 1;
+        }
+
+        for (int c = 0; c < children && next < layout->roomCount; c++) {
+            addLayoutEdge(layout, parent, next++);
+        }
+    }
+}
+
+/* *******************************************************************************************
+ * Function: void generateGeometric(HouseLayoutType *layout, const HouseGenSpecType *spec)
+ * Description: This function scatters the rooms in the unit square and connects every pair
+ *              closer than the radius that gives the requested mean degree. Rooms are bucketed
+ *              in cells of that radius so generation stays linear in the number of rooms.
+ * Parameters:
+ *      - HouseLayoutType *layout: The layout to fill.
+ *      - const HouseGenSpecType *spec: The generator settings.
+ * Return: None
+ ********************************************************************************************/
+static void generateGeometric(HouseLayoutType *layout, const HouseGenSpecType *spec) {
+    int n = layout->roomCount;
+    double radius = sqrt(spec->degree / (M_PI * n));
+    int cells = radius >= 1.0 ? 1 : (int)(1.0 / radius);
+    if (cells > 4096) {
+        cells = 4096;
+    }
+
+    float *x = malloc((size_t)n * sizeof(float));
+    float *y = malloc((size_t)n * sizeof(float));
+    int *cellStart = calloc((size_t)cells * cells + 1, sizeof(int));
+    int *order = malloc((size_t)n * sizeof(int));
+
+    for (int i = 0; i < n; i++) {
+        x[i] = randFloat(0.0f, 1.0f);
+        y[i] = randFloat(0.0f, 1.0f);
+        int cell = (int)(y[i] * cells) * cells + (int)(x[i] * cells);
+        cellStart[cell + 1]++;
+    }
+    for (int c = 0; c < cells * cells; c++) {
+        cellStart[c + 1] += cellStart[c];
+    }
+
+    int *fill = malloc((size_t)cells * cells * sizeof(int));
+    memcpy(fill, cellStart, (size_t)cells * cells * sizeof(int));
+    for (int i = 0; i < n; i++) {
+        int cell = (int)(y[i] * cells) * cells + (int)(x[i] * cells);
+        order[fill[cell]++] = i;
+    }
+
+    double radiusSquared = radius * radius;
+    for (int i = 0; i < n; i++) {
+        int cx = (int)(x[i] * cells);
+        int cy = (int)(y[i] * cells);
+
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                int nx = cx + dx, ny = cy + dy;
+                if (nx < 0 || ny < 0 || nx >= cells || ny >= cells) {
+                    continue;
+                }
+
+                int cell = ny * cells + nx;
+                for (int k = cellStart[cell]; k < cellStart[cell + 1]; k++) {
+                    int j = order[k];
+                    double ddx = x[i] - x[j], ddy = y[i] - y[j];
+                    if (j > i && ddx * ddx + ddy * ddy <= radiusSquared) {
+                        addLayoutEdge(layout, i, j);
+                    }
+                }
+            }
+        }
+    }
+
+    free(x);
+    free(y);
+    free(cellStart);
+    free(order);
+    free(fill);
+}
+
+/* *******************************************************************************************
+ * Function: void generateSmallWorld(HouseLayoutType *layout, const HouseGenSpecType *spec)
+ * Description: This function builds a Watts-Strogatz small world: a ring where every room is
+ *              connected to its degree/2 nearest rooms on each side, after which every edge is
+ *              rewired to a random room with probability spec->rewire (never creating a loop or
+ *              a duplicate connection).
+ * Parameters:
+ *      - HouseLayoutType *layout: The layout to fill.
+ *      - const HouseGenSpecType *spec: The generator settings.
+ * Return: None
+ ********************************************************************************************/
+static void generateSmallWorld(HouseLayoutType *layout, const HouseGenSpecType *spec) {
+    int n = layout->roomCount;
+    int half = (int)(spec->degree / 2.0 + 0.5);
+    if (half < 1) {
+        half = 1;
+    }
+    if (half > (n - 1) / 2) {
+        half = (n - 1) / 2;
+    }
+
+    EdgeSetType set;
+    set.capacity = 1;
+    while (set.capacity < (size_t)n * half * 2) {
+        set.capacity <<= 1;
+    }
+    set.keys = calloc(set.capacity, sizeof(uint64_t));
+
+    for (int i = 0; i < n; i++) {
+        for (int k = 1; k <= half; k++) {
+            int j = (i + k) % n;
+
+            if (randFloat(0.0f, 1.0f) < spec->rewire) {
+                for (int attempt = 0; attempt < 8; attempt++) {
+                    int candidate = randInt(0, n);
+                    if (candidate != i && insertEdge(&set, i, candidate)) {
+                        addLayoutEdge(layout, i, candidate);
+                        break;
+                    }
+                }
+            } else if (insertEdge(&set, i, j)) {
+                addLayoutEdge(layout, i, j);
+            }
+        }
+    }
+
+    free(set.keys);
+}
+
+/* *******************************************************************************************
+ * Function: int generateHouseLayout(HouseLayoutType *layout, const HouseGenSpecType *spec)
+ * Description: This function generates a stress test floor plan (grid, tree, random geometric
+ *              or small world) with spec->rooms rooms, drawing from the calling thread's bound
+ *              generator. Room 0 is the van and every layout is made connected.
+ * Parameters:
+ *      - HouseLayoutType *layout: The layout to fill.
+ *      - const HouseGenSpecType *spec: The generator settings.
+ * Return: C_TRUE on success, C_FALSE for an unknown generator or a house of less than two rooms.
+ ********************************************************************************************/
+int generateHouseLayout(HouseLayoutType *layout, const HouseGenSpecType *spec) {
+    if (spec->rooms < 2) {
+        fprintf(stderr, "A generated house needs at least two rooms\n");
+        return C_FALSE;
+    }
+
+    initHouseLayout(layout, spec->rooms);
+
+    switch (spec->kind) {
+        case HOUSE_GRID:
+            generateGrid(layout, spec);
+            break;
+        case HOUSE_TREE:
+            generateTree(layout, spec);
+            break;
+        case HOUSE_GEOMETRIC:
+            generateGeometric(layout, spec);
+            break;
+        case HOUSE_SMALL_WORLD:
+            generateSmallWorld(layout, spec);
+            break;
+        default:
+            fprintf(stderr, "Unknown house generator\n");
+            return C_FALSE;
+    }
+
+    connectComponents(layout);
+    return C_TRUE;
+}
+
+/* *******************************************************************************************
+ * Function: int parseHouseKind(const char *name)
+ * Description: This function maps a generator name to its HouseKindType.
+ * Parameters:
+ *      - const char *name: "grid", "tree", "geometric" or "smallworld".
+ * Return: The generator kind, or HOUSE_FIXED if the name is unknown.
+ ********************************************************************************************/
+int parseHouseKind(const char *name) {
+    const char *kinds[] = {"fixed", "grid", "tree", "geometric", "smallworld"};
+
+    for (int i = 0; i < (int)(sizeof(kinds) / sizeof(kinds[0])); i++) {
+        if (strcmp(name, kinds[i]) == 0) {
+            return i;
+        }
+    }
+
+    return HOUSE_FIXED;
+}
+
+/* *******************************************************************************************
+ * Function: int parseDegreeDistribution(const char *name)
+ * Description: This function maps a distribution name to its DegreeDistributionType.
+ * Parameters:
+ *      - const char *name: "fixed", "uniform" or "powerlaw".
+ * Return: The distribution, DEGREE_FIXED if the name is unknown.
+ ********************************************************************************************/
+int parseDegreeDistribution(const char *name) {
+    if (strcmp(name, "uniform") == 0) {
+        return DEGREE_UNIFORM;
+    }
+    if (strcmp(name, "powerlaw") == 0) {
+        return DEGREE_POWER_LAW;
+    }
+    return DEGREE_FIXED;
+}
+
+/* *******************************************************************************************
+ * Function: int saveHouseLayout(const HouseLayoutType *layout, const char *path)
+ * Description: This function writes a layout as text: a "PPHOUSE 1" line, the room and edge
+ *              counts, one room name per line and one "a b" pair per connection.
+ * Parameters:
+ *      - const HouseLayoutType *layout: The layout to save.
+ *      - const char *path: The file to write.
+ * Return: C_TRUE on success, C_FALSE otherwise.
+ ********************************************************************************************/
+int saveHouseLayout(const HouseLayoutType *layout, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        perror("Failed to open house file for writing");
+        return C_FALSE;
+    }
+
+    fprintf(file, "%s %d\n%d %d\n", LAYOUT_MAGIC, LAYOUT_VERSION, layout->roomCount, layout->edgeCount);
+
+    for (int i = 0; i < layout->roomCount; i++) {
+        char name[MAX_STR];
+        layoutRoomName(layout, i, name);
+        fprintf(file, "%s\n", name);
+    }
+
+    for (int e = 0; e < layout->edgeCount; e++) {
+        fprintf(file, "%d %d\n", layout->edges[2 * e], layout->edges[2 * e + 1]);
+    }
+
+    if (fclose(file) != 0) {
+        perror("Failed to write house file");
+        return C_FALSE;
+    }
+
+    return C_TRUE;
+}
+
+/* *******************************************************************************************
+ * Function: int checkLayoutReachable(const HouseLayoutType *layout, const char *path)
+ * Description: This function checks that a loaded layout can be played: no room connects to
+ *              itself and every room can be reached from the van, so no agent ever stands in a
+ *              room without a way out. Generated layouts are repaired by connectComponents
+ *              instead; a house file is taken as written.
+ * Parameters:
+ *      - const HouseLayoutType *layout: The layout.
+ *      - const char *path: The file it came from, for the error message.
+ * Return: C_TRUE if it can be played, C_FALSE otherwise.
+ ********************************************************************************************/
+static int checkLayoutReachable(const HouseLayoutType *layout, const char *path) {
+    if (layout->roomCount < 2) {
+        fprintf(stderr, "[%s] needs a room connected to the van\n", path);
+        return C_FALSE;
+    }
+
+    int *parent = malloc((size_t)layout->roomCount * sizeof(int));
+    if (parent == NULL) {
+        perror("Failed to allocate memory for house rooms");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < layout->roomCount; i++) {
+        parent[i] = i;
+    }
+
+    int valid = C_TRUE;
+    for (int e = 0; e < layout->edgeCount; e++) {
+        if (layout->edges[2 * e] == layout->edges[2 * e + 1]) {
+            fprintf(stderr, "[%s] connects room %d to itself\n", path, layout->edges[2 * e]);
+            valid = C_FALSE;
+            break;
+        }
+
+        int a = findRoot(parent, layout->edges[2 * e]);
+        int b = findRoot(parent, layout->edges[2 * e + 1]);
+        if (a != b) {
+            parent[a] = b;
+        }
+    }
+
+    for (int i = 1; i < layout->roomCount && valid; i++) {
+        if (findRoot(parent, i) != findRoot(parent, 0)) {
+            fprintf(stderr, "[%s] has room %d, which cannot be reached from the van\n", path, i);
+            valid = C_FALSE;
+        }
+    }
+
+    free(parent);
+    return valid;
+}
+
+/* *******************************************************************************************
+ * Function: int loadHouseLayout(HouseLayoutType *layout, const char *path)
+ * Description: This function reads a layout written by saveHouseLayout. A layout with a
+ *              room connected to itself, or one that cannot be reached from the van, is refused.
+ * Parameters:
+ *      - HouseLayoutType *layout: The layout to fill.
+ *      - const char *path: The file to read.
+ * Return: C_TRUE on success, C_FALSE if the file is missing or malformed.
+ ********************************************************************************************/
+int loadHouseLayout(HouseLayoutType *layout, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror("Failed to open house file");
+        return C_FALSE;
+    }
+
+    char magic[16];
+    int version, roomCount, edgeCount;
+    if (fscanf(file, "%15s %d %d %d", magic, &version, &roomCount, &edgeCount) != 4 ||
+        strcmp(magic, LAYOUT_MAGIC) != 0 || version != LAYOUT_VERSION || roomCount < 1 || edgeCount < 0) {
+        fprintf(stderr, "[%s] is not a PhantomPulse house file\n", path);
+        fclose(file);
+        return C_FALSE;
+    }
+
+    initHouseLayout(layout, roomCount);
+    layout->names = malloc((size_t)roomCount * sizeof(*layout->names));
+    if (layout->names == NULL) {
+        perror("Failed to allocate memory for room names");
+        exit(EXIT_FAILURE);
+    }
+
+    fgetc(file);
+    for (int i = 0; i < roomCount; i++) {
+        if (fgets(layout->names[i], MAX_STR, file) == NULL) {
+            fprintf(stderr, "[%s] is missing room names\n", path);
+            fclose(file);
+            releaseHouseLayout(layout);
+            return C_FALSE;
+        }
+        layout->names[i][strcspn(layout->names[i], "\n")] = '\0';
+    }
+
+    for (int e = 0; e < edgeCount; e++) {
+        int a, b;
+        if (fscanf(file, "%d %d", &a, &b) != 2 || a < 0 || b < 0 || a >= roomCount || b >= roomCount) {
+            fprintf(stderr, "[%s] has an invalid connection\n", path);
+            fclose(file);
+            releaseHouseLayout(layout);
+            return C_FALSE;
+        }
+        addLayoutEdge(layout, a, b);
+    }
+
+    fclose(file);
+
+    if (!checkLayoutReachable(layout, path)) {
+        releaseHouseLayout(layout);
+        return C_FALSE;
+    }
+
+    return C_TRUE;
+}
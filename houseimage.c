@@ -0,0 +1,359 @@
+#include "defs.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#define IMAGE_MAGIC   "PPIMAGE"
+#define IMAGE_VERSION 1
+
+/*
+ * On-disk layout (native byte order, every section CACHE_LINE aligned):
+ *   HouseImageHeaderType
+ *   int32_t   first[roomCount + 1]            (where each room's slice of adjacency starts)
+ *   int32_t   adjacency[connectionCount]      (room ids, each room's connected slice in turn)
+ *   char      names[roomCount][MAX_STR]
+ *   uint16_t  nextHop[roomCount * roomCount]  (houses of up to SEARCH_TABLE_MAX_ROOMS rooms)
+ *   uint16_t  distance[roomCount * roomCount]
+ * Sections are located by their offset from the start of the file and hold no pointers, so the
+ * image can be mapped at any address and used in place.
+ */
+typedef struct HouseImageHeaderType {
+    char magic[8];
+    uint32_t version;
+    int32_t roomCount;
+    int32_t connectionCount;
+    int32_t padding;
+    uint64_t size;
+    uint64_t firstOffset;
+    uint64_t adjacencyOffset;
+    uint64_t namesOffset;
+    uint64_t nextHopOffset;
+    uint64_t distanceOffset;
+} HouseImageHeaderType;
+
+/* *******************************************************************************************
+ * Function: uint64_t placeSection(uint64_t *end, uint64_t bytes)
+ * Description: This function reserves the next CACHE_LINE aligned section of an image.
+ * Parameters:
+ *      - uint64_t *end: The end of the image so far, moved past the section.
+ *      - uint64_t bytes: The size of the section.
+ * Return: The offset of the section.
+ ********************************************************************************************/
+static uint64_t placeSection(uint64_t *end, uint64_t bytes) {
+    uint64_t offset = (*end + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    *end = offset + bytes;
+    return offset;
+}
+
+/* *******************************************************************************************
+ * Function: int compileHouseImage(const HouseLayoutType *layout, const char *path)
+ * Description: This function compiles a layout into a house image: its topology is built once
+ *              exactly as a run would build it, so the image lists every room's connections
+ *              in the same order, and small houses get their search tables precomputed.
+ * Parameters:
+ *      - const HouseLayoutType *layout: The layout to compile.
+ *      - const char *path: The image file to write.
+ * Return: C_TRUE on success, C_FALSE otherwise.
+ ********************************************************************************************/
+int compileHouseImage(const HouseLayoutType *layout, const char *path) {
+    HouseTopologyType topology;
+    RunArenaType arena;
+    initRunArena(&arena);
+    buildTopologyFromLayout(&topology, &arena, layout, C_TRUE);
+
+    int n = topology.roomCount;
+    int connections = topology.connectionCount;
+    int withTables = topology.nextHop != NULL;
+
+    HouseImageHeaderType header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+    header.version = IMAGE_VERSION;
+    header.roomCount = n;
+    header.connectionCount = connections;
+
+    uint64_t end = sizeof(header);
+    header.firstOffset = placeSection(&end, ((uint64_t)n + 1) * sizeof(int32_t));
+    header.adjacencyOffset = placeSection(&end, (uint64_t)connections * sizeof(int32_t));
+    header.namesOffset = placeSection(&end, (uint64_t)n * MAX_STR);
+    if (withTables) {
+        header.nextHopOffset = placeSection(&end, (uint64_t)n * n * sizeof(uint16_t));
+        header.distanceOffset = placeSection(&end, (uint64_t)n * n * sizeof(uint16_t));
+    }
+    header.size = end;
+
+    char *image = calloc(1, header.size);
+    if (image == NULL) {
+        perror("Failed to allocate house image");
+        exit(EXIT_FAILURE);
+    }
+
+    memcpy(image, &header, sizeof(header));
+
+    int32_t *first = (int32_t *)(image + header.firstOffset);
+    int32_t *adjacency = (int32_t *)(image + header.adjacencyOffset);
+    char (*names)[MAX_STR] = (char (*)[MAX_STR])(image + header.namesOffset);
+
+    for (int r = 0; r < n; r++) {
+        const RoomTopologyType *room = &topology.rooms[r];
+        first[r + 1] = first[r] + room->connectedCount;
+
+        memcpy(adjacency + first[r], room->connected, (size_t)room->connectedCount * sizeof(int32_t));
+        strncpy(names[r], room->name, MAX_STR - 1);
+    }
+
+    if (withTables) {
+        memcpy(image + header.nextHopOffset, topology.nextHop, (size_t)n * n * sizeof(uint16_t));
+        memcpy(image + header.distanceOffset, topology.distance, (size_t)n * n * sizeof(uint16_t));
+    }
+
+    releaseRunArena(&arena);
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        perror("Failed to open house image for writing");
+        free(image);
+        return C_FALSE;
+    }
+
+    int written = fwrite(image, header.size, 1, file) == 1;
+    free(image);
+
+    if (fclose(file) != 0 || !written) {
+        perror("Failed to write house image");
+        return C_FALSE;
+    }
+
+    return C_TRUE;
+}
+
+/* *******************************************************************************************
+ * Function: int sectionFits(const HouseImageHeaderType *header, uint64_t offset, uint64_t bytes)
+ * Description: This function checks that a section lies inside the image and is aligned.
+ * Parameters:
+ *      - const HouseImageHeaderType *header: The image header.
+ *      - uint64_t offset: The offset of the section.
+ *      - uint64_t bytes: The size of the section.
+ * Return: C_TRUE if it does, C_FALSE otherwise.
+ ********************************************************************************************/
+static int sectionFits(const HouseImageHeaderType *header, uint64_t offset, uint64_t bytes) {
+    return offset >= sizeof(*header) && offset % CACHE_LINE == 0 && offset <= header->size &&
+           bytes <= header->size - offset;
+}
+
+/* *******************************************************************************************
+ * Function: int checkImageRooms(const HouseImageType *image, const HouseImageHeaderType *header)
+ * Description: This function checks what a run will walk, once the adjacency is known to hold
+ *              rooms: no room is connected to itself, every room can be reached from the van
+ *              (so every room has a way out), and every next hop is the room itself (for its
+ *              own destination) or one of its connections.
+ * Parameters:
+ *      - const HouseImageType *image: The image, with its sections located.
+ *      - const HouseImageHeaderType *header: The image header.
+ * Return: C_TRUE if the rooms can be played, C_FALSE otherwise.
+ ********************************************************************************************/
+static int checkImageRooms(const HouseImageType *image, const HouseImageHeaderType *header) {
+    int n = image->roomCount;
+    int *marks = calloc((size_t)n, sizeof(int));
+    int *queue = malloc((size_t)n * sizeof(int));
+
+    if (marks == NULL || queue == NULL) {
+        perror("Failed to allocate memory for house image rooms");
+        exit(EXIT_FAILURE);
+    }
+
+    // Breadth-first from the van; marks[r] is 1 once room r is reached
+    int valid = C_TRUE;
+    int head = 0;
+    int tail = 0;
+
+    queue[tail++] = 0;
+    marks[0] = 1;
+    while (head < tail && valid) {
+        int u = queue[head++];
+
+        for (int e = image->first[u]; e < image->first[u + 1]; e++) {
+            int v = image->adjacency[e];
+            if (v == u) {
+                valid = C_FALSE;
+                break;
+            }
+            if (!marks[v]) {
+                marks[v] = 1;
+                queue[tail++] = v;
+            }
+        }
+    }
+
+    if (tail < n) {
+        valid = C_FALSE;
+    }
+
+    // marks[r] becomes from + 2 while checking the next hops out of room from
+    for (int from = 0; from < n && valid && header->nextHopOffset != 0; from++) {
+        for (int e = image->first[from]; e < image->first[from + 1]; e++) {
+            marks[image->adjacency[e]] = from + 2;
+        }
+
+        for (int to = 0; to < n; to++) {
+            int hop = image->nextHop[(size_t)from * n + to];
+            if ((to == from) ? hop != from : marks[hop] != from + 2) {
+                valid = C_FALSE;
+                break;
+            }
+        }
+    }
+
+    free(marks);
+    free(queue);
+    return valid;
+}
+
+/* *******************************************************************************************
+ * Function: int validateHouseImage(const HouseImageType *image, const HouseImageHeaderType *header)
+ * Description: This function checks everything a run will index with: the slices cover the
+ *              adjacency in order, every connection and next hop is a room, and every name ends.
+ *              The rooms must then pass checkImageRooms, so a corrupt image is refused rather
+ *              than crashing a run or moving agents between rooms that are not connected.
+ * Parameters:
+ *      - const HouseImageType *image: The image, with its sections located.
+ *      - const HouseImageHeaderType *header: The image header.
+ * Return: C_TRUE if the image is usable, C_FALSE otherwise.
+ ********************************************************************************************/
+static int validateHouseImage(const HouseImageType *image, const HouseImageHeaderType *header) {
+    int n = image->roomCount;
+
+    if (image->first[0] != 0 || image->first[n] != image->connectionCount) {
+        return C_FALSE;
+    }
+
+    for (int r = 0; r < n; r++) {
+        if (image->first[r + 1] < image->first[r] || memchr(image->names[r], '\0', MAX_STR) == NULL) {
+            return C_FALSE;
+        }
+    }
+
+    for (int e = 0; e < image->connectionCount; e++) {
+        if (image->adjacency[e] < 0 || image->adjacency[e] >= n) {
+            return C_FALSE;
+        }
+    }
+
+    if (header->nextHopOffset != 0) {
+        for (size_t i = 0; i < (size_t)n * n; i++) {
+            if (image->nextHop[i] >= n) {
+                return C_FALSE;
+            }
+        }
+    }
+
+    return checkImageRooms(image, header);
+}
+
+/* *******************************************************************************************
+ * Function: int loadHouseImage(HouseImageType *image, const char *path)
+ * Description: This function maps a house image read-only and checks it. The mapping stays
+ *              until releaseHouseImage; every house built from it reads it in place.
+ * Parameters:
+ *      - HouseImageType *image: Filled with the mapping and its sections.
+ *      - const char *path: The image file.
+ * Return: C_TRUE on success, C_FALSE if the file is missing or not a valid image.
+ ********************************************************************************************/
+int loadHouseImage(HouseImageType *image, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open house image");
+        return C_FALSE;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(HouseImageHeaderType)) {
+        fprintf(stderr, "[%s] is not a PhantomPulse house image\n", path);
+        close(fd);
+        return C_FALSE;
+    }
+
+    void *base = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (base == MAP_FAILED) {
+        perror("Failed to map house image");
+        return C_FALSE;
+    }
+
+    const HouseImageHeaderType *header = base;
+    uint64_t n = (header->roomCount > 0) ? (uint64_t)header->roomCount : 0;
+    uint64_t connections = (header->connectionCount >= 0) ? (uint64_t)header->connectionCount : 0;
+    int withTables = header->nextHopOffset != 0 || header->distanceOffset != 0;
+
+    int valid = memcmp(header->magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) == 0 && header->version == IMAGE_VERSION &&
+                header->size == (uint64_t)info.st_size && n >= 1 && n <= INT32_MAX / 2 &&
+                header->connectionCount >= 0 &&
+                sectionFits(header, header->firstOffset, (n + 1) * sizeof(int32_t)) &&
+                sectionFits(header, header->adjacencyOffset, connections * sizeof(int32_t)) &&
+                sectionFits(header, header->namesOffset, n * MAX_STR) &&
+                (!withTables || (n <= SEARCH_TABLE_MAX_ROOMS &&
+                                 sectionFits(header, header->nextHopOffset, n * n * sizeof(uint16_t)) &&
+                                 sectionFits(header, header->distanceOffset, n * n * sizeof(uint16_t))));
+
+    if (valid) {
+        const char *bytes = base;
+        image->base = base;
+        image->size = info.st_size;
+        image->roomCount = (int)n;
+        image->connectionCount = (int)connections;
+        image->first = (const int32_t *)(bytes + header->firstOffset);
+        image->adjacency = (const int32_t *)(bytes + header->adjacencyOffset);
+        image->names = (const char (*)[MAX_STR])(bytes + header->namesOffset);
+        image->nextHop = withTables ? (const uint16_t *)(bytes + header->nextHopOffset) : NULL;
+        image->distance = withTables ? (const uint16_t *)(bytes + header->distanceOffset) : NULL;
+        valid = validateHouseImage(image, header);
+    }
+
+    if (!valid) {
+        fprintf(stderr, "[%s] is not a valid PhantomPulse house image\n", path);
+        munmap(base, info.st_size);
+        return C_FALSE;
+    }
+
+    return C_TRUE;
+}
+
+/* *******************************************************************************************
+ * Function: void releaseHouseImage(HouseImageType *image)
+ * Description: This function unmaps a house image once no house built from it is left.
+ * Parameters:
+ *      - HouseImageType *image: The image.
+ * Return: None
+ ********************************************************************************************/
+void releaseHouseImage(HouseImageType *image) {
+    munmap((void *)image->base, image->size);
+    image->base = NULL;
+}
+
+/* *******************************************************************************************
+ * Function: void buildTopologyFromImage(HouseTopologyType *topology, RunArenaType *arena, const HouseImageType *image)
+ * Description: This function builds the topology of a house image with no parsing: names,
+ *              connections and search tables are read in place from the mapping, and only the
+ *              room records pointing into it come from the arena.
+ * Parameters:
+ *      - HouseTopologyType *topology: The topology to fill.
+ *      - RunArenaType *arena: The arena for the room records.
+ *      - const HouseImageType *image: The mapped image, kept mapped while the topology is used.
+ * Return: None
+ ********************************************************************************************/
+void buildTopologyFromImage(HouseTopologyType *topology, RunArenaType *arena, const HouseImageType *image) {
+    RoomTopologyType *rooms = arenaAlloc(arena, (size_t)image->roomCount * sizeof(RoomTopologyType), CACHE_LINE);
+
+    for (int r = 0; r < image->roomCount; r++) {
+        rooms[r].name = image->names[r];
+        rooms[r].connected = image->adjacency + image->first[r];
+        rooms[r].connectedCount = image->first[r + 1] - image->first[r];
+    }
+
+    topology->roomCount = image->roomCount;
+    topology->connectionCount = image->connectionCount;
+    topology->rooms = rooms;
+    topology->nextHop = image->nextHop;
+    topology->distance = image->distance;
+}
@@ -1,9 +1,9 @@
 #include "defs.h"
 
 /* *******************************************************************************************
- * Function: void initializeHunter(char* name, RoomType *room, int uniqueRandomTool, int restDuration, HunterType **hunter)
+ * Function: void initializeHunter(char* name, RoomType *room, int uniqueRandomTool, int restDuration, RunArenaType *arena, HunterType **hunter)
  * Description: This function initializes a HunterType structure with the provided parameters. It allocates
- *              memory for the hunter, copies the name, generates random evidence, assigns the room, allocates
+ *              cache-line aligned memory for the hunter from the run arena, copies the name, generates random evidence, assigns the room, allocates
  *              and initializes a ghostEvidence list, and initializes fear, boredom timer, and rest duration.
  *              The initialized hunter is assigned to the pointer passed as an argument.
  * Parameters:
@@ -11,13 +11,15 @@
  *      - RoomType *room: A pointer to the RoomType representing the initial room of the hunter.
  *      - int uniqueRandomTool: An integer representing a unique random tool for the hunter.
  *      - int restDuration: An integer representing the rest duration of the hunter.
+ *      - RunArenaType *arena: The run arena the hunter and its evidence list are allocated from.
  *      - HunterType **hunter: A pointer to a pointer that will be assigned the initialized hunter.
  * Return: None
  * CHATGPT ACCESSED DECEMBER 2ND 2023
  ********************************************************************************************/
-void initializeHunter(char* name, RoomType *room, int uniqueRandomTool, int restDuration, HunterType **hunter) {
-    HunterType *hunterPointer = (HunterType*) malloc(sizeof(HunterType));
+void initializeHunter(char* name, RoomType *room, int uniqueRandomTool, int restDuration, RunArenaType *arena, HunterType **hunter) {
+    HunterType *hunterPointer = (HunterType*) arenaAlloc(arena, sizeof(HunterType), CACHE_LINE);
 
+    hunterPointer->id = 0;
     strcpy(hunterPointer->name, name);
 
     hunterPointer->evidence = (EvidenceClassType) uniqueRandomTool;
@@ -25,13 +27,24 @@ void initializeHunter(char* name, RoomType *room, int uniqueRandomTool, int rest
     hunterPointer->room = room;
 
     
-    GhostEvidenceListType *evidenceListPtr = (GhostEvidenceListType*) malloc(sizeof(GhostEvidenceListType));
+    GhostEvidenceListType *evidenceListPtr = (GhostEvidenceListType*) arenaAlloc(arena, sizeof(GhostEvidenceListType), _Alignof(GhostEvidenceListType));
     initializeEvidence(evidenceListPtr);
     hunterPointer->ghostEvidence = evidenceListPtr;
     
     hunterPointer->fear = 0;
     hunterPointer->timer = BOREDOM_MAX;
     hunterPointer->restDuration = restDuration;
+    hunterPointer->evidenceCollected = 0;
+    hunterPointer->steps = 0;
+    hunterPointer->done = C_FALSE;
+    hunterPointer->idle = C_FALSE;
+    hunterPointer->wakeSeen = 0;
+    hunterPointer->house = NULL;
+    hunterPointer->routeTarget = 0;
+    hunterPointer->routeLength = 0;
+    hunterPointer->routeCapacity = 0;
+    hunterPointer->route = NULL;
+    seedRng(&hunterPointer->rng, (uint64_t)time(NULL) ^ (uintptr_t)hunterPointer);
 
     *hunter = hunterPointer; 
 }  
@@ -51,21 +64,27 @@ void initializeEvidence(GhostEvidenceListType* list) {
 
 
 /* *******************************************************************************************
- * Function: void initListOfHunters(HunterListType *list)
+ * Function: void initListOfHunters(HunterListType *list, RunArenaType *arena)
  * Description: This function initializes a HunterListType structure by setting the size of the hunter
- *              list to 0.
+ *              list to 0 and allocating room for MAX_HUNTERS hunters from the run arena, which the
+ *              list keeps growing from.
  * Parameters:
  *      - HunterListType *list: A pointer to the HunterListType structure to be initialized.
+ *      - RunArenaType *arena: The run arena.
  * Return: None
  * CHATGPT ACCESSED DECEMBER 2ND 2023
  ********************************************************************************************/
-void initListOfHunters(HunterListType *list) {
+void initListOfHunters(HunterListType *list, RunArenaType *arena) {
     list->size = 0;
+    list->capacity = MAX_HUNTERS;
+    list->arena = arena;
+    list->hunterList = arenaAlloc(arena, MAX_HUNTERS * sizeof(HunterType *), _Alignof(HunterType *));
 }
 
 /* *******************************************************************************************
  * Function: bool appendHunterToList(HunterListType *hunters, HunterType *hunter)
- * Description: This function appends a hunter to a HunterListType structure if there is space.
+ * Description: This function appends a hunter to a HunterListType structure, doubling the list
+ *              when it is full. Room capacity is enforced by assignHunterToRoom, not here.
  *              It returns true if the hunter is added successfully; otherwise, it returns false.
  * Parameters:
  *      - HunterListType *hunters: A pointer to the HunterListType structure.
@@ -75,11 +94,14 @@ void initListOfHunters(HunterListType *list) {
  ********************************************************************************************/
 
 bool appendHunterToList(HunterListType *hunters, HunterType *hunter) {
-    bool addedSuccessfully = (hunters->size < MAX_HUNTERS);
-    if (addedSuccessfully) {
-        hunters->hunterList[hunters->size++] = hunter;
+    if (hunters->size == hunters->capacity) {
+        hunters->hunterList = arenaGrow(hunters->arena, hunters->hunterList, hunters->capacity * sizeof(HunterType *),
+                                        2 * hunters->capacity * sizeof(HunterType *), _Alignof(HunterType *));
+        hunters->capacity *= 2;
     }
-    return addedSuccessfully;
+
+    hunters->hunterList[hunters->size++] = hunter;
+    return true;
 }
 
 
@@ -89,52 +111,177 @@ bool appendHunterToList(HunterListType *hunters, HunterType *hunter) {
  *              The hunter thread sleeps for a specified rest duration, then performs a random action
  *              such as searching for evidence, roaming around, or communicating with other hunters.
  *              The thread continues these actions until it either finds evidence, reaches maximum fear,
- *              or the boredom timer reaches zero.
+ *              the boredom timer reaches zero, or the house reports that the game is over. With
+ *              --wake event an idle hunter parks in its room instead, until something happens there
+ *              or WAKE_IDLE_TURNS rests have passed. With --coroutines it runs as a coroutine and
+ *              its rests yield to the scheduler.
  * Parameters:
  *      - void *arg: A pointer to the HunterType structure representing the hunter.
  * Return: NULL
  * CHATGPT ACCESSED DECEMBER 2ND 2023
  ********************************************************************************************/
 void *hunterThread(void *arg) {
-    srand(time(NULL));
-
     HunterType *threadHunter = (HunterType*)arg;
+    bindRng(&threadHunter->rng);
+    profileStart(PROFILE_HUNTER);
 
-    int action;
     do {
-        struct timespec sleepTime;
-        sleepTime.tv_sec = threadHunter->restDuration / 1000;
-        sleepTime.tv_nsec = (threadHunter->restDuration % 1000) * 1000000;
+        PROFILE_TURN();
+
+        if (threadHunter->idle && threadHunter->restDuration > 0) {
+            parkInRoom(threadHunter->room, threadHunter->wakeSeen, WAKE_IDLE_TURNS * threadHunter->restDuration);
+            continue;
+        }
+
+        agentRest((uint64_t)threadHunter->restDuration * 1000000);
+    } while (hunterTurn(threadHunter));
 
-        nanosleep(&sleepTime, NULL);
+    profileStop();
+    telemetryFlush();
+    latencyFlush();
+    releaseSearchScratch();
+    bindRng(NULL);
+    return NULL;
+}
 
-        action = randInt(0, 3);
+/* *******************************************************************************************
+ * Function: int hunterStep(HunterType *threadHunter)
+ * Description: This function performs one action of a hunter (grab evidence, move or review
+ *              evidence with another hunter in the room), updates its fear and reports whether it
+ *              should keep hunting. Engines call it after whatever rest they apply. A hunter that
+ *              was handed to another shard during the move is owned by that shard from then on,
+ *              so nothing else of it is touched.
+ * Parameters:
+ *      - HunterType *threadHunter: The hunter taking its turn.
+ * Return: C_TRUE while the hunter keeps going, C_FALSE once it is done.
+ ********************************************************************************************/
+int hunterStep(HunterType *threadHunter) {
+    threadHunter->steps++;
 
-        if (action == 0) {
-            sem_wait(&(threadHunter->room->semaphore));
-            grabEvidence(threadHunter);
-            sem_post(&(threadHunter->room->semaphore));
-        } else if (action == 1) {
-            repositionHunter(threadHunter);
-        } else if (action == 2) {
-            sem_wait(&(threadHunter->room->semaphore));
+    int action = randInt(0, 3);
 
-            if (threadHunter->room->hunters->size > 1) {
-                verifyEvidence(threadHunter);
-            }
+    if (action == 0) {
+        uint64_t started = LATENCY_START();
+        grabEvidence(threadHunter);
+        LATENCY_RECORD(LATENCY_GRAB_EVIDENCE, started);
+    } else if (action == 1) {
+        uint64_t started = LATENCY_START();
+        int moved = repositionHunter(threadHunter);
+        LATENCY_RECORD(LATENCY_REPOSITION, started);
 
-            sem_post(&(threadHunter->room->semaphore));
+        if (moved == C_HANDED_OFF) {
+            return C_TRUE;
         }
+    } else if (action == 2) {
+        lockRoom(threadHunter->room);
 
-        if (didHunterFindGhost(threadHunter)) {
-            threadHunter->fear++;
-            threadHunter->timer = BOREDOM_MAX;
+        if (threadHunter->room->hunterCount > 1) {
+            uint64_t started = LATENCY_START();
+            verifyEvidence(threadHunter);
+            LATENCY_RECORD(LATENCY_VERIFY_EVIDENCE, started);
         }
 
-    } while (!(containsEvidence(threadHunter) || (threadHunter->fear >= 100) || (threadHunter->timer <= 0)));
+        unlockRoom(threadHunter->room);
+    }
 
-    rerepositionHunter(threadHunter, true);
-    return NULL;
+    if (didHunterFindGhost(threadHunter)) {
+        threadHunter->fear++;
+        threadHunter->timer = BOREDOM_MAX;
+    }
+
+    TELEMETRY_COUNT(agentSteps, 1);
+    telemetryHunter(threadHunter);
+
+    PROFILE_PHASE(PROFILE_CHECK);
+    return hunterKeepsHunting(threadHunter);
+}
+
+/* *******************************************************************************************
+ * Function: int hunterKeepsHunting(HunterType *hunter)
+ * Description: This function decides, at the end of a hunter's step, whether it goes on: it
+ *              stops once it holds enough ghostly evidence, is too afraid or too bored, or the
+ *              game is over.
+ * Parameters:
+ *      - HunterType *hunter: The hunter.
+ * Return: C_TRUE while the hunter keeps going, C_FALSE once it is done.
+ ********************************************************************************************/
+int hunterKeepsHunting(HunterType *hunter) {
+    return !(containsEvidence(hunter) || (hunter->fear >= 100) || (hunter->timer <= 0) ||
+             atomic_load(&hunter->house->gameOver));
+}
+
+/* *******************************************************************************************
+ * Function: int isHunterIdle(HunterType *hunter)
+ * Description: This function decides whether a hunter has nothing to do where it stands: the
+ *              ghost is not in its room, no other hunter is there to review evidence with, no
+ *              evidence of its tool is waiting there and directed search knows of none elsewhere.
+ *              The room's wakeSeq is read first, so whatever happens after the decision wakes
+ *              the hunter if it parks.
+ * Parameters:
+ *      - HunterType *hunter: The hunter, at the end of its turn.
+ * Return: C_TRUE if the hunter can park until woken, C_FALSE otherwise.
+ ********************************************************************************************/
+static int isHunterIdle(HunterType *hunter) {
+    RoomType *room = hunter->room;
+    SearchTableType *search = hunter->house->search;
+
+    hunter->wakeSeen = atomic_load(&room->wakeSeq);
+
+    if (room->ghost != NULL || (search != NULL && atomic_load(&search->hinted[hunter->evidence]) > 0)) {
+        return C_FALSE;
+    }
+
+    lockRoom(room);
+    int alone = room->hunterCount <= 1;
+    unlockRoom(room);
+
+    EvidenceChannelType *channel = &room->evidence[hunter->evidence];
+    if (!alone || !beginTakingEvidence(channel)) {
+        return C_FALSE;
+    }
+
+    int empty = settleEvidence(channel) == NULL;
+    endTakingEvidence(channel);
+    return empty;
+}
+
+/* *******************************************************************************************
+ * Function: int hunterTurn(HunterType *hunter)
+ * Description: This function takes one turn of a thread-run hunter: a step, and leaving the
+ *              room if that was its last. With --record or --replay the turn is logged or
+ *              checked as a whole; with --check the house may be validated after it. With
+ *              --wake event it also decides, still within the turn, whether the hunter is idle.
+ * Parameters:
+ *      - HunterType *hunter: The hunter taking its turn.
+ * Return: C_TRUE while the hunter keeps going, C_FALSE once it is done.
+ ********************************************************************************************/
+int hunterTurn(HunterType *hunter) {
+    PROFILE_PHASE(PROFILE_ACTION);
+    beginTurn(hunter->id);
+    enterCheckedTurn();
+
+    int hunting = hunterStep(hunter);
+    if (!hunting) {
+        finishHunter(hunter);
+    } else if (gameOptions.eventWakeups) {
+        hunter->idle = isHunterIdle(hunter);
+    }
+
+    leaveCheckedTurn(hunter->house, hunter->name);
+    endTurn(hunter->id, &hunter->rng);
+    return hunting;
+}
+
+/* *******************************************************************************************
+ * Function: void finishHunter(HunterType *hunter)
+ * Description: This function takes a hunter that stopped hunting out of its room and marks it done.
+ * Parameters:
+ *      - HunterType *hunter: The hunter that finished.
+ * Return: None
+ ********************************************************************************************/
+void finishHunter(HunterType *hunter) {
+    rerepositionHunter(hunter, true);
+    hunter->done = C_TRUE;
 }
 
 
@@ -183,35 +330,26 @@ int containsEvidence(HunterType *currHunter) {
 /* *******************************************************************************************
  * Function: float createStandardValue(EvidenceClassType evidenceLevel)
  * Description: This function creates a standard value based on the given evidence level. It generates
- *              a random value within a specified range for each evidence level. If the evidence level is
- *              not within the expected range, it returns C_MISC_ERROR.
+ *              a random value within the evidence registry's standard range for the level. If the evidence
+ *              level is not within the expected range, it returns C_MISC_ERROR.
  * Parameters:
  *      - EvidenceClassType evidenceLevel: An enumeration representing the level of evidence.
  * Return: A float representing the created standard value or C_MISC_ERROR if an error occurs.
  * CHATGPT ACCESSED DECEMBER 2ND 2023
  ********************************************************************************************/
 float createStandardValue(EvidenceClassType evidenceLevel) {
-    float value;
-
-    if (evidenceLevel == 0) {
-        value = randFloat(0, 4.90);
-    } else if (evidenceLevel == 1) {
-        value = randFloat(0, 27.00);
-    } else if (evidenceLevel == 2) {
-        value = 0;
-    } else if (evidenceLevel == 3) {
-        value = randFloat(40.0, 70.0);
-    } else {
-        value = C_MISC_ERROR;
+    if (evidenceLevel < 0 || evidenceLevel >= EVIDENCE_TYPES) {
+        return C_MISC_ERROR;
     }
 
-    return value;
+    return randFloat(evidenceRegistry[evidenceLevel].standardMin, evidenceRegistry[evidenceLevel].standardMax);
 }
 
 
 /* *******************************************************************************************
  * Function: int removeEvidence(GhostEvidenceListType *list, EvidenceNodeType *evidence)
- * Description: This function removes a specific evidence node from a GhostEvidenceListType structure.
+ * Description: This function removes a specific evidence node from a GhostEvidenceListType structure;
+ *              its memory goes back with the run arena.
  *              It returns C_TRUE if the evidence is successfully removed, C_FALSE otherwise.
  * Parameters:
  *      - GhostEvidenceListType *list: A pointer to the GhostEvidenceListType structure.
@@ -224,27 +362,26 @@ int removeEvidence(GhostEvidenceListType *list, EvidenceNodeType *evidence) {
         return C_FALSE;
     }
 
-    if (evidence == list->head) {
-        list->head = evidence->next;
-    } else {
-        EvidenceNodeType *evidence = list->head;
-        while (evidence->next != NULL && evidence->next != evidence) {
-            evidence = evidence->next;
-        }
+    EvidenceNodeType *previous = NULL;
+    EvidenceNodeType *node = list->head;
+    while (node != NULL && node != evidence) {
+        previous = node;
+        node = node->next;
+    }
 
-        if (evidence->next != NULL) {
-            evidence->next = evidence->next;
+    if (node == NULL) {
+        return C_FALSE;
+    }
 
-            if (evidence == list->tail) {
-                list->tail = evidence;
-            }
-        } else {
-            return C_FALSE;
-        }
+    if (previous == NULL) {
+        list->head = evidence->next;
+    } else {
+        previous->next = evidence->next;
     }
 
-    free(evidence->data);
-    free(evidence);
+    if (evidence == list->tail) {
+        list->tail = previous;
+    }
 
     return C_TRUE;
 }
@@ -257,7 +394,8 @@ int removeEvidence(GhostEvidenceListType *list, EvidenceNodeType *evidence) {
 
 /* *******************************************************************************************
  * Function: int isEvidenceFromGhost(EvidenceType *evidence)
- * Description: This function checks if the given evidence is ghostly based on its category and reading data.
+ * Description: This function checks if the given evidence is ghostly based on its category and reading data,
+ *              using the compiled ghostly range of the evidence registry.
  *              It returns C_TRUE if the evidence is ghostly, C_FALSE otherwise.
  * Parameters:
  *      - EvidenceType *evidence: A pointer to the EvidenceType structure representing the evidence.
@@ -265,32 +403,32 @@ int removeEvidence(GhostEvidenceListType *list, EvidenceNodeType *evidence) {
  * CHATGPT ACCESSED DECEMBER 2ND 2023
  ********************************************************************************************/
 int isEvidenceFromGhost(EvidenceType *evidence) {
-    switch (evidence->evidenceType) {
-        case 0: return (evidence->readingInfo > 4.90 && evidence->readingInfo <= 5.00);
-        case 1: return (evidence->readingInfo >= -10 && evidence->readingInfo < 0);
-        case 2: return (evidence->readingInfo == 1.00);
-        case 3: return (evidence->readingInfo > 70.00 && evidence->readingInfo <= 75.00);
-        default: return C_FALSE; // Considered not ghostly for unknown categories
+    if ((unsigned)evidence->evidenceType >= EVIDENCE_TYPES) {
+        return C_FALSE; // Considered not ghostly for unknown categories
     }
+
+    const EvidenceInfoType *info = &evidenceRegistry[evidence->evidenceType];
+    return (evidence->readingInfo > info->ghostlyAbove) & (evidence->readingInfo <= info->ghostlyUpTo);
 }
 
 /* *******************************************************************************************
- * Function: GhostEvidenceListType* copyEvidence(GhostEvidenceListType *copyList)
+ * Function: GhostEvidenceListType* copyEvidence(GhostEvidenceListType *copyList, RunArenaType *arena)
  * Description: This function creates a copy of a GhostEvidenceListType structure by iterating through
- *              the original list, allocating memory for each evidence and node, and copying the data
- *              to the new list.
+ *              the original list, allocating memory for each evidence and node from the run arena, and
+ *              copying the data to the new list.
  * Parameters:
  *      - GhostEvidenceListType *copyList: A pointer to the GhostEvidenceListType structure to be copied.
+ *      - RunArenaType *arena: The run arena the copy is allocated from.
  * Return: A pointer to the newly created copied list.
  * CHATGPT ACCESSED DECEMBER 2ND 2023
  ********************************************************************************************/
-GhostEvidenceListType* copyEvidence(GhostEvidenceListType *copyList) {
-    GhostEvidenceListType *copyListPointer = (GhostEvidenceListType*)malloc(sizeof(GhostEvidenceListType));
+GhostEvidenceListType* copyEvidence(GhostEvidenceListType *copyList, RunArenaType *arena) {
+    GhostEvidenceListType *copyListPointer = (GhostEvidenceListType*)arenaAlloc(arena, sizeof(GhostEvidenceListType), _Alignof(GhostEvidenceListType));
     initListOfGhosts(copyListPointer);
 
     for (EvidenceNodeType *node = copyList->head; node != NULL; node = node->next) {
-        EvidenceNodeType *tempEvNode = (EvidenceNodeType*)malloc(sizeof(EvidenceNodeType));
-        EvidenceType *tempEvidence = (EvidenceType*)malloc(sizeof(EvidenceType));
+        EvidenceNodeType *tempEvNode = (EvidenceNodeType*)arenaAlloc(arena, sizeof(EvidenceNodeType), _Alignof(EvidenceNodeType));
+        EvidenceType *tempEvidence = (EvidenceType*)arenaAlloc(arena, sizeof(EvidenceType), _Alignof(EvidenceType));
 
         tempEvidence->readingInfo = node->data->readingInfo;
         tempEvidence->evidenceType = node->data->evidenceType;
@@ -325,74 +463,3 @@ int isDuplicate(GhostEvidenceListType *list, EvidenceNodeType *nodeToCheck) {
 
     return C_FALSE;
 }
-
-/* *******************************************************************************************
- * Function: void releaseHunterResources(HunterType *hunter)
- * Description: This function releases resources associated with a HunterType structure by cleaning up
- *              the evidence data and freeing the memory allocated for the hunter.
- * Parameters:
- *      - HunterType *hunter: A pointer to the HunterType structure whose resources need to be released.
- * Return: None
- * CHATGPT ACCESSED DECEMBER 2ND 2023
- ********************************************************************************************/
-void releaseHunterResources(HunterType *hunter) {
-    cleanUpEvidenceData(hunter->ghostEvidence);
-    free(hunter);
-}
-
-/* *******************************************************************************************
- * Function: void cleanUpEvidenceData(GhostEvidenceListType *list)
- * Description: This function iterates through a GhostEvidenceListType structure and frees the memory
- *              associated with the data of each evidence node.
- * Parameters:
- *      - GhostEvidenceListType *list: A pointer to the GhostEvidenceListType structure whose evidence data
- *                                      needs to be cleaned up.
- * Return: None
- * CHATGPT ACCESSED DECEMBER 2ND 2023
- ********************************************************************************************/
-void cleanUpEvidenceData(GhostEvidenceListType *list){
-    // Use a for loop to iterate through the list of evidence nodes
-    for(EvidenceNodeType *node = list->head; node != NULL; node = node->next){
-        // Free the data of each node
-        free(node->data);
-    }
-}
-
-/* *******************************************************************************************
- * Function: void releaseEvidenceNodes(GhostEvidenceListType *list)
- * Description: This function releases all evidence nodes in a GhostEvidenceListType structure by
- *              iterating through the list and freeing the memory for each node.
- * Parameters:
- *      - GhostEvidenceListType *list: A pointer to the GhostEvidenceListType structure whose evidence
- *                                      nodes need to be released.
- * Return: None
- * CHATGPT ACCESSED DECEMBER 2ND 2023
- ********************************************************************************************/
-void releaseEvidenceNodes(GhostEvidenceListType *list) {
-    for (EvidenceNodeType *currNode = list->head; currNode != NULL;) {
-        EvidenceNodeType *nextNode = currNode->next;
-        free(currNode);
-        currNode = nextNode;
-    }
-
-    // After freeing all nodes, set the list's head to NULL
-    list->head = NULL;
-}
-
-
-/* *******************************************************************************************
- * Function: void releaseEvidenceList(GhostEvidenceListType *list)
- * Description: This function releases all resources associated with a GhostEvidenceListType structure,
- *              including cleaning up evidence data, releasing evidence nodes, and freeing the memory
- *              allocated for the list.
- * Parameters:
- *      - GhostEvidenceListType *list: A pointer to the GhostEvidenceListType structure whose resources
- *                                      need to be released.
- * Return: None
- * CHATGPT ACCESSED DECEMBER 2ND 2023
- ********************************************************************************************/
-void releaseEvidenceList(GhostEvidenceListType *list){
-    cleanUpEvidenceData(list);
-    releaseEvidenceNodes(list);
-    free(list);
-}
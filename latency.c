@@ -0,0 +1,224 @@
+#include "defs.h"
+#include <sys/mman.h>
+
+LatencyHistogramsType *latency = NULL;
+
+/* Samples are counted per thread and added to the shared histograms every LATENCY_FLUSH_EVERY
+   samples and when the thread stops, so recording one is a few plain increments. */
+typedef struct LatencyPendingType {
+    uint32_t counts[LATENCY_KINDS][LATENCY_BUCKETS];
+    uint64_t max[LATENCY_KINDS];
+    int samples;
+} LatencyPendingType;
+
+static _Thread_local LatencyPendingType *latencyPending = NULL;
+static pid_t latencyOwner = 0;
+
+static const char *latencyNames[LATENCY_KINDS] = {
+    "run wall", "run cpu", "grabEvidence", "repositionHunter", "verifyEvidence", "newRandomEvidence", "room lock wait"
+};
+
+/************************************************************************************************
+ * Function: int openLatency(void)
+ * Description: This function maps the shared histograms. Until it is called LATENCY_START and
+ *              LATENCY_RECORD are a single NULL check and no clock is read.
+ * Parameters: None
+ * Return: C_TRUE if the histograms are mapped, C_FALSE otherwise.
+ ************************************************************************************************/
+int openLatency(void) {
+    void *histograms = mmap(NULL, sizeof(LatencyHistogramsType), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (histograms == MAP_FAILED) {
+        perror("Failed to map latency histograms");
+        return C_FALSE;
+    }
+
+    latency = histograms;
+    latencyOwner = getpid();
+    return C_TRUE;
+}
+
+/************************************************************************************************
+ * Function: int latencyBucket(uint64_t value)
+ * Description: This function finds the histogram bucket of a value.
+ * Parameters:
+ *      - uint64_t value: The value in nanoseconds.
+ * Return: The bucket index.
+ ************************************************************************************************/
+static int latencyBucket(uint64_t value) {
+    if (value < 2 * LATENCY_SUB_BUCKETS) {
+        return (int)value;
+    }
+
+    int magnitude = 63 - __builtin_clzll(value);
+    if (magnitude >= LATENCY_MAX_BITS) {
+        return LATENCY_BUCKETS - 1;
+    }
+
+    int shift = magnitude - LATENCY_SUB_BITS;
+    return (shift + 1) * LATENCY_SUB_BUCKETS + (int)(value >> shift) - LATENCY_SUB_BUCKETS;
+}
+
+/************************************************************************************************
+ * Function: uint64_t latencyBucketHighest(int bucket)
+ * Description: This function gives the highest value that falls in a bucket, which is what a
+ *              percentile landing in it is reported as.
+ * Parameters:
+ *      - int bucket: The bucket index.
+ * Return: The value in nanoseconds.
+ ************************************************************************************************/
+static uint64_t latencyBucketHighest(int bucket) {
+    if (bucket < 2 * LATENCY_SUB_BUCKETS) {
+        return (uint64_t)bucket;
+    }
+
+    int shift = bucket / LATENCY_SUB_BUCKETS - 1;
+    uint64_t sub = (uint64_t)(bucket % LATENCY_SUB_BUCKETS + LATENCY_SUB_BUCKETS);
+    return ((sub + 1) << shift) - 1;
+}
+
+/************************************************************************************************
+ * Function: void mergePending(void)
+ * Description: This function adds the calling thread's samples to the shared histograms and
+ *              clears them.
+ * Parameters: None
+ * Return: None
+ ************************************************************************************************/
+static void mergePending(void) {
+    for (int kind = 0; kind < LATENCY_KINDS; kind++) {
+        for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+            if (latencyPending->counts[kind][bucket] != 0) {
+                atomic_fetch_add_explicit(&latency->counts[kind][bucket], latencyPending->counts[kind][bucket], memory_order_relaxed);
+            }
+        }
+
+        uint64_t seen = atomic_load_explicit(&latency->max[kind], memory_order_relaxed);
+        while (latencyPending->max[kind] > seen &&
+               !atomic_compare_exchange_weak_explicit(&latency->max[kind], &seen, latencyPending->max[kind],
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+        }
+    }
+
+    memset(latencyPending, 0, sizeof(*latencyPending));
+}
+
+/************************************************************************************************
+ * Function: void recordLatency(LatencyKindType kind, uint64_t value)
+ * Description: This function counts one sample in the calling thread's histograms, which are
+ *              allocated on its first sample.
+ * Parameters:
+ *      - LatencyKindType kind: What was measured.
+ *      - uint64_t value: How long it took, in nanoseconds.
+ * Return: None
+ ************************************************************************************************/
+void recordLatency(LatencyKindType kind, uint64_t value) {
+    if (latencyPending == NULL) {
+        latencyPending = calloc(1, sizeof(LatencyPendingType));
+        if (latencyPending == NULL) {
+            perror("Failed to allocate latency histograms");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    latencyPending->counts[kind][latencyBucket(value)]++;
+    if (value > latencyPending->max[kind]) {
+        latencyPending->max[kind] = value;
+    }
+
+    if (++latencyPending->samples >= LATENCY_FLUSH_EVERY) {
+        mergePending();
+    }
+}
+
+/************************************************************************************************
+ * Function: void latencyFlush(void)
+ * Description: This function publishes the calling thread's samples and frees its histograms.
+ *              Agent threads call it when they stop, and the main thread after every run.
+ * Parameters: None
+ * Return: None
+ ************************************************************************************************/
+void latencyFlush(void) {
+    if (latency == NULL || latencyPending == NULL) {
+        return;
+    }
+
+    mergePending();
+    free(latencyPending);
+    latencyPending = NULL;
+}
+
+/************************************************************************************************
+ * Function: uint64_t processCpuNanoseconds(void)
+ * Description: This function reads the CPU time used so far by every thread of the process.
+ * Parameters: None
+ * Return: The CPU time in nanoseconds.
+ ************************************************************************************************/
+uint64_t processCpuNanoseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/************************************************************************************************
+ * Function: uint64_t latencyPercentile(LatencyKindType kind, uint64_t total, double quantile)
+ * Description: This function finds the value below which the given share of samples fall.
+ * Parameters:
+ *      - LatencyKindType kind: The histogram.
+ *      - uint64_t total: The number of samples in it.
+ *      - double quantile: The share, e.g. 0.99.
+ * Return: The value in nanoseconds, never more than the largest sample.
+ ************************************************************************************************/
+static uint64_t latencyPercentile(LatencyKindType kind, uint64_t total, double quantile) {
+    uint64_t rank = (uint64_t)ceil(quantile * (double)total);
+    uint64_t seen = 0;
+    uint64_t max = atomic_load(&latency->max[kind]);
+
+    if (rank < 1) {
+        rank = 1;
+    }
+
+    for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+        seen += atomic_load(&latency->counts[kind][bucket]);
+        if (seen >= rank) {
+            uint64_t value = latencyBucketHighest(bucket);
+            return (value < max) ? value : max;
+        }
+    }
+
+    return max;
+}
+
+/************************************************************************************************
+ * Function: void closeLatency(void)
+ * Description: This function prints the sample count, p50, p99, p999 and maximum of every
+ *              histogram that has samples, then unmaps them. Forked children inherit the
+ *              registration: only the process that mapped them reports.
+ * Parameters: None
+ * Return: None
+ ************************************************************************************************/
+void closeLatency(void) {
+    if (latency == NULL || getpid() != latencyOwner) {
+        return;
+    }
+
+    latencyFlush();
+
+    printf("[LATENCY] %-18s %10s %12s %12s %12s %12s  (ns)\n", "", "count", "p50", "p99", "p999", "max");
+    for (int kind = 0; kind < LATENCY_KINDS; kind++) {
+        uint64_t total = 0;
+        for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+            total += atomic_load(&latency->counts[kind][bucket]);
+        }
+
+        if (total == 0) {
+            continue;
+        }
+
+        printf("[LATENCY] %-18s %10llu %12llu %12llu %12llu %12llu\n", latencyNames[kind], (unsigned long long)total,
+               (unsigned long long)latencyPercentile(kind, total, 0.50), (unsigned long long)latencyPercentile(kind, total, 0.99),
+               (unsigned long long)latencyPercentile(kind, total, 0.999), (unsigned long long)atomic_load(&latency->max[kind]));
+    }
+
+    munmap(latency, sizeof(LatencyHistogramsType));
+    latency = NULL;
+}
@@ -1,4 +1,5 @@
 #include "defs.h"
+#include <stdarg.h>
 
 /************************************************************
  * Function: void printHunter(const HunterType *hunter)
@@ -15,6 +16,29 @@ void printHunter(const HunterType *hunter) {
 }
 
 
+/************************************************************
+ * Function: void logEvent(const char *format, ...)
+ * Description: This function prints a printf style simulation event. Agent actions go through
+ *              here so that quiet runs (batch continuations, forks) can drop them in one place.
+ * Parameters:
+ *      - const char *format: The printf format string.
+ *      - ...: The format arguments.
+ * Return: None
+ ************************************************************/
+void logEvent(const char *format, ...) {
+    if (gameOptions.quiet) {
+        return;
+    }
+
+    int previous = PROFILE_ENTER(PROFILE_LOGGING);
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    PROFILE_LEAVE(previous);
+}
+
+
 /***************************************************************
  * Function: int verifyEvidence(HunterType *currHunter)
  * Description: This function verifies evidence between two hunters in the same room.
@@ -30,9 +54,9 @@ void printHunter(const HunterType *hunter) {
 int verifyEvidence(HunterType *currHunter) {
     RoomType *currRoom = currHunter->room;
 
-    int randomHunter = randInt(0, currRoom->hunters->size);
+    int randomHunter = randInt(0, currRoom->hunterCount);
 
-    HunterType *hunterReview = currRoom->hunters->hunterList[randomHunter];
+    HunterType *hunterReview = currRoom->hunters[randomHunter];
 
     HunterType *hunters[2] = {currHunter, hunterReview};
 
@@ -44,7 +68,7 @@ int verifyEvidence(HunterType *currHunter) {
 
         while (node != NULL) {
             if (isEvidenceFromGhost(node->data) && !isDuplicate(endH->ghostEvidence, node)) {
-                printf("[HUNTER REVIEW] [%s] reviewed evidence and found %s %f\n", startingH->name, evidenceTypeToString(node->data->evidenceType), node->data->readingInfo);
+                logEvent("[HUNTER REVIEW] [%s] reviewed evidence and found %s %f\n", startingH->name, evidenceTypeToString(node->data->evidenceType), node->data->readingInfo);
             }
             node = node->next;
         }
@@ -55,10 +79,36 @@ int verifyEvidence(HunterType *currHunter) {
 
 
 
+/***************************************************************
+ * Function: RoomType *chooseHunterMove(HunterType *currHunter)
+ * Description: This function picks where a hunter moves: the room chooseSearchRoom picks with
+ *              directed search, otherwise a random connected room. It only reads the house.
+ *              A hunter in a room without connections stays.
+ * Parameters:
+ *      - HunterType *currHunter: The hunter about to move.
+ * Return: The room to move to, or the hunter's own room to stay.
+ ***************************************************************/
+RoomType *chooseHunterMove(HunterType *currHunter) {
+    RoomType *newRoom = (currHunter->house->search != NULL) ? chooseSearchRoom(currHunter) : NULL;
+
+    if (newRoom == NULL) {
+        int size = currHunter->room->topology->connectedCount;
+
+        // A room without connections (only a corrupt floor plan has one) keeps the hunter in it
+        newRoom = (size > 0) ? connectedRoom(currHunter->room, randInt(0, size)) : currHunter->room;
+    }
+
+    return newRoom;
+}
+
 /***************************************************************
  * Function: int repositionHunter(HunterType *currHunter)
- * Description: This function repositions a hunter to a random connected room,
- *              updating the hunter's current room, and decrementing the boredom timer.
+ * Description: This function repositions a hunter to a random connected room (or, with
+ *              directed search, the room chooseSearchRoom picks), updating the hunter's
+ *              current room, and decrementing the boredom timer. A room that is locked by
+ *              someone else or already holds MAX_HUNTERS hunters is not entered.
+ *              On a sharded engine thread the move is left to shardMoveHunter, which may
+ *              hand the hunter to the shard owning the new room (C_HANDED_OFF).
  * Parameters:
  *      - HunterType *currHunter: A pointer to the HunterType structure representing the current hunter.
  * Return:
@@ -68,45 +118,66 @@ int verifyEvidence(HunterType *currHunter) {
 
 
 int repositionHunter(HunterType* currHunter) {
-    
-    RoomNodeType *node = currHunter->room->connectedRooms->head;
-    int sizeCounter;
-    
-    for (sizeCounter = 0; node != NULL; sizeCounter++, node = node->next);
+    RoomType *newRoom = chooseHunterMove(currHunter);
 
-    int roomInt = randInt(0, sizeCounter);
+    if (newRoom == currHunter->room) {
+        // Directed search: stay where evidence for this hunter's tool was left
+        return C_FALSE;
+    }
 
-    RoomNodeType *roomNode = currHunter->room->connectedRooms->head;
-    for(int i = 0; i < roomInt; i++) {
-        roomNode = roomNode->next;
+    if (currentShard != NULL) {
+        return shardMoveHunter(currentShard, currHunter, newRoom);
     }
 
+    return moveHunter(currHunter, newRoom);
+}
+
+/***************************************************************
+ * Function: int moveHunter(HunterType *currHunter, RoomType *newRoom)
+ * Description: This function moves a hunter into a connected room it picked, holding both
+ *              room locks, and decrements its boredom timer. A room that is locked by someone
+ *              else or already holds MAX_HUNTERS hunters is not entered.
+ * Parameters:
+ *      - HunterType *currHunter: The hunter.
+ *      - RoomType *newRoom: The room to move into.
+ * Return: C_TRUE if the hunter moved, C_FALSE otherwise.
+ ***************************************************************/
+int moveHunter(HunterType *currHunter, RoomType *newRoom) {
     RoomType *oldRoom = currHunter->room;
 
-    sem_wait(&(oldRoom->semaphore));
+    lockRoom(oldRoom);
 
     int newRoomAvailable = 1; 
     do {
-        if (sem_trywait(&(roomNode->data->semaphore)) != 0) {
+        if (!tryLockRoom(newRoom)) {
             newRoomAvailable = 0;
             break; 
         }
     } while (0);
 
+    // A full room turns the hunter away; leaving first would drop it from every room list
+    if (newRoomAvailable && newRoom->hunterCount >= MAX_HUNTERS) {
+        unlockRoom(newRoom);
+        newRoomAvailable = 0;
+    }
+
     if (!newRoomAvailable) {
-        sem_post(&(oldRoom->semaphore));
+        unlockRoom(oldRoom);
+        TELEMETRY_COUNT(moveFailures, 1);
         return C_FALSE;
     }
 
     rerepositionHunter(currHunter, C_FALSE);
-    assignHunterToRoom(roomNode->data, currHunter);
+    assignHunterToRoom(newRoom, currHunter);
+    wakeRoom(newRoom);
 
-    printf("[HUNTER MOVE] [%s] has moved into [%s]\n", currHunter->name, currHunter->room->name);
+    logEvent("[HUNTER MOVE] [%s] has moved into [%s]\n", currHunter->name, currHunter->room->topology->name);
 
     currHunter->timer--;
+    TELEMETRY_COUNT(moves, 1);
   
-    sem_post(&(oldRoom->semaphore));
-    sem_post(&(roomNode->data->semaphore));
+    unlockRoom(oldRoom);
+    unlockRoom(newRoom);
 
     return C_TRUE;
 }
@@ -126,29 +197,28 @@ void rerepositionHunter(HunterType *hunter, int locked) {
     RoomType *oldRoom = hunter->room;
 
     if (locked) {
-        sem_wait(&(oldRoom->semaphore));
+        lockRoom(oldRoom);
     }
 
-    HunterListType *roomHunters = oldRoom->hunters;
-
     int indexToRemove = -1;
-    for (int i = 0; i < roomHunters->size; i++) {
-        if (roomHunters->hunterList[i] == hunter) {
+    for (int i = 0; i < oldRoom->hunterCount; i++) {
+        if (oldRoom->hunters[i] == hunter) {
             indexToRemove = i;
             break;
         }
     }
 
     if (indexToRemove != -1) {
-        for (int j = indexToRemove + 1; j < roomHunters->size; j++) {
-            roomHunters->hunterList[j - 1] = roomHunters->hunterList[j];
+        for (int j = indexToRemove + 1; j < oldRoom->hunterCount; j++) {
+            oldRoom->hunters[j - 1] = oldRoom->hunters[j];
         }
 
-        roomHunters->size--;
+        oldRoom->hunterCount--;
+        telemetryRoom(oldRoom);
     }
 
     if (locked) {
-        sem_post(&(oldRoom->semaphore));
+        unlockRoom(oldRoom);
     }
 }
 
@@ -173,41 +243,73 @@ void addHunterEvidence(GhostEvidenceListType *list, EvidenceNodeType *evidence)
 
 /***********************************************************************
  * Function: void moveGhost(GhostType *currGhost)
- * Description: This function moves the ghost to a random connected room.
+ * Description: This function moves the ghost to a random connected room. When the room
+ *              belongs to another shard the ghost is handed over to it instead of being
+ *              linked into the room here.
  * Parameters:
  *      - GhostType *currGhost: A pointer to the GhostType structure representing the ghost to be moved.
  * Return: None
  * CHATGPT ACCESSED DECEMBER 2ND 2023
  ***********************************************************************/
 void moveGhost(GhostType *currGhost) {
-    if (rand() % 100 < 45) {
-        int size = 0;
-        RoomNodeType *node = currGhost->room->connectedRooms->head;
+    RoomType *tempRoom = chooseGhostMove(currGhost);
 
-        do {
-            size++;
-            node = node->next;
-        } while (node != NULL);
+    if (tempRoom != NULL) {
+        placeGhost(currGhost, tempRoom);
+    }
+}
+
+/***********************************************************************
+ * Function: RoomType *chooseGhostMove(GhostType *currGhost)
+ * Description: This function decides whether the ghost moves and where to. It only reads
+ *              the house. A ghost in a room without connections stays.
+ * Parameters:
+ *      - GhostType *currGhost: The ghost.
+ * Return: The connected room to move to, or NULL to stay.
+ ***********************************************************************/
+RoomType *chooseGhostMove(GhostType *currGhost) {
+    if (randInt(0, 100) < 45) {
+        int size = currGhost->room->topology->connectedCount;
+        if (size == 0) {
+            return NULL;
+        }
 
         int nodeInt = randInt(0, size);
-        RoomNodeType *tempRoom = currGhost->room->connectedRooms->head;
 
-        int i = 0;
-        do {
-            tempRoom = tempRoom->next;
-            i++;
-        } while (i < nodeInt && tempRoom != NULL);
+        // The ghost walks at least one step past the first connection; walking off the end means staying
+        int index = (nodeInt > 1) ? nodeInt : 1;
+
+        if (index < size) {
+            return connectedRoom(currGhost->room, index);
+        }
+    }
+
+    return NULL;
+}
 
-        if (tempRoom != NULL) {
-            printf("[GHOST MOVE] Ghost has moved into [%s]\n", tempRoom->data->name);
+/***********************************************************************
+ * Function: void placeGhost(GhostType *currGhost, RoomType *tempRoom)
+ * Description: This function moves the ghost out of its room into another, or hands it to
+ *              the shard owning that room.
+ * Parameters:
+ *      - GhostType *currGhost: The ghost.
+ *      - RoomType *tempRoom: The room it moves into.
+ * Return: None
+ ***********************************************************************/
+void placeGhost(GhostType *currGhost, RoomType *tempRoom) {
+    logEvent("[GHOST MOVE] Ghost has moved into [%s]\n", tempRoom->topology->name);
 
-            currGhost->room->ghost = NULL;
+    currGhost->room->ghost = NULL;
 
-            currGhost->room = tempRoom->data;
+    currGhost->room = tempRoom;
+    TELEMETRY_SET(ghostRoom, currGhost->room->id);
 
-            currGhost->room->ghost = currGhost;
-        }
+    if (currentShard != NULL && shardHandOffGhost(currentShard, currGhost)) {
+        return;
     }
+
+    currGhost->room->ghost = currGhost;
+    wakeRoom(currGhost->room);
 }
 
 
@@ -226,16 +328,71 @@ void initializeGhost(GhostClassType ghostType, RoomType *room, int restDuration,
     ghost->ghostType = ghostType;
     ghost->restDuration = restDuration;
     ghost->boredomDuration  = BOREDOM_MAX;
+    ghost->steps = 0;
     ghost->room = room;
-    
+    seedRng(&ghost->rng, (uint64_t)time(NULL) ^ (uintptr_t)ghost);
+
 }
 
 
+/************************************************************************************
+ * Function: int takeRoomEvidence(HunterType *currHunter, EvidenceChannelType *channel, EvidenceChannelNodeType *tempEvidence)
+ * Description: This function takes the oldest evidence off a channel the hunter holds the
+ *              taking side of, adds a copy to its ghost evidence list and ends the game once
+ *              enough evidence has been collected. The room's node goes back to the house.
+ * Parameters:
+ *      - HunterType *currHunter: The hunter.
+ *      - EvidenceChannelType *channel: The channel, with taking held.
+ *      - EvidenceChannelNodeType *tempEvidence: Its oldest evidence.
+ * Return: C_TRUE if the hunter keeps collecting, C_FALSE once it has collected enough.
+ ************************************************************************************/
+static int takeRoomEvidence(HunterType *currHunter, EvidenceChannelType *channel, EvidenceChannelNodeType *tempEvidence) {
+    EvidenceType *newEvidence;
+    EvidenceNodeType *newNode;
+
+    takeEvidence(channel);
+    clearEvidenceHint(currHunter->house, currHunter->room, currHunter->evidence);
+    endTakingEvidence(channel);
+
+    newNode = newHunterEvidence(currHunter->house);
+    newEvidence = newNode->data;
+    *newEvidence = tempEvidence->evidence;
+
+    // The room's node is no longer in any channel; the next evidence left can reuse it
+    recycleChannelEvidence(currHunter->house, tempEvidence);
+
+    // Other hunters in the room read this list when reviewing evidence
+    lockRoom(currHunter->room);
+    addHunterEvidence(currHunter->ghostEvidence, newNode);
+    unlockRoom(currHunter->room);
+
+    logEvent("[HUNTER EVIDENCE] [%s] found [%s] in [%s] and [COLLECTED]\n", currHunter->name, evidenceTypeToString(newEvidence->evidenceType), currHunter->room->topology->name);
+    TELEMETRY_COUNT(evidenceCollected, 1);
+    currHunter->timer = isEvidenceFromGhost(newEvidence) ? BOREDOM_MAX : currHunter->timer;
+
+    // Increment evidenceCollected
+    if (++currHunter->evidenceCollected >= 3) {
+        logEvent("[HUNTER EVIDENCE] [%s] has collected the maximum allowed evidence\n", currHunter->name);
+
+        // Count it for the house (shared by every shard when sharded); the winner is reported once every agent has stopped
+        int total = (currentShard != NULL) ? shardCountEvidence(currentShard) : atomic_fetch_add(&currHunter->house->evidenceCollected, 1) + 1;
+        if (total >= 3) {
+            atomic_store(&currHunter->house->gameOver, C_TRUE);
+            wakeHouse(currHunter->house);
+        }
+
+        return C_FALSE;  // Stop collecting evidence for this hunter
+    }
+
+    return C_TRUE;  // Successfully collected evidence
+}
+
 /************************************************************************************
  * Function: int grabEvidence(HunterType *currHunter)
  * Description: This function allows the hunter to grab evidence from the current room's
- *              evidence list. If the evidence matches the hunter's assigned evidence type,
- *              it is collected and added to the hunter's ghost evidence list.
+ *              channel for its assigned evidence type. The oldest piece there may be
+ *              collected and added to the hunter's ghost evidence list; no room lock is
+ *              needed to take it.
  * Parameters:
  *      - HunterType *currHunter: A pointer to the HunterType structure representing the current hunter.
  * Return:
@@ -243,99 +400,106 @@ void initializeGhost(GhostClassType ghostType, RoomType *room, int restDuration,
  * CHATGPT ACCESSED DECEMBER 2ND 2023
  ************************************************************************************/
 int grabEvidence(HunterType *currHunter) {
-    EvidenceNodeType *tempEvidence = currHunter->room->evidenceList->head;
-    EvidenceType *newEvidence;
-    EvidenceNodeType *newNode;
+    EvidenceChannelType *channel = &currHunter->room->evidence[currHunter->evidence];
 
-    if (tempEvidence == NULL) {
-        // No evidence in the room
+    if (!beginTakingEvidence(channel)) {
+        // Another hunter with the same tool is already searching this room
         return C_FALSE;
     }
 
-    for (; tempEvidence != NULL; tempEvidence = tempEvidence->next) {
-        if (tempEvidence->data->evidenceType != currHunter->evidence) {
-            continue;
-        }
+    EvidenceChannelNodeType *tempEvidence = settleEvidence(channel);
 
-        // Introduce a probability check (80% chance of collecting evidence)
-        int shouldCollect = rand() % 100 < 60;
-
-        if (shouldCollect) {
-            newEvidence = (EvidenceType*) malloc(sizeof(EvidenceType));
-
-            if (newEvidence == NULL) {
-                perror("Failed to allocate memory for EvidenceType");
-                exit(EXIT_FAILURE);
-            }
-
-            newEvidence->readingInfo = tempEvidence->data->readingInfo;
-            newEvidence->evidenceType = tempEvidence->data->evidenceType;
-
-            newNode = (EvidenceNodeType*) malloc(sizeof(EvidenceNodeType));
-
-            if (newNode == NULL) {
-                perror("Failed to allocate memory for EvidenceNodeType");
-                exit(EXIT_FAILURE);
-            }
+    if (tempEvidence == NULL) {
+        // No evidence for this hunter in the room
+        endTakingEvidence(channel);
+        return C_FALSE;
+    }
 
-            newNode->data = newEvidence;
-            newNode->next = NULL;
+    // Introduce a probability check (60% chance of collecting evidence)
+    int shouldCollect = randInt(0, 100) < 60;
 
-            addHunterEvidence(currHunter->ghostEvidence, newNode);
-            printf("[HUNTER EVIDENCE] [%s] found [%s] in [%s] and [COLLECTED]\n", currHunter->name, evidenceTypeToString(newEvidence->evidenceType), currHunter->room->name);
-            removeEvidence(currHunter->room->evidenceList, tempEvidence);
-            currHunter->timer = isEvidenceFromGhost(newEvidence) ? BOREDOM_MAX : currHunter->timer;
+    if (!shouldCollect) {
+        endTakingEvidence(channel);
+        return C_FALSE;  // Hunter decided not to collect evidence this time
+    }
 
-            // Increment evidenceCollected
-            if (++currHunter->evidenceCollected >= 3) {
-                printf("[HUNTER EVIDENCE] [%s] has collected the maximum allowed evidence\n", currHunter->name);
+    return takeRoomEvidence(currHunter, channel, tempEvidence);
+}
 
-                // Increment totalEvidenceCollected
-                if (++totalEvidenceCollected >= 3) {
-                    printf("Hunters win! They have collected enough evidence to identify the ghost.\n");
-                    exit(EXIT_SUCCESS);
-                }
+/************************************************************************************
+ * Function: int collectEvidence(HunterType *currHunter)
+ * Description: This function collects the oldest piece of evidence of the hunter's tool in
+ *              its room, when the hunter already decided to collect it.
+ * Parameters:
+ *      - HunterType *currHunter: The hunter.
+ * Return: C_TRUE if evidence was collected and the hunter keeps collecting, C_FALSE otherwise.
+ ************************************************************************************/
+int collectEvidence(HunterType *currHunter) {
+    EvidenceChannelType *channel = &currHunter->room->evidence[currHunter->evidence];
 
-                return C_FALSE;  // Stop collecting evidence for this hunter
-            }
+    if (!beginTakingEvidence(channel)) {
+        return C_FALSE;
+    }
 
-            return C_TRUE;  // Successfully collected evidence
-        }
+    EvidenceChannelNodeType *tempEvidence = settleEvidence(channel);
 
-        return C_FALSE;  // Hunter decided not to collect evidence this time
+    if (tempEvidence == NULL) {
+        endTakingEvidence(channel);
+        return C_FALSE;
     }
 
-    return C_FALSE;  // No evidence found for this hunter
+    return takeRoomEvidence(currHunter, channel, tempEvidence);
 }
 
 /************************************************************************************
  * Function: void newRandomEvidence(GhostType *currGhost)
- * Description: This function generates new random evidence and adds it to the current
- *              room's evidence list. The evidence type and reading info are determined
- *              based on the ghost's ghostType.
+ * Description: This function generates new random evidence and drops it into the current
+ *              room's channel for its type without locking the room, waking hunters parked there.
+ *              The evidence type and reading info are determined based on the ghost's ghostType.
  * Parameters:
  *      - GhostType *currGhost: A pointer to the GhostType structure representing the current ghost.
  * Return: None
  * CHATGPT ACCESSED DECEMBER 2ND 2023
  ************************************************************************************/
 void newRandomEvidence(GhostType *currGhost) {
-    sem_wait(&(currGhost->room->semaphore));
+    leaveGhostEvidence(currGhost, makeGhostEvidence(currGhost));
+}
 
-    EvidenceNodeType *node = malloc(sizeof(EvidenceNodeType));
-    EvidenceType *newEvidencePointer = malloc(sizeof(EvidenceType));
+/************************************************************************************
+ * Function: EvidenceChannelNodeType *makeGhostEvidence(GhostType *currGhost)
+ * Description: This function creates a random piece of the ghost's evidence, not yet left
+ *              anywhere.
+ * Parameters:
+ *      - GhostType *currGhost: The ghost.
+ * Return: The evidence, from the house's spare evidence or the run arena.
+ ************************************************************************************/
+EvidenceChannelNodeType *makeGhostEvidence(GhostType *currGhost) {
+    EvidenceChannelNodeType *node = newChannelEvidence(currGhost->house);
 
     int randomEvidence = randomGhostEvidence(currGhost->ghostType);
 
-    newEvidencePointer->evidenceType = (EvidenceClassType)randomEvidence;
-    newEvidencePointer->readingInfo = createGhostType(newEvidencePointer->evidenceType);
-
-    node->data = newEvidencePointer;
-    node->next = NULL;
-
-    addRoomEvidence(currGhost->room->evidenceList, node);
-
-    printf("[GHOST EVIDENCE] Ghost left [%s] in [%s]\n", evidenceTypeToString(node->data->evidenceType),
-           currGhost->room->name);
+    node->evidence.evidenceType = (EvidenceClassType)randomEvidence;
+    node->evidence.readingInfo = createGhostType(node->evidence.evidenceType);
+    return node;
+}
 
-    sem_post(&(currGhost->room->semaphore));
+/************************************************************************************
+ * Function: void leaveGhostEvidence(GhostType *currGhost, EvidenceChannelNodeType *node)
+ * Description: This function drops evidence into the ghost's room's channel for its type
+ *              without locking the room, waking hunters parked there.
+ * Parameters:
+ *      - GhostType *currGhost: The ghost.
+ *      - EvidenceChannelNodeType *node: The evidence.
+ * Return: None
+ ************************************************************************************/
+void leaveGhostEvidence(GhostType *currGhost, EvidenceChannelNodeType *node) {
+    // Once dropped the node belongs to the channel: a hunter may take it, or the cap evict it
+    EvidenceClassType type = node->evidence.evidenceType;
+    dropEvidence(currGhost->room, node);
+    markEvidenceHint(currGhost->house, currGhost->room, type);
+    wakeRoom(currGhost->room);
+    TELEMETRY_COUNT(evidenceProduced, 1);
+
+    logEvent("[GHOST EVIDENCE] Ghost left [%s] in [%s]\n", evidenceTypeToString(type),
+           currGhost->room->topology->name);
 }
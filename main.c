@@ -1,80 +1,639 @@
 #include "defs.h"
+#include <errno.h>
+#include <limits.h>
+#include <sys/mman.h>
+
+GameOptionsType gameOptions;
 
 /***************************************************************************************
- * Function: void initializeGame(int argc, char *argv[])
- * Description: This function initializes the game by setting up the house, populating
- *              rooms, creating hunters and ghosts, and managing the game threads.
+ * Function: void printUsage(const char *program)
+ * Description: This function prints the command line usage of the simulator.
+ * Parameters:
+ *      - const char *program: The name the program was started with.
+ * Return: None
+ ***************************************************************************************/
+void printUsage(const char *program) {
+    printf("Usage: %s [options] [hunterRestMs ghostRestSec]\n", program);
+    printf("  --seed N               seed every agent generator from N\n");
+    printf("  --quiet                do not print agent actions or the final report\n");
+    printf("  --checkpoint FILE      write a snapshot of the house to FILE\n");
+    printf("  --checkpoint-at N      take the checkpoint after N ghost steps (default 1)\n");
+    printf("  --restore FILE         continue the game saved in FILE instead of a new one\n");
+    printf("  --forks N              run N forked continuations of the restored game\n");
+    printf("  --runs N               play N games back to back with generated hunter names\n");
+    printf("  --jobs N               play the --runs games on N forked workers sharing one house topology\n");
+    printf("  --houses N             keep N of the --runs games in play at once, as coroutines on a shared thread pool\n");
+    printf("  --pool N               number of --houses pool threads (default one per online CPU)\n");
+    printf("  --telemetry NAME       publish live counters in shared memory segment NAME (see pp-top)\n");
+    printf("  --house-gen KIND       generate a grid, tree, geometric or smallworld house\n");
+    printf("  --rooms N              number of generated rooms (default 1000)\n");
+    printf("  --degree D             mean connections per room (children per room for trees)\n");
+    printf("  --degree-dist DIST     tree branching distribution: fixed, uniform or powerlaw\n");
+    printf("  --rewire P             small world rewiring probability (default 0.1)\n");
+    printf("  --house FILE           load the floor plan from a house file\n");
+    printf("  --save-house FILE      write the floor plan to a house file and exit\n");
+    printf("  --compile-house FILE   compile the floor plan into a house image and exit\n");
+    printf("  --house-image FILE     map a compiled house image and play in it\n");
+    printf("  --hunters N            number of hunters (default 4, at most 4 per room)\n");
+    printf("  --shards K             run the house on K region-owning worker threads\n");
+    printf("  --processes P          deal the shards out to P processes (implies --shards P)\n");
+    printf("  --search MODE          random (default) or directed: hunters head for evidence of their tool\n");
+    printf("  --record FILE          take agent turns one at a time and log them to FILE\n");
+    printf("  --replay FILE          re-run a recorded game on one thread, checking every turn\n");
+    printf("  --check N              validate the house invariants every N agent turns\n");
+    printf("  --evidence-cap N       keep at most N pieces of each evidence type in a room (default no limit)\n");
+    printf("  --evict POLICY         what goes over the cap: oldest (default) or mundane (oldest non-ghostly first)\n");
+    printf("  --wake MODE            timer (default) or event: idle hunters park until something happens in their room\n");
+    printf("  --results FILE         write one structured record per run to FILE\n");
+    printf("  --results-format FMT   jsonl (default) or csv\n");
+    printf("  --latency              print p50/p99/p999 of run time, agent actions and room lock waits\n");
+    printf("  --stats                print mean, stddev, min and max of outcomes, run length, fear and evidence over the runs\n");
+    printf("  --profile              print where hunter and ghost threads spend each turn, phase by phase\n");
+    printf("  --coroutines           run every agent as a coroutine on one thread instead of its own thread\n");
+    printf("  --guard-stacks         put a guard page below every coroutine stack (one kernel mapping per agent)\n");
+    printf("  --ticks N              play in deterministic ticks: agents decide on N threads, then one commit applies them\n");
+    printf("  --pin MODE             pin worker threads and forks to CPUs: compact (fill a NUMA node first) or spread\n");
+    printf("  --numa                 allocate each worker's memory on its own NUMA node (implies --pin spread)\n");
+}
+
+/***************************************************************************************
+ * Function: int parseCount(const char *option, const char *text, int minimum)
+ * Description: This function reads a whole-number option. Anything else (trailing text, a
+ *              number that does not fit an int or one below minimum) stops the program with
+ *              an error naming the option.
+ * Parameters:
+ *      - const char *option: The option, for the error message.
+ *      - const char *text: Its value.
+ *      - int minimum: The smallest value it takes.
+ * Return: The number.
+ ***************************************************************************************/
+static int parseCount(const char *option, const char *text, int minimum) {
+    char *end;
+    errno = 0;
+    long value = strtol(text, &end, 10);
+
+    if (end == text || *end != '\0' || errno != 0 || value < minimum || value > INT_MAX) {
+        fprintf(stderr, "%s needs a whole number of at least %d, not [%s]\n", option, minimum, text);
+        exit(EXIT_FAILURE);
+    }
+
+    return (int)value;
+}
+
+/***************************************************************************************
+ * Function: double parseReal(const char *option, const char *text, double minimum, double maximum)
+ * Description: This function reads a real-number option in [minimum, maximum], stopping the
+ *              program with an error naming the option otherwise.
+ * Parameters:
+ *      - const char *option: The option, for the error message.
+ *      - const char *text: Its value.
+ *      - double minimum: The smallest value it takes.
+ *      - double maximum: The largest value it takes.
+ * Return: The number.
+ ***************************************************************************************/
+static double parseReal(const char *option, const char *text, double minimum, double maximum) {
+    char *end;
+    errno = 0;
+    double value = strtod(text, &end);
+
+    if (end == text || *end != '\0' || errno != 0 || !(value >= minimum && value <= maximum)) {
+        fprintf(stderr, "%s needs a number from %g to %g, not [%s]\n", option, minimum, maximum, text);
+        exit(EXIT_FAILURE);
+    }
+
+    return value;
+}
+
+/***************************************************************************************
+ * Function: void parseGameOptions(int argc, char *argv[], GameOptionsType *options)
+ * Description: This function fills the game options from the command line. The two
+ *              positional arguments (hunter and ghost rest durations) keep working as
+ *              before; everything else is a long option.
  * Parameters:
  *      - int argc: The number of command-line arguments.
  *      - char *argv[]: An array of command-line argument strings.
+ *      - GameOptionsType *options: The options to fill.
  * Return: None
- * CHATGPT ACCESSED DECEMBER 2ND 2023
  ***************************************************************************************/
-void initializeGame(int argc, char *argv[]) {
-    int hunterRestDuration = 0;
-    int ghostRestDuration = 0;
+void parseGameOptions(int argc, char *argv[], GameOptionsType *options) {
+    static const struct option longOptions[] = {
+        {"seed",          required_argument, NULL, 's'},
+        {"quiet",         no_argument,       NULL, 'q'},
+        {"checkpoint",    required_argument, NULL, 'c'},
+        {"checkpoint-at", required_argument, NULL, 'a'},
+        {"restore",       required_argument, NULL, 'r'},
+        {"forks",         required_argument, NULL, 'f'},
+        {"runs",          required_argument, NULL, 'n'},
+        {"jobs",          required_argument, NULL, 'J'},
+        {"houses",        required_argument, NULL, 'm'},
+        {"pool",          required_argument, NULL, 'l'},
+        {"telemetry",     required_argument, NULL, 't'},
+        {"house-gen",     required_argument, NULL, 'g'},
+        {"rooms",         required_argument, NULL, 'R'},
+        {"degree",        required_argument, NULL, 'd'},
+        {"degree-dist",   required_argument, NULL, 'D'},
+        {"rewire",        required_argument, NULL, 'w'},
+        {"house",         required_argument, NULL, 'H'},
+        {"save-house",    required_argument, NULL, 'S'},
+        {"compile-house", required_argument, NULL, 'K'},
+        {"house-image",   required_argument, NULL, 'M'},
+        {"hunters",       required_argument, NULL, 'u'},
+        {"shards",        required_argument, NULL, 'k'},
+        {"processes",     required_argument, NULL, 'P'},
+        {"search",        required_argument, NULL, 'x'},
+        {"record",        required_argument, NULL, 'e'},
+        {"replay",        required_argument, NULL, 'p'},
+        {"check",         required_argument, NULL, 'i'},
+        {"wake",          required_argument, NULL, 'W'},
+        {"evidence-cap",  required_argument, NULL, 'C'},
+        {"evict",         required_argument, NULL, 'E'},
+        {"results",       required_argument, NULL, 'o'},
+        {"results-format", required_argument, NULL, 'O'},
+        {"latency",       no_argument,       NULL, 'L'},
+        {"stats",         no_argument,       NULL, 'Z'},
+        {"profile",       no_argument,       NULL, 'F'},
+        {"coroutines",    no_argument,       NULL, 'Y'},
+        {"guard-stacks",  no_argument,       NULL, 'G'},
+        {"ticks",         required_argument, NULL, 'T'},
+        {"pin",           required_argument, NULL, 'A'},
+        {"numa",          no_argument,       NULL, 'N'},
+        {"help",          no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
 
-    switch (argc) {
-        case 3:
-            hunterRestDuration = strtol(argv[1], NULL, 10);
-            ghostRestDuration = strtol(argv[2], NULL, 10);
-            break;
+    memset(options, 0, sizeof(*options));
+    options->checkpointAt = 1;
+    options->runs = 1;
+    options->houseSpec.rooms = 1000;
+    options->houseSpec.degree = 4.0;
+    options->houseSpec.rewire = 0.1;
+    options->hunters = MAX_HUNTERS;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", longOptions, NULL)) != -1) {
+        switch (opt) {
+            case 's': {
+                char *end;
+                errno = 0;
+                options->seed = strtoull(optarg, &end, 10);
+                if (end == optarg || *end != '\0' || errno != 0 || optarg[strspn(optarg, " \t")] == '-') {
+                    fprintf(stderr, "--seed needs a whole number of at least 0, not [%s]\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                options->hasSeed = C_TRUE;
+                break;
+            }
+            case 'q':
+                options->quiet = C_TRUE;
+                break;
+            case 'c':
+                options->checkpointPath = optarg;
+                break;
+            case 'a':
+                options->checkpointAt = parseCount("--checkpoint-at", optarg, 1);
+                break;
+            case 'r':
+                options->restorePath = optarg;
+                break;
+            case 'f':
+                options->forks = parseCount("--forks", optarg, 1);
+                break;
+            case 'n':
+                options->runs = parseCount("--runs", optarg, 1);
+                break;
+            case 'J':
+                options->jobs = parseCount("--jobs", optarg, 1);
+                break;
+            case 'm':
+                options->houses = parseCount("--houses", optarg, 1);
+                break;
+            case 'l':
+                options->poolWorkers = parseCount("--pool", optarg, 1);
+                break;
+            case 't':
+                options->telemetryName = optarg;
+                break;
+            case 'g':
+                options->houseSpec.kind = parseHouseKind(optarg);
+                if (options->houseSpec.kind == HOUSE_FIXED) {
+                    fprintf(stderr, "Unknown house generator [%s]\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'R':
+                options->houseSpec.rooms = parseCount("--rooms", optarg, 2);
+                break;
+            case 'd':
+                options->houseSpec.degree = parseReal("--degree", optarg, 0.0, 1e6);
+                break;
+            case 'D':
+                options->houseSpec.distribution = parseDegreeDistribution(optarg);
+                break;
+            case 'w':
+                options->houseSpec.rewire = parseReal("--rewire", optarg, 0.0, 1.0);
+                break;
+            case 'H':
+                options->houseFile = optarg;
+                break;
+            case 'S':
+                options->saveHousePath = optarg;
+                break;
+            case 'K':
+                options->compileHousePath = optarg;
+                break;
+            case 'M':
+                options->houseImagePath = optarg;
+                break;
+            case 'u':
+                options->hunters = parseCount("--hunters", optarg, 1);
+                break;
+            case 'k':
+                options->shards = parseCount("--shards", optarg, 1);
+                break;
+            case 'P':
+                options->processes = parseCount("--processes", optarg, 1);
+                break;
+            case 'x':
+                if (strcmp(optarg, "directed") == 0) {
+                    options->directedSearch = C_TRUE;
+                } else if (strcmp(optarg, "random") != 0) {
+                    fprintf(stderr, "Unknown search mode [%s]\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'e':
+                options->recordPath = optarg;
+                break;
+            case 'p':
+                options->replayPath = optarg;
+                break;
+            case 'i':
+                options->checkEvery = parseCount("--check", optarg, 1);
+                break;
+            case 'W':
+                if (strcmp(optarg, "event") == 0) {
+                    options->eventWakeups = C_TRUE;
+                } else if (strcmp(optarg, "timer") != 0) {
+                    fprintf(stderr, "Unknown wake mode [%s]\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'C':
+                options->evidenceCap = parseCount("--evidence-cap", optarg, 1);
+                break;
+            case 'E':
+                if (strcmp(optarg, "mundane") == 0) {
+                    options->evictPolicy = EVICT_MUNDANE;
+                } else if (strcmp(optarg, "oldest") != 0) {
+                    fprintf(stderr, "Unknown eviction policy [%s]\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'o':
+                options->resultsPath = optarg;
+                break;
+            case 'O':
+                if (strcmp(optarg, "csv") == 0) {
+                    options->resultsFormat = RESULTS_CSV;
+                } else if (strcmp(optarg, "jsonl") != 0) {
+                    fprintf(stderr, "Unknown results format [%s]\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'L':
+                options->latency = C_TRUE;
+                break;
+            case 'Z':
+                options->stats = C_TRUE;
+                break;
+            case 'F':
+                options->profile = C_TRUE;
+                break;
+            case 'Y':
+                options->coroutines = C_TRUE;
+                break;
+            case 'G':
+                options->guardStacks = C_TRUE;
+                break;
+            case 'T':
+                options->tickWorkers = parseCount("--ticks", optarg, 1);
+                break;
+            case 'A':
+                if (strcmp(optarg, "compact") == 0) {
+                    options->pinMode = PIN_COMPACT;
+                } else if (strcmp(optarg, "spread") == 0) {
+                    options->pinMode = PIN_SPREAD;
+                } else {
+                    fprintf(stderr, "Unknown pin mode [%s]\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'N':
+                options->numa = C_TRUE;
+                break;
+            case 'h':
+                printUsage(argv[0]);
+                exit(EXIT_SUCCESS);
+            default:
+                printUsage(argv[0]);
+                exit(EXIT_FAILURE);
+        }
     }
 
-    srand(time(NULL));
+    if (options->shards < options->processes) {
+        options->shards = options->processes;
+    }
 
-    pthread_t pThreadghost;
+    if (options->numa && options->pinMode == PIN_OFF) {
+        options->pinMode = PIN_SPREAD;
+    }
 
-    HouseType house;
-    initializeHouse(&house);
-    populateRooms(&house);
+    if (options->checkEvery > 0 && options->shards > 0) {
+        fprintf(stderr, "--check validates threaded games, not --shards\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (options->checkpointPath != NULL && options->shards > 0) {
+        fprintf(stderr, "--checkpoint snapshots threaded games, not --shards\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (options->houseImagePath != NULL &&
+        (options->houseFile != NULL || options->houseSpec.kind != HOUSE_FIXED || options->saveHousePath != NULL || options->compileHousePath != NULL)) {
+        fprintf(stderr, "--house-image is already a floor plan: it does not take --house, --house-gen, --save-house or --compile-house\n");
+        exit(EXIT_FAILURE);
+    }
 
-    HunterListType hunterList;
-    HunterListType *hunterListPointer = &hunterList;
-    initListOfHunters(hunterListPointer);
+    if (options->profile && options->shards > 0) {
+        fprintf(stderr, "--profile times hunter and ghost threads, which --shards does not have\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (options->coroutines && (options->shards > 0 || options->eventWakeups || options->profile)) {
+        fprintf(stderr, "--coroutines runs every agent on one thread: it does not take --shards, --wake event or --profile\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (options->guardStacks && !options->coroutines && options->houses == 0) {
+        fprintf(stderr, "--guard-stacks guards coroutine stacks: it needs --coroutines or --houses\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (options->tickWorkers > 0 &&
+        (options->shards > 0 || options->coroutines || options->eventWakeups || options->profile ||
+         options->recordPath != NULL || options->replayPath != NULL)) {
+        fprintf(stderr, "--ticks is an engine of its own: it does not take --shards, --coroutines, --wake event, --profile, --record or --replay\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (options->eventWakeups && options->shards > 0) {
+        fprintf(stderr, "--wake event parks hunter threads, which --shards does not have\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if ((options->recordPath != NULL || options->replayPath != NULL) &&
+        (options->shards > 0 || options->runs > 1 || options->forks > 0 ||
+         (options->recordPath != NULL && options->replayPath != NULL))) {
+        fprintf(stderr, "--record and --replay cover one threaded game: use one of them, without --shards, --runs or --forks\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (options->jobs > 1 &&
+        (options->shards > 0 || options->restorePath != NULL || options->checkpointPath != NULL ||
+         options->recordPath != NULL || options->replayPath != NULL || options->telemetryName != NULL)) {
+        fprintf(stderr, "--jobs plays independent --runs games: it does not take --shards, --restore, --checkpoint, --record, --replay or --telemetry\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (options->jobs > options->runs) {
+        options->jobs = options->runs;
+    }
+
+    if (options->houses > 0 &&
+        (options->shards > 0 || options->tickWorkers > 0 || options->jobs > 1 || options->restorePath != NULL ||
+         options->checkpointPath != NULL || options->recordPath != NULL || options->replayPath != NULL ||
+         options->telemetryName != NULL || options->checkEvery > 0 || options->eventWakeups || options->profile)) {
+        fprintf(stderr, "--houses plays independent --runs games as coroutines: it does not take --shards, --ticks, --jobs, --restore, "
+                        "--checkpoint, --record, --replay, --telemetry, --check, --wake event or --profile\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (options->houses > options->runs) {
+        options->houses = options->runs;
+    }
+
+    switch (argc - optind) {
+        case 2:
+            options->hunterRestDuration = parseCount("hunterRestMs", argv[optind], 0);
+            options->ghostRestDuration = parseCount("ghostRestSec", argv[optind + 1], 0);
+            break;
+    }
+}
+
+/***************************************************************************************
+ * Function: void setupHouse(HouseType *house, RunArenaType *arena, const HouseTopologyType *topology)
+ * Description: This function builds a fresh game: it creates the rooms of the run on the
+ *              shared house topology, places the
+ *              ghost in a random room and reads the hunter names from standard input,
+ *              placing every hunter in the van with a unique tool. Batch runs (--runs)
+ *              and the house pool (--houses), whose houses are set up on pool threads,
+ *              name the hunters themselves instead of prompting. The evidence total
+ *              starts again from zero.
+ * Parameters:
+ *      - HouseType *house: The house to build.
+ *      - RunArenaType *arena: The run arena the house is allocated from.
+ *      - const HouseTopologyType *topology: The floor plan, shared read-only with other runs.
+ * Return: None
+ ***************************************************************************************/
+void setupHouse(HouseType *house, RunArenaType *arena, const HouseTopologyType *topology) {
+    initializeHouse(house, arena);
+    buildHouseRooms(house, topology);
 
-    initializeGhost(randInt(0, 4), randomRoom(house.rooms->head)->data, ghostRestDuration, house.ghost);
-    GhostType *ghostPointer = house.ghost;
+    initializeGhost(randInt(0, GHOST_TYPES), randomRoom(house), gameOptions.ghostRestDuration, house->ghost);
+    house->ghost->house = house;
 
-    RoomType *vanRoom = house.rooms->head->data;
+    int vanIndex = 0;
 
-    int toolSize = MAX_HUNTERS;
-    int toolArray[MAX_HUNTERS] = {0, 1, 2, 3};
+    int toolSize = 0;
+    int toolArray[MAX_HUNTERS];
 
     int i = 0;
-    while (i < MAX_HUNTERS) {
+    while (i < gameOptions.hunters && vanIndex < house->roomCount) {
+        if (toolSize == 0) {
+            for (toolSize = 0; toolSize < MAX_HUNTERS; toolSize++) {
+                toolArray[toolSize] = toolSize;
+            }
+        }
+
+        RoomType *vanRoom = &house->rooms[vanIndex];
         char name[MAX_STR];
-        printf("%d. Hunter:\n", i + 1);
-        scanf("%s", name);
+        if (gameOptions.runs > 1 || gameOptions.houses > 0 || gameOptions.hunters != MAX_HUNTERS) {
+            snprintf(name, sizeof(name), "Hunter%d", i + 1);
+        } else {
+            printf("%d. Hunter:\n", i + 1);
+            if (scanf("%63s", name) != 1) {
+                snprintf(name, sizeof(name), "Hunter%d", i + 1);
+            }
+        }
 
         HunterType *currHunterPointer;
-        initializeHunter(name, vanRoom, randomTool(toolArray, &toolSize), hunterRestDuration, &currHunterPointer);
+        initializeHunter(name, vanRoom, randomTool(toolArray, &toolSize), gameOptions.hunterRestDuration, arena, &currHunterPointer);
+        currHunterPointer->house = house;
+        currHunterPointer->id = i;
 
-        printf("[HUNTER INIT] [%s] is a [%s] hunter\n", currHunterPointer->name, evidenceTypeToString(currHunterPointer->evidence));
+        logEvent("[HUNTER INIT] [%s] is a [%s] hunter\n", currHunterPointer->name, evidenceTypeToString(currHunterPointer->evidence));
 
         assignHunterToRoom(vanRoom, currHunterPointer);
-        appendHunterToList(hunterListPointer, currHunterPointer);
-        appendHunterToList(house.hunters, currHunterPointer);
+        appendHunterToList(house->hunters, currHunterPointer);
 
         i++;
+        if (i % MAX_HUNTERS == 0) {
+            vanIndex++;
+        }
+    }
+}
+
+/***************************************************************************************
+ * Function: GameOutcomeType runGame(HouseType *house)
+ * Description: This function runs one game on an already built house: it starts a thread
+ *              for the ghost and for every hunter that has not finished yet, waits for all
+ *              of them and reports the result. With --shards the agents are run by the
+ *              sharded engine instead, with --coroutines as coroutines on the calling
+ *              thread and with --ticks in deterministic ticks; --record logs the run and --replay re-executes a logged one on the
+ *              calling thread.
+ * Parameters:
+ *      - HouseType *house: The house to play in.
+ * Return: The outcome of the game.
+ ***************************************************************************************/
+GameOutcomeType runGame(HouseType *house) {
+    if (gameOptions.directedSearch && house->search == NULL) {
+        buildSearchTable(house);
     }
 
-    pthread_t hunterThreadArray[MAX_HUNTERS];
+    if (gameOptions.shards > 0) {
+        runShardedHouse(house, gameOptions.shards, gameOptions.processes);
+        return reportGame(house);
+    }
+
+    if (gameOptions.checkEvery > 0) {
+        checkHouse(house, "before the game");
+    }
+
+    if (gameOptions.replayPath != NULL) {
+        replayHouse(house);
+        if (gameOptions.checkEvery > 0) {
+            checkHouse(house, "at the end of the game");
+        }
+        return reportGame(house);
+    }
+
+    if (gameOptions.recordPath != NULL && !startRecording(gameOptions.recordPath, house)) {
+        exit(EXIT_FAILURE);
+    }
+
+    if (gameOptions.tickWorkers > 0) {
+        runTickHouse(house, gameOptions.tickWorkers);
+    } else if (gameOptions.coroutines) {
+        runCoroutineHouse(house);
+    } else {
+        runThreadedHouse(house);
+    }
+
+    if (gameOptions.recordPath != NULL && !stopRecording()) {
+        exit(EXIT_FAILURE);
+    }
+
+    if (gameOptions.checkEvery > 0) {
+        checkHouse(house, "at the end of the game");
+    }
+
+    return reportGame(house);
+}
+
+/***************************************************************************************
+ * Function: void runThreadedHouse(HouseType *house)
+ * Description: This function starts a thread for the ghost and for every hunter that has
+ *              not finished yet and waits for all of them.
+ * Parameters:
+ *      - HouseType *house: The house to play in.
+ * Return: None
+ ***************************************************************************************/
+void runThreadedHouse(HouseType *house) {
+    HunterListType *hunterListPointer = house->hunters;
+    GhostType *ghostPointer = house->ghost;
+
+    pthread_t pThreadghost;
+    pthread_t *hunterThreadArray = arenaAlloc(house->arena, hunterListPointer->size * sizeof(pthread_t), _Alignof(pthread_t));
+    int *started = arenaAlloc(house->arena, hunterListPointer->size * sizeof(int), _Alignof(int));
+    memset(started, 0, hunterListPointer->size * sizeof(int));
+
     int j = 0;
-    while (j < MAX_HUNTERS) {
-        pthread_create(&hunterThreadArray[j], NULL, hunterThread, (void *)hunterListPointer->hunterList[j]);
+    while (j < hunterListPointer->size) {
+        if (!hunterListPointer->hunterList[j]->done) {
+            createWorkerThread(&hunterThreadArray[j], j, hunterThread, (void *)hunterListPointer->hunterList[j]);
+            started[j] = C_TRUE;
+        }
         j++;
     }
 
-    pthread_create(&pThreadghost, NULL, ghostThread, (void *)ghostPointer);
+    createWorkerThread(&pThreadghost, hunterListPointer->size, ghostThread, (void *)ghostPointer);
 
     int k = 0;
-    while (k < MAX_HUNTERS) {
-        pthread_join(hunterThreadArray[k], NULL);
+    while (k < hunterListPointer->size) {
+        if (started[k]) {
+            pthread_join(hunterThreadArray[k], NULL);
+        }
         k++;
     }
 
     pthread_join(pThreadghost, NULL);
+}
+
+/***************************************************************************************
+ * Function: GameOutcomeType runTimedGame(HouseType *house, uint64_t *wallNs)
+ * Description: This function runs one game with runGame and measures it. With --latency
+ *              the wall and CPU time of the run go into the run histograms, along with the
+ *              samples the calling thread took while running it.
+ * Parameters:
+ *      - HouseType *house: The house to play in.
+ *      - uint64_t *wallNs: Set to how long the run took.
+ * Return: The outcome of the game.
+ ***************************************************************************************/
+GameOutcomeType runTimedGame(HouseType *house, uint64_t *wallNs) {
+    uint64_t cpuStarted = (latency != NULL) ? processCpuNanoseconds() : 0;
+    uint64_t started = monotonicNanoseconds();
+
+    GameOutcomeType outcome = runGame(house);
+    *wallNs = monotonicNanoseconds() - started;
+
+    if (latency != NULL) {
+        recordLatency(LATENCY_RUN_WALL, *wallNs);
+        recordLatency(LATENCY_RUN_CPU, processCpuNanoseconds() - cpuStarted);
+        latencyFlush();
+    }
+
+    return outcome;
+}
+
+/***************************************************************************************
+ * Function: GameOutcomeType reportGame(HouseType *house)
+ * Description: This function prints the hunters and the winner of a finished game (only
+ *              decides the winner with --quiet).
+ * Parameters:
+ *      - HouseType *house: The finished house.
+ * Return: GameOutcomeType: How the game ended.
+ ***************************************************************************************/
+GameOutcomeType reportGame(HouseType *house) {
+    HunterListType *hunterListPointer = house->hunters;
+    GhostType *ghostPointer = house->ghost;
+
+    if (gameOptions.quiet) {
+        int fearCounter = 0;
+        for (int m = 0; m < hunterListPointer->size; m++) {
+            fearCounter += hunterListPointer->hunterList[m]->fear >= FEAR_MAX;
+        }
+        return decideOutcome(hunterListPointer, ghostPointer, fearCounter);
+    }
 
     int m = 0;
     while (m < hunterListPointer->size) {
@@ -84,18 +643,441 @@ void initializeGame(int argc, char *argv[]) {
 
     printf("\n\nHunters with max fear:\n");
     int fearCounter = getFearLevel(hunterListPointer);
-    getWinner(hunterListPointer, ghostPointer, fearCounter);
+    return getWinner(hunterListPointer, ghostPointer, fearCounter);
+}
+
+/***************************************************************************************
+ * Function: void runContinuations(const void *image, size_t size)
+ * Description: This function forks gameOptions.forks continuations of a mapped snapshot.
+ *              Every child restores the house from the shared (copy-on-write) mapping,
+ *              reseeds the agents with its own seed and plays to the end; its exit status
+ *              is the game outcome. At most one child per online CPU runs at a time and the
+ *              parent prints a tally of the outcomes. A child adds its run to the statistics
+ *              slot of its place among the running children, which the parent merges once it
+ *              has reaped it, so the slots never outnumber the CPUs. If a fork fails no more
+ *              are started, the running children are still reaped and the continuations that
+ *              never started count as failed.
+ * Parameters:
+ *      - const void *image: The mapped snapshot.
+ *      - size_t size: The size of the mapping.
+ * Return: None
+ ***************************************************************************************/
+void runContinuations(const void *image, size_t size) {
+    uint64_t baseSeed = gameOptions.hasSeed ? gameOptions.seed : (uint64_t)time(NULL);
+    long maxRunning = sysconf(_SC_NPROCESSORS_ONLN);
+    int tally[3] = {0, 0, 0};
+    int failed = 0;
+    int running = 0;
+    int forks = gameOptions.forks;
+    RunStatsType stats;
+
+    if (maxRunning < 1) {
+        maxRunning = 1;
+    }
+
+    RunStatsType *slots = mmap(NULL, maxRunning * sizeof(RunStatsType), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    pid_t *slotPids = calloc(maxRunning, sizeof(pid_t));
+
+    if (slots == MAP_FAILED || slotPids == NULL) {
+        perror("Failed to map the continuation statistics");
+        exit(EXIT_FAILURE);
+    }
+    initRunStats(&stats);
+
+    fflush(stdout);
+    flushResults();
+
+    for (int i = 0; i < forks || running > 0; ) {
+        if (i < forks && running < maxRunning) {
+            int slot = 0;
+            while (slotPids[slot] != 0) {
+                slot++;
+            }
+            initRunStats(&slots[slot]);
+
+            pid_t pid = fork();
+
+            if (pid < 0) {
+                perror("Failed to fork continuation");
+                failed += forks - i;
+                forks = i;
+                continue;
+            }
+
+            if (pid == 0) {
+                HouseType house;
+                RunArenaType arena;
+                placeCurrentWorker(i);
+                initRunArena(&arena);
+                if (restoreHouseSnapshot(&house, &arena, image, size) != C_TRUE) {
+                    _exit(C_ARR_ERROR & 0xFF);
+                }
+                uint64_t seed = baseSeed + i;
+                seedHouse(&house, seed);
+
+                uint64_t wallNs;
+                GameOutcomeType outcome = runTimedGame(&house, &wallNs);
+                writeResult(&house, outcome, i, &seed, wallNs);
+                addRunStats(&slots[slot], &house, outcome, wallNs);
+                releaseHouse(&house);
+                releaseRunArena(&arena);
+                flushResults();
+                fflush(stdout);
+                _exit(outcome);
+            }
+
+            slotPids[slot] = pid;
+            running++;
+            i++;
+            continue;
+        }
+
+        int status;
+        pid_t reaped = wait(&status);
+        if (reaped < 0) {
+            break;
+        }
+        running--;
+
+        int slot = 0;
+        while (slot < maxRunning && slotPids[slot] != reaped) {
+            slot++;
+        }
+
+        if (WIFEXITED(status) && WEXITSTATUS(status) <= OUTCOME_UNDETERMINED) {
+            tally[WEXITSTATUS(status)]++;
+            if (slot < maxRunning) {
+                mergeRunStats(&stats, &slots[slot]);
+            }
+        } else {
+            failed++;
+        }
+        if (slot < maxRunning) {
+            slotPids[slot] = 0;
+        }
+    }
+
+    printf("[CONTINUATIONS] %d runs: hunters won %d, ghost won %d, undetermined %d, failed %d\n",
+           gameOptions.forks, tally[OUTCOME_HUNTERS_WIN], tally[OUTCOME_GHOST_WIN], tally[OUTCOME_UNDETERMINED], failed);
+    if (gameOptions.stats) {
+        printRunStats(&stats);
+    }
+
+    munmap(slots, maxRunning * sizeof(RunStatsType));
+    free(slotPids);
+}
+
+/***************************************************************************************
+ * Function: void playRuns(RunArenaType *arena, const HouseTopologyType *topology, uint64_t seed, int first, int stride, int tally[], RunStatsType *stats)
+ * Description: This function plays runs first, first + stride, ... of --runs on the shared
+ *              topology, one after the other in the same arena. Every run builds its house
+ *              from its own stream (seed + run), so a run plays the same whichever worker
+ *              plays it.
+ * Parameters:
+ *      - RunArenaType *arena: The worker's run arena, reset after every run.
+ *      - const HouseTopologyType *topology: The floor plan.
+ *      - uint64_t seed: The base seed.
+ *      - int first: The first run to play.
+ *      - int stride: The distance to the next one.
+ *      - int tally[]: Counts the outcomes, by GameOutcomeType.
+ *      - RunStatsType *stats: The worker's statistics, added to after every run.
+ * Return: None
+ ***************************************************************************************/
+void playRuns(RunArenaType *arena, const HouseTopologyType *topology, uint64_t seed, int first, int stride, int tally[], RunStatsType *stats) {
+    HouseType house;
+    RngType setupRng;
+
+    for (int run = first; run < gameOptions.runs; run += stride) {
+        uint64_t runSeed = seed + run;
+
+        seedRng(&setupRng, runSeed);
+        bindRng(&setupRng);
+        setupHouse(&house, arena, topology);
+        seedHouse(&house, runSeed);
+
+        telemetryBeginRun(&house);
+        uint64_t wallNs;
+        GameOutcomeType outcome = runTimedGame(&house, &wallNs);
+        writeResult(&house, outcome, run, &runSeed, wallNs);
+        telemetryEndRun(outcome);
+        tally[outcome]++;
+        addRunStats(stats, &house, outcome, wallNs);
+
+        // Everything the run allocated goes back at once; the next run reuses the same chunks
+        releaseHouse(&house);
+    }
+
+    bindRng(NULL);
+}
+
+/***************************************************************************************
+ * Function: void runJobs(const HouseTopologyType *topology, uint64_t seed, int tally[], RunStatsType *stats)
+ * Description: This function deals the --runs games out to gameOptions.jobs forked workers,
+ *              worker j playing runs j, j + jobs, ... with an arena of its own. The sealed
+ *              topology is inherited, so every worker reads the same physical pages; only
+ *              the per-run state is private. Outcomes are added up in a shared tally; each
+ *              worker leaves its statistics in a shared slot of its own, merged once every
+ *              worker has exited.
+ * Parameters:
+ *      - const HouseTopologyType *topology: The sealed floor plan.
+ *      - uint64_t seed: The base seed.
+ *      - int tally[]: Counts the outcomes, by GameOutcomeType.
+ *      - RunStatsType *stats: Receives the statistics of every worker.
+ * Return: None
+ ***************************************************************************************/
+void runJobs(const HouseTopologyType *topology, uint64_t seed, int tally[], RunStatsType *stats) {
+    atomic_int *shared = mmap(NULL, 3 * sizeof(atomic_int), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    RunStatsType *slots = mmap(NULL, gameOptions.jobs * sizeof(RunStatsType), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    int failed = 0;
+
+    if (shared == MAP_FAILED || slots == MAP_FAILED) {
+        perror("Failed to map the job tally");
+        exit(EXIT_FAILURE);
+    }
+
+    fflush(stdout);
+    flushResults();
+
+    for (int j = 0; j < gameOptions.jobs; j++) {
+        pid_t pid = fork();
+
+        if (pid < 0) {
+            perror("Failed to fork job");
+            failed++;
+            continue;
+        }
+
+        if (pid == 0) {
+            RunArenaType arena;
+            RunStatsType localStats;
+            int local[3] = {0, 0, 0};
+
+            placeCurrentWorker(j);
+            initRunArena(&arena);
+            initRunStats(&localStats);
+            playRuns(&arena, topology, seed, j, gameOptions.jobs, local, &localStats);
+            releaseRunArena(&arena);
+
+            for (int o = 0; o < 3; o++) {
+                atomic_fetch_add(&shared[o], local[o]);
+            }
+            slots[j] = localStats;
+            flushResults();
+            fflush(stdout);
+            _exit(EXIT_SUCCESS);
+        }
+    }
+
+    int status;
+    while (wait(&status) >= 0) {
+        failed += !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS;
+    }
+
+    for (int o = 0; o < 3; o++) {
+        tally[o] = atomic_load(&shared[o]);
+    }
+    for (int j = 0; j < gameOptions.jobs; j++) {
+        mergeRunStats(stats, &slots[j]);
+    }
+    munmap(shared, 3 * sizeof(atomic_int));
+    munmap(slots, gameOptions.jobs * sizeof(RunStatsType));
+
+    if (failed > 0) {
+        fprintf(stderr, "[JOBS] %d of %d workers failed\n", failed, gameOptions.jobs);
+    }
+}
+
+/***************************************************************************************
+ * Function: void initializeGame(int argc, char *argv[])
+ * Description: This function initializes the game by setting up the house, populating
+ *              rooms, creating hunters and ghosts, and managing the game threads. When a
+ *              snapshot is given the house is restored from it instead, optionally as
+ *              many forked continuations; otherwise --runs games are played back to back.
+ * Parameters:
+ *      - int argc: The number of command-line arguments.
+ *      - char *argv[]: An array of command-line argument strings.
+ * Return: None
+ * CHATGPT ACCESSED DECEMBER 2ND 2023
+ ***************************************************************************************/
+void initializeGame(int argc, char *argv[]) {
+    compileRegistry();
+    parseGameOptions(argc, argv, &gameOptions);
+
+    if (gameOptions.telemetryName != NULL && openTelemetry(gameOptions.telemetryName)) {
+        atexit(closeTelemetry);
+    }
+
+    if (gameOptions.resultsPath != NULL) {
+        if (!openResults(gameOptions.resultsPath, gameOptions.resultsFormat)) {
+            exit(EXIT_FAILURE);
+        }
+        atexit(closeResults);
+    }
+
+    if (gameOptions.latency && openLatency()) {
+        atexit(closeLatency);
+    }
+
+    if (gameOptions.profile && openProfile()) {
+        atexit(closeProfile);
+    }
+
+    if (gameOptions.pinMode != PIN_OFF && loadTopology(gameOptions.pinMode)) {
+        printTopology();
+    }
+
+    // A replay must start from the recorded seed; a recording needs one it can write down
+    if (gameOptions.replayPath != NULL) {
+        if (!openReplay(gameOptions.replayPath, &gameOptions.seed)) {
+            exit(EXIT_FAILURE);
+        }
+        gameOptions.hasSeed = C_TRUE;
+    } else if (gameOptions.recordPath != NULL && !gameOptions.hasSeed) {
+        gameOptions.seed = (uint64_t)time(NULL);
+        gameOptions.hasSeed = C_TRUE;
+    }
+
+    uint64_t seed = gameOptions.hasSeed ? gameOptions.seed : (uint64_t)time(NULL);
+    RngType mainRng;
+    seedRng(&mainRng, seed);
+    bindRng(&mainRng);
+
+    HouseType house;
+    RunArenaType arena;
+    initRunArena(&arena);
+
+    if (gameOptions.restorePath != NULL) {
+        size_t size;
+        const void *image = mapHouseSnapshot(gameOptions.restorePath, &size);
+        if (image == NULL) {
+            exit(EXIT_FAILURE);
+        }
+
+        if (gameOptions.forks > 0) {
+            runContinuations(image, size);
+            unmapHouseSnapshot(image, size);
+            releaseRunArena(&arena);
+            return;
+        }
+
+        int restored = restoreHouseSnapshot(&house, &arena, image, size);
+        unmapHouseSnapshot(image, size);
+        if (restored != C_TRUE) {
+            exit(EXIT_FAILURE);
+        }
+
+        if (gameOptions.hasSeed) {
+            seedHouse(&house, seed);
+        }
+
+        telemetryBeginRun(&house);
+        uint64_t wallNs;
+        GameOutcomeType outcome = runTimedGame(&house, &wallNs);
+        writeResult(&house, outcome, 0, gameOptions.hasSeed ? &seed : NULL, wallNs);
+        telemetryEndRun(outcome);
+        if (gameOptions.stats) {
+            RunStatsType stats;
+            initRunStats(&stats);
+            addRunStats(&stats, &house, outcome, wallNs);
+            printRunStats(&stats);
+        }
+        releaseHouse(&house);
+        releaseRunArena(&arena);
+        return;
+    }
+
+    HouseLayoutType layout;
+    HouseLayoutType *layoutPointer = NULL;
+    HouseTopologyType topology;
+    RunArenaType topologyArena;
+    HouseImageType image;
+    HouseImageType *imagePointer = NULL;
+
+    if (gameOptions.houseImagePath != NULL) {
+        if (!loadHouseImage(&image, gameOptions.houseImagePath)) {
+            exit(EXIT_FAILURE);
+        }
+        imagePointer = &image;
+    } else if (gameOptions.houseFile != NULL) {
+        if (!loadHouseLayout(&layout, gameOptions.houseFile)) {
+            exit(EXIT_FAILURE);
+        }
+        layoutPointer = &layout;
+    } else if (gameOptions.houseSpec.kind != HOUSE_FIXED) {
+        if (!generateHouseLayout(&layout, &gameOptions.houseSpec)) {
+            exit(EXIT_FAILURE);
+        }
+        layoutPointer = &layout;
+    }
+
+    if (gameOptions.saveHousePath != NULL) {
+        if (layoutPointer == NULL) {
+            defaultHouseLayout(&layout);
+            layoutPointer = &layout;
+        }
+        int saved = saveHouseLayout(layoutPointer, gameOptions.saveHousePath);
+        printf("[HOUSE] %d rooms, %d connections written to [%s]\n", layout.roomCount, layout.edgeCount, gameOptions.saveHousePath);
+        releaseHouseLayout(&layout);
+        exit(saved ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    if (gameOptions.compileHousePath != NULL) {
+        if (layoutPointer == NULL) {
+            defaultHouseLayout(&layout);
+            layoutPointer = &layout;
+        }
+        int compiled = compileHouseImage(layoutPointer, gameOptions.compileHousePath);
+        printf("[HOUSE] %d rooms, %d connections compiled into [%s]\n", layout.roomCount, layout.edgeCount, gameOptions.compileHousePath);
+        releaseHouseLayout(&layout);
+        exit(compiled ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    // The floor plan is built once, before any run, and sealed: every run (and every job) shares it
+    initRunArena(&topologyArena);
+    if (imagePointer != NULL) {
+        buildTopologyFromImage(&topology, &topologyArena, imagePointer);
+    } else {
+        if (layoutPointer == NULL) {
+            defaultHouseLayout(&layout);
+            layoutPointer = &layout;
+        }
+        buildTopologyFromLayout(&topology, &topologyArena, layoutPointer, gameOptions.directedSearch);
+        releaseHouseLayout(layoutPointer);
+    }
+    sealRunArena(&topologyArena);
+
+    // Hunters start in the van, MAX_HUNTERS to a room, spilling into the rooms after it
+    if (gameOptions.hunters > MAX_HUNTERS * topology.roomCount) {
+        fprintf(stderr, "--hunters is at most %d in a house of %d rooms (%d per room)\n",
+                MAX_HUNTERS * topology.roomCount, topology.roomCount, MAX_HUNTERS);
+        exit(EXIT_FAILURE);
+    }
 
-    int n = 0;
-    while (n < hunterListPointer->size) {
-        releaseHunterResources(hunterListPointer->hunterList[n]);
-        n++;
+    int tally[3] = {0, 0, 0};
+    RunStatsType stats;
+    initRunStats(&stats);
+
+    if (gameOptions.houses > 0) {
+        runHousePool(&topology, seed, tally, &stats);
+    } else if (gameOptions.jobs > 1) {
+        runJobs(&topology, seed, tally, &stats);
+    } else {
+        playRuns(&arena, &topology, seed, 0, 1, tally, &stats);
     }
+    releaseRunArena(&arena);
+    releaseRunArena(&topologyArena);
 
-    releaseRoomList(house.rooms);
-    free(house.rooms);
-    free(house.hunters);
-    free(house.ghost);
+    if (imagePointer != NULL) {
+        releaseHouseImage(imagePointer);
+    }
+
+    if (gameOptions.runs > 1) {
+        printf("[BATCH] %d runs: hunters won %d, ghost won %d, undetermined %d\n",
+               gameOptions.runs, tally[OUTCOME_HUNTERS_WIN], tally[OUTCOME_GHOST_WIN], tally[OUTCOME_UNDETERMINED]);
+    }
+    if (gameOptions.stats) {
+        printRunStats(&stats);
+    }
 }
 
 /***************************************************************************************
@@ -191,31 +1173,20 @@ int randomTool(int *arr, int *size) {
  * CHATGPT ACCESSED DECEMBER 2ND 2023
  *****************************************************************************************/
 int findingGhost(HunterListType *hunters) {
-    int hasEvidence[4] = {C_FALSE, C_FALSE, C_FALSE, C_FALSE};
+    unsigned evidenceMask = 0;
 
     for (int i = 0; i < hunters->size; i++) {
         EvidenceNodeType *tempEvidenceNode = hunters->hunterList[i]->ghostEvidence->head;
 
         while (tempEvidenceNode != NULL) {
             if (isEvidenceFromGhost(tempEvidenceNode->data) && hunters->hunterList[i]->fear < 100) {
-                int evidenceType = tempEvidenceNode->data->evidenceType;
-                hasEvidence[evidenceType] = C_TRUE;
+                evidenceMask |= 1u << tempEvidenceNode->data->evidenceType;
             }
             tempEvidenceNode = tempEvidenceNode->next;
         }
     }
 
-    if (hasEvidence[0] && hasEvidence[1] && hasEvidence[2]) {
-        return POLTERGEIST;
-    } else if (hasEvidence[0] && hasEvidence[1] && hasEvidence[3]) {
-        return BANSHEE;
-    } else if (hasEvidence[0] && hasEvidence[2] && hasEvidence[3]) {
-        return BULLIES;
-    } else if (hasEvidence[1] && hasEvidence[2] && hasEvidence[3]) {
-        return PHANTOM;
-    } else {
-        return UNKNOWN_GHOST;
-    }
+    return identifyGhost(evidenceMask);
 }
 
 
@@ -230,16 +1201,14 @@ int findingGhost(HunterListType *hunters) {
  *      - HunterListType *list: Pointer to the list of hunters with their evidence.
  *      - GhostType *ghost: Pointer to the ghost entity.
  *      - int fear: The overall fear level calculated from hunters' fear values.
- * Return: None
+ * Return: The outcome of the game.
  * CHATGPT ACCESSED DECEMBER 2ND 2023
  *
  *****************************************************************************************/
-int totalEvidenceCollected = 0;
-
-void getWinner(HunterListType *list, GhostType *ghost, int fear) {
-    int ghostWon = (fear >= 4);
+GameOutcomeType getWinner(HunterListType *list, GhostType *ghost, int fear) {
+    int ghostWon = (fear >= list->size);
 
-    if (totalEvidenceCollected >= 3) {
+    if (atomic_load(&ghost->house->evidenceCollected) >= 3) {
         printf("Hunters win! They have collected enough evidence to identify the ghost.\n");
         printf("\nEvidence collected by hunters:\n");
         for (int i = 0; i < list->size; ++i) {
@@ -247,11 +1216,11 @@ void getWinner(HunterListType *list, GhostType *ghost, int fear) {
             EvidenceNodeType *evidenceNode = hunter->ghostEvidence->head;
             while (evidenceNode != NULL) {
                 EvidenceType *evidence = evidenceNode->data;
-                printf("%s found [%s] in [%s]\n", hunter->name, evidenceTypeToString(evidence->evidenceType), hunter->room->name);
+                printf("%s found [%s] in [%s]\n", hunter->name, evidenceTypeToString(evidence->evidenceType), hunter->room->topology->name);
                 evidenceNode = evidenceNode->next;
             }
         }
-        exit(EXIT_SUCCESS);
+        return OUTCOME_HUNTERS_WIN;
     }
 
     printf("%s\n", ghostWon ? "The ghost won" : (
@@ -260,6 +1229,35 @@ void getWinner(HunterListType *list, GhostType *ghost, int fear) {
         ((GhostClassType)findingGhost(list) == (GhostClassType)UNKNOWN_GHOST) ? "There was not enough ghostly evidence collected to determine the ghost" : 
         ((list->hunterList[0]->evidenceCollected == 4) ? "Hunters win! They have collected enough evidence to identify the ghost.\n" : "The ghost won")
     ));
+
+    return decideOutcome(list, ghost, fear);
+}
+
+
+/*****************************************************************************************
+ * Function: GameOutcomeType decideOutcome(HunterListType *list, GhostType *ghost, int fear)
+ * Description: This function applies the same rules as getWinner without printing anything,
+ *              so quiet runs and forked continuations can still report their outcome.
+ * Parameters:
+ *      - HunterListType *list: Pointer to the list of hunters with their evidence.
+ *      - GhostType *ghost: Pointer to the ghost entity.
+ *      - int fear: The number of hunters that reached the maximum fear.
+ * Return: The outcome of the game.
+ *****************************************************************************************/
+GameOutcomeType decideOutcome(HunterListType *list, GhostType *ghost, int fear) {
+    if (atomic_load(&ghost->house->evidenceCollected) >= 3) {
+        return OUTCOME_HUNTERS_WIN;
+    }
+
+    if (fear >= list->size) {
+        return OUTCOME_GHOST_WIN;
+    }
+
+    if (findingGhost(list) == UNKNOWN_GHOST) {
+        return OUTCOME_UNDETERMINED;
+    }
+
+    return (list->hunterList[0]->evidenceCollected == 4) ? OUTCOME_HUNTERS_WIN : OUTCOME_GHOST_WIN;
 }
 
 
@@ -0,0 +1,212 @@
+#include "defs.h"
+
+/* The --runs games a pool plays, handed out one run at a time: every worker keeps perWorker
+   houses in play and, as soon as one ends, reports it and claims the next run for its slot. */
+typedef struct HousePoolType {
+    const HouseTopologyType *topology;
+    uint64_t seed;
+    int perWorker;
+    atomic_int nextRun;
+} HousePoolType;
+
+/* One of a worker's places for a house: the house, the arena it is built in (reset when the
+   house ends), its run number and when it started. */
+typedef struct PoolSlotType {
+    HouseType house;
+    RunArenaType arena;
+    int run;
+    uint64_t startedAt;
+} PoolSlotType;
+
+typedef struct PoolWorkerType {
+    HousePoolType *pool;
+    PoolSlotType *slots;
+    int tally[3];
+    RunStatsType stats;
+} PoolWorkerType;
+
+/************************************************************************************************
+ * Function: void finishPoolHouse(PoolWorkerType *worker, HouseType *house, int run, uint64_t seed, uint64_t wallNs)
+ * Description: This function reports a house as soon as its last agent is done: its winner
+ *              (printed in one piece even with other workers printing), its record, and its
+ *              outcome in the worker's tally and statistics. Its room semaphores are released;
+ *              its memory goes back when its slot's arena is reset.
+ * Parameters:
+ *      - PoolWorkerType *worker: The worker that played it.
+ *      - HouseType *house: The finished house.
+ *      - int run: Its run number.
+ *      - uint64_t seed: The seed it was built from (the base seed + run).
+ *      - uint64_t wallNs: How long it took, from its setup.
+ * Return: None
+ ************************************************************************************************/
+static void finishPoolHouse(PoolWorkerType *worker, HouseType *house, int run, uint64_t seed, uint64_t wallNs) {
+    if (latency != NULL) {
+        recordLatency(LATENCY_RUN_WALL, wallNs);
+    }
+
+    flockfile(stdout);
+    GameOutcomeType outcome = reportGame(house);
+    funlockfile(stdout);
+
+    writeResult(house, outcome, run, &seed, wallNs);
+    worker->tally[outcome]++;
+    addRunStats(&worker->stats, house, outcome, wallNs);
+    releaseHouseRooms(house);
+}
+
+/************************************************************************************************
+ * Function: int startPoolHouse(PoolWorkerType *worker, PoolSlotType *slot)
+ * Description: This function claims the next run and builds its house in a free slot from its
+ *              own stream (seed + run), as playRuns would build it.
+ * Parameters:
+ *      - PoolWorkerType *worker: The worker.
+ *      - PoolSlotType *slot: The slot, with its arena reset.
+ * Return: C_TRUE if a house was started, C_FALSE once every run has been claimed.
+ ************************************************************************************************/
+static int startPoolHouse(PoolWorkerType *worker, PoolSlotType *slot) {
+    HousePoolType *pool = worker->pool;
+    int run = atomic_fetch_add(&pool->nextRun, 1);
+    RngType setupRng;
+
+    if (run >= gameOptions.runs) {
+        return C_FALSE;
+    }
+
+    seedRng(&setupRng, pool->seed + run);
+    bindRng(&setupRng);
+    setupHouse(&slot->house, &slot->arena, pool->topology);
+    seedHouse(&slot->house, pool->seed + run);
+    if (gameOptions.directedSearch) {
+        buildSearchTable(&slot->house);
+    }
+    bindRng(NULL);
+
+    slot->run = run;
+    slot->startedAt = monotonicNanoseconds();
+    return C_TRUE;
+}
+
+/************************************************************************************************
+ * Function: int refillPoolSlot(void *context, int index)
+ * Description: This function is the scheduler's refill: it reports the house that just ended,
+ *              gives its memory back and starts the next run in the same slot, so the worker
+ *              keeps as many houses in play as there are runs left.
+ * Parameters:
+ *      - void *context: The worker's PoolWorkerType.
+ *      - int index: The slot whose house ended.
+ * Return: C_TRUE if a new house was started in the slot, C_FALSE if none is left to play.
+ ************************************************************************************************/
+static int refillPoolSlot(void *context, int index) {
+    PoolWorkerType *worker = context;
+    PoolSlotType *slot = &worker->slots[index];
+
+    finishPoolHouse(worker, &slot->house, slot->run, worker->pool->seed + slot->run, monotonicNanoseconds() - slot->startedAt);
+    resetRunArena(&slot->arena);
+
+    return startPoolHouse(worker, slot);
+}
+
+/************************************************************************************************
+ * Function: void *poolWorker(void *arg)
+ * Description: This function is the body of a pool thread. It fills its perWorker slots with
+ *              the next runs and plays them as coroutines on this thread; each house is
+ *              reported the moment it ends and its slot takes the next run, until none are
+ *              left. Every slot has its own arena, reset when its house ends; the engine's
+ *              memory comes from the worker's arena.
+ * Parameters:
+ *      - void *arg: The worker's PoolWorkerType.
+ * Return: NULL
+ ************************************************************************************************/
+static void *poolWorker(void *arg) {
+    PoolWorkerType *worker = arg;
+    HousePoolType *pool = worker->pool;
+    RunArenaType arena;
+
+    initRunArena(&arena);
+    worker->slots = arenaAlloc(&arena, pool->perWorker * sizeof(PoolSlotType), CACHE_LINE);
+    HouseType **playing = arenaAlloc(&arena, pool->perWorker * sizeof(HouseType *), _Alignof(HouseType *));
+
+    int count = 0;
+    for (int s = 0; s < pool->perWorker; s++) {
+        initRunArena(&worker->slots[s].arena);
+        // The houses take turns on this thread, so a thread block would be stranded at every switch
+        worker->slots[s].arena.carveDirect = C_TRUE;
+    }
+    while (count < pool->perWorker && startPoolHouse(worker, &worker->slots[count])) {
+        playing[count] = &worker->slots[count].house;
+        count++;
+    }
+
+    if (count > 0) {
+        runCoroutineHouses(playing, count, &arena, refillPoolSlot, worker);
+    }
+    latencyFlush();
+
+    for (int s = 0; s < pool->perWorker; s++) {
+        releaseRunArena(&worker->slots[s].arena);
+    }
+    releaseSearchScratch();
+    releaseRunArena(&arena);
+    return NULL;
+}
+
+/************************************************************************************************
+ * Function: void runHousePool(const HouseTopologyType *topology, uint64_t seed, int tally[], RunStatsType *stats)
+ * Description: This function plays the --runs games with gameOptions.houses of them in play at
+ *              once, spread over gameOptions.poolWorkers threads (one per online CPU by
+ *              default). Each house keeps its own state, ends on its own and is reported on its
+ *              own, and its place is taken by the next run right away; the houses share the
+ *              sealed topology, the threads and the results file. Outcomes are added up in
+ *              tally. Every thread keeps its own statistics, merged into stats after it is
+ *              joined.
+ * Parameters:
+ *      - const HouseTopologyType *topology: The sealed floor plan.
+ *      - uint64_t seed: The base seed.
+ *      - int tally[]: Counts the outcomes, by GameOutcomeType.
+ *      - RunStatsType *stats: Receives the statistics of every thread.
+ * Return: None
+ ************************************************************************************************/
+void runHousePool(const HouseTopologyType *topology, uint64_t seed, int tally[], RunStatsType *stats) {
+    HousePoolType pool;
+    int workerCount = gameOptions.poolWorkers;
+
+    if (workerCount < 1) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        workerCount = (online > 0) ? (int)online : 1;
+    }
+    if (workerCount > gameOptions.houses) {
+        workerCount = gameOptions.houses;
+    }
+
+    pool.topology = topology;
+    pool.seed = seed;
+    pool.perWorker = (gameOptions.houses + workerCount - 1) / workerCount;
+    atomic_init(&pool.nextRun, 0);
+
+    PoolWorkerType *workers = calloc(workerCount, sizeof(PoolWorkerType));
+    pthread_t *threads = calloc(workerCount, sizeof(pthread_t));
+
+    if (workers == NULL || threads == NULL) {
+        perror("Failed to allocate the house pool");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int w = 0; w < workerCount; w++) {
+        workers[w].pool = &pool;
+        if (createWorkerThread(&threads[w], w, poolWorker, &workers[w]) != 0) {
+            perror("Failed to start pool worker");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (int w = 0; w < workerCount; w++) {
+        pthread_join(threads[w], NULL);
+        for (int o = 0; o < 3; o++) {
+            tally[o] += workers[w].tally[o];
+        }
+        mergeRunStats(stats, &workers[w].stats);
+    }
+
+    free(workers);
+    free(threads);
+}
@@ -0,0 +1,162 @@
+#include "defs.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+
+/************************************************************************************************
+ * pp-top: a live viewer for the telemetry segment published by FP --telemetry NAME.
+ * Usage: pp-top [NAME] [intervalMs] [--once]
+ ************************************************************************************************/
+
+/************************************************************************************************
+ * Function: uint64_t loadCounter(_Atomic uint64_t *counter)
+ * Description: This function reads a published counter.
+ * Parameters:
+ *      - _Atomic uint64_t *counter: The counter to read.
+ * Return: uint64_t: The current value.
+ ************************************************************************************************/
+static uint64_t loadCounter(_Atomic uint64_t *counter) {
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+/************************************************************************************************
+ * Function: double monotonicSeconds(void)
+ * Description: This function returns the monotonic clock in seconds.
+ * Parameters: None
+ * Return: double: The current time.
+ ************************************************************************************************/
+static double monotonicSeconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/************************************************************************************************
+ * Function: void drawTelemetry(TelemetryType *segment, const char *name, double stepsPerSecond, int clear)
+ * Description: This function prints one screen of counters, fear, boredom and room occupancy.
+ * Parameters:
+ *      - TelemetryType *segment: The mapped segment.
+ *      - const char *name: The segment name.
+ *      - double stepsPerSecond: The agent step rate since the last screen.
+ *      - int clear: Whether to clear the terminal first.
+ * Return: None
+ ************************************************************************************************/
+static void drawTelemetry(TelemetryType *segment, const char *name, double stepsPerSecond, int clear) {
+    if (clear) {
+        printf("\033[H\033[2J");
+    }
+
+    int finished = atomic_load_explicit(&segment->finished, memory_order_relaxed);
+    printf("pp-top  %s  pid %d  %s\n\n", name, segment->pid, finished ? "[FINISHED]" : "[RUNNING]");
+
+    printf("Runs completed     %12llu  (hunters %llu, ghost %llu)\n",
+           (unsigned long long)loadCounter(&segment->runsCompleted),
+           (unsigned long long)loadCounter(&segment->runsHuntersWon),
+           (unsigned long long)loadCounter(&segment->runsGhostWon));
+    printf("Agent steps        %12llu  (%.0f/s)\n", (unsigned long long)loadCounter(&segment->agentSteps), stepsPerSecond);
+    printf("Evidence produced  %12llu\n", (unsigned long long)loadCounter(&segment->evidenceProduced));
+    printf("Evidence collected %12llu\n", (unsigned long long)loadCounter(&segment->evidenceCollected));
+    printf("Moves / failures   %12llu / %llu\n",
+           (unsigned long long)loadCounter(&segment->moves),
+           (unsigned long long)loadCounter(&segment->moveFailures));
+
+    printf("\nGhost boredom %d in room %d\n",
+           atomic_load_explicit(&segment->ghostBoredom, memory_order_relaxed),
+           atomic_load_explicit(&segment->ghostRoom, memory_order_relaxed));
+
+    int hunterCount = atomic_load_explicit(&segment->hunterCount, memory_order_relaxed);
+    printf("\n%-20s %6s %6s\n", "HUNTER", "FEAR", "TIMER");
+    for (int i = 0; i < hunterCount && i < MAX_HUNTERS; i++) {
+        printf("%-20.20s %6d %6d\n", segment->hunterNames[i],
+               atomic_load_explicit(&segment->hunterFear[i], memory_order_relaxed),
+               atomic_load_explicit(&segment->hunterTimer[i], memory_order_relaxed));
+    }
+
+    int roomCount = atomic_load_explicit(&segment->roomCount, memory_order_relaxed);
+    printf("\n%-4s %-24s %s\n", "ID", "ROOM", "HUNTERS");
+    for (int i = 0; i < roomCount && i < TELEMETRY_MAX_ROOMS; i++) {
+        printf("%-4d %-24.24s %d\n", i, segment->roomNames[i],
+               atomic_load_explicit(&segment->roomOccupancy[i], memory_order_relaxed));
+    }
+
+    fflush(stdout);
+}
+
+/************************************************************************************************
+ * Function: int main(int argc, char *argv[])
+ * Description: This function maps the telemetry segment read-only and redraws it every
+ *              interval until the simulator finishes (or once with --once). An interval
+ *              that is not a whole number of at least 1 ms is refused.
+ * Parameters:
+ *      - int argc: The number of command-line arguments.
+ *      - char *argv[]: An array of command-line argument strings.
+ * Return: The exit code.
+ ************************************************************************************************/
+int main(int argc, char *argv[]) {
+    const char *name = "/phantom-pulse";
+    int intervalMs = 1000;
+    int once = C_FALSE;
+    int positional = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--once") == 0) {
+            once = C_TRUE;
+        } else if (positional++ == 0) {
+            name = argv[i];
+        } else {
+            char *end;
+            errno = 0;
+            long value = strtol(argv[i], &end, 10);
+
+            // A zero or negative interval would redraw in a busy loop
+            if (end == argv[i] || *end != '\0' || errno == ERANGE || value < 1 || value > INT_MAX) {
+                fprintf(stderr, "intervalMs needs a whole number of at least 1, not [%s]\n", argv[i]);
+                fprintf(stderr, "Usage: %s [NAME] [intervalMs] [--once]\n", argv[0]);
+                return EXIT_FAILURE;
+            }
+            intervalMs = (int)value;
+        }
+    }
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        perror("Failed to open telemetry segment");
+        return EXIT_FAILURE;
+    }
+
+    TelemetryType *segment = mmap(NULL, sizeof(TelemetryType), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (segment == MAP_FAILED || segment->magic != TELEMETRY_MAGIC) {
+        fprintf(stderr, "[%s] is not a PhantomPulse telemetry segment\n", name);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t lastSteps = loadCounter(&segment->agentSteps);
+    double lastTime = monotonicSeconds();
+
+    if (once) {
+        drawTelemetry(segment, name, 0.0, C_FALSE);
+        return EXIT_SUCCESS;
+    }
+
+    while (C_TRUE) {
+        struct timespec sleepTime = { intervalMs / 1000, (intervalMs % 1000) * 1000000L };
+        nanosleep(&sleepTime, NULL);
+
+        uint64_t steps = loadCounter(&segment->agentSteps);
+        double now = monotonicSeconds();
+        drawTelemetry(segment, name, (steps - lastSteps) / (now - lastTime), C_TRUE);
+        lastSteps = steps;
+        lastTime = now;
+
+        if (atomic_load_explicit(&segment->finished, memory_order_relaxed)) {
+            break;
+        }
+    }
+
+    munmap(segment, sizeof(TelemetryType));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,199 @@
+#include "defs.h"
+#include <sys/mman.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+ProfileTotalsType *profile = NULL;
+
+/* The phase clock of one agent thread; active only between profileStart and profileStop. */
+typedef struct ProfileThreadType {
+    int active;
+    ProfileAgentType agent;
+    ProfilePhaseType phase;
+    uint64_t last;
+    uint64_t turns;
+    uint64_t ticks[PROFILE_PHASES];
+} ProfileThreadType;
+
+static _Thread_local ProfileThreadType profileThread;
+static pid_t profileOwner = 0;
+static uint64_t profileStartTicks = 0;
+static uint64_t profileStartNs = 0;
+
+static const char *profileAgentNames[PROFILE_AGENTS] = { "hunter", "ghost" };
+static const char *profilePhaseNames[PROFILE_PHASES] = { "sleep", "lock acquire", "action body", "logging", "termination check" };
+
+/************************************************************************************************
+ * Function: uint64_t rawNanoseconds(void)
+ * Description: This function reads CLOCK_MONOTONIC_RAW, which is not slewed by NTP.
+ * Parameters: None
+ * Return: The clock in nanoseconds.
+ ************************************************************************************************/
+static uint64_t rawNanoseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/************************************************************************************************
+ * Function: uint64_t profileTicks(void)
+ * Description: This function reads the profile clock: the time stamp counter on x86, the raw
+ *              monotonic clock in nanoseconds elsewhere.
+ * Parameters: None
+ * Return: The clock in ticks.
+ ************************************************************************************************/
+static uint64_t profileTicks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return rawNanoseconds();
+#endif
+}
+
+/************************************************************************************************
+ * Function: int openProfile(void)
+ * Description: This function maps the shared phase totals and notes the clocks, so the report
+ *              can turn ticks into nanoseconds. Until it is called every profile hook is a
+ *              single NULL check.
+ * Parameters: None
+ * Return: C_TRUE if the totals are mapped, C_FALSE otherwise.
+ ************************************************************************************************/
+int openProfile(void) {
+    void *totals = mmap(NULL, sizeof(ProfileTotalsType), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (totals == MAP_FAILED) {
+        perror("Failed to map profile totals");
+        return C_FALSE;
+    }
+
+    profile = totals;
+    profileOwner = getpid();
+    profileStartNs = rawNanoseconds();
+    profileStartTicks = profileTicks();
+    return C_TRUE;
+}
+
+/************************************************************************************************
+ * Function: void profileStart(ProfileAgentType agent)
+ * Description: This function starts the phase clock of the calling agent thread, in the sleep
+ *              phase.
+ * Parameters:
+ *      - ProfileAgentType agent: The kind of agent the thread runs.
+ * Return: None
+ ************************************************************************************************/
+void profileStart(ProfileAgentType agent) {
+    if (profile == NULL) {
+        return;
+    }
+
+    memset(&profileThread, 0, sizeof(profileThread));
+    profileThread.active = C_TRUE;
+    profileThread.agent = agent;
+    profileThread.phase = PROFILE_SLEEP;
+    profileThread.last = profileTicks();
+}
+
+/************************************************************************************************
+ * Function: int profileSwitch(ProfilePhaseType phase)
+ * Description: This function charges the ticks since the last switch to the current phase and
+ *              moves the calling thread into another. Threads that are not profiled (the main
+ *              thread, shard workers) are left alone.
+ * Parameters:
+ *      - ProfilePhaseType phase: The phase the thread enters.
+ * Return: The phase it was in, or -1 if the thread is not profiled.
+ ************************************************************************************************/
+int profileSwitch(ProfilePhaseType phase) {
+    if (!profileThread.active) {
+        return -1;
+    }
+
+    uint64_t now = profileTicks();
+    ProfilePhaseType previous = profileThread.phase;
+
+    profileThread.ticks[previous] += now - profileThread.last;
+    profileThread.last = now;
+    profileThread.phase = phase;
+    return (int)previous;
+}
+
+/************************************************************************************************
+ * Function: void profileTurn(void)
+ * Description: This function marks the start of a turn of the calling agent thread, which
+ *              begins with its rest.
+ * Parameters: None
+ * Return: None
+ ************************************************************************************************/
+void profileTurn(void) {
+    if (profileSwitch(PROFILE_SLEEP) >= 0) {
+        profileThread.turns++;
+    }
+}
+
+/************************************************************************************************
+ * Function: void profileStop(void)
+ * Description: This function stops the phase clock of the calling thread and adds its totals
+ *              to those of its agent type.
+ * Parameters: None
+ * Return: None
+ ************************************************************************************************/
+void profileStop(void) {
+    if (profileSwitch(PROFILE_CHECK) < 0) {
+        return;
+    }
+
+    ProfileAgentType agent = profileThread.agent;
+    for (int phase = 0; phase < PROFILE_PHASES; phase++) {
+        atomic_fetch_add_explicit(&profile->ticks[agent][phase], profileThread.ticks[phase], memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&profile->turns[agent], profileThread.turns, memory_order_relaxed);
+    atomic_fetch_add_explicit(&profile->threads[agent], 1, memory_order_relaxed);
+    profileThread.active = C_FALSE;
+}
+
+/************************************************************************************************
+ * Function: void closeProfile(void)
+ * Description: This function prints, for each agent type, how its threads' time split across
+ *              the phases (ticks and nanoseconds per turn, and share of the total), then unmaps
+ *              the totals. Only the process that mapped them reports.
+ * Parameters: None
+ * Return: None
+ ************************************************************************************************/
+void closeProfile(void) {
+    if (profile == NULL || getpid() != profileOwner) {
+        return;
+    }
+
+    uint64_t elapsedNs = rawNanoseconds() - profileStartNs;
+    uint64_t elapsedTicks = profileTicks() - profileStartTicks;
+    double nsPerTick = (elapsedTicks > 0) ? (double)elapsedNs / (double)elapsedTicks : 1.0;
+
+    for (int agent = 0; agent < PROFILE_AGENTS; agent++) {
+        uint64_t turns = atomic_load(&profile->turns[agent]);
+        uint64_t total = 0;
+
+        if (turns == 0) {
+            continue;
+        }
+
+        for (int phase = 0; phase < PROFILE_PHASES; phase++) {
+            total += atomic_load(&profile->ticks[agent][phase]);
+        }
+
+        char title[MAX_STR];
+        snprintf(title, sizeof(title), "%s: %llu threads, %llu turns", profileAgentNames[agent],
+                 (unsigned long long)atomic_load(&profile->threads[agent]), (unsigned long long)turns);
+        printf("[PROFILE] %-32s %14s %14s %7s\n", title, "ticks/turn", "ns/turn", "share");
+
+        for (int phase = 0; phase < PROFILE_PHASES; phase++) {
+            uint64_t ticks = atomic_load(&profile->ticks[agent][phase]);
+            double perTurn = (double)ticks / (double)turns;
+
+            printf("[PROFILE]   %-30s %14.0f %14.0f %6.2f%%\n", profilePhaseNames[phase], perTurn, perTurn * nsPerTick,
+                   (total > 0) ? 100.0 * (double)ticks / (double)total : 0.0);
+        }
+    }
+
+    munmap(profile, sizeof(ProfileTotalsType));
+    profile = NULL;
+}
@@ -0,0 +1,94 @@
+#include "defs.h"
+#include <math.h>
+
+/************************************************************************************************
+ * The ghost and evidence registry. Every fact about an evidence type (its name, the readings
+ * found without a ghost, the readings a ghost leaves and which readings count as ghostly) and
+ * about a ghost type (its name and the evidence it leaves) lives in these two tables.
+ * compileRegistry turns them into the lookups the simulation uses.
+ ************************************************************************************************/
+EvidenceInfoType evidenceRegistry[EVIDENCE_TYPES] = {
+    [EMF]          = { "EMF",          0.0f, 4.90f,  4.7f,  5.0f,  4.90, C_FALSE,  5.00, C_TRUE  },
+    [TEMPERATURE]  = { "TEMPERATURE",  0.0f, 27.00f, -10.0f, 1.0f, -10.0, C_TRUE,  0.0,  C_FALSE },
+    [FINGERPRINTS] = { "FINGERPRINTS", 0.0f, 0.0f,   1.0f,  1.0f,  1.00, C_TRUE,   1.00, C_TRUE  },
+    [SOUND]        = { "SOUND",        40.0f, 70.0f, 65.0f, 75.0f, 70.00, C_FALSE, 75.00, C_TRUE  },
+};
+
+GhostInfoType ghostRegistry[GHOST_TYPES] = {
+    [POLTERGEIST] = { "POLTERGEIST", (1 << EMF) | (1 << TEMPERATURE) | (1 << FINGERPRINTS) },
+    [BANSHEE]     = { "BANSHEE",     (1 << EMF) | (1 << TEMPERATURE) | (1 << SOUND) },
+    [BULLIES]     = { "BULLIES",     (1 << EMF) | (1 << FINGERPRINTS) | (1 << SOUND) },
+    [PHANTOM]     = { "PHANTOM",     (1 << TEMPERATURE) | (1 << FINGERPRINTS) | (1 << SOUND) },
+};
+
+/* Which ghost a set of ghostly evidence types identifies, indexed by evidence mask. */
+static int ghostByMask[1 << EVIDENCE_TYPES];
+
+/************************************************************************************************
+ * Function: float floatBelow(double bound, int inclusive)
+ * Description: This function finds the float threshold t such that, for any float reading r,
+ *              "r > t" means the same as "r > bound" (or "r >= bound" when inclusive). Readings
+ *              are floats while the registry bounds are written as doubles.
+ * Parameters:
+ *      - double bound: The bound as written in the registry.
+ *      - int inclusive: Whether the bound itself is in the range.
+ * Return: The threshold.
+ ************************************************************************************************/
+static float floatBelow(double bound, int inclusive) {
+    float threshold = (float)bound;
+
+    if ((double)threshold > bound || (inclusive && (double)threshold == bound)) {
+        threshold = nextafterf(threshold, -INFINITY);
+    }
+
+    return threshold;
+}
+
+/************************************************************************************************
+ * Function: void compileRegistry(void)
+ * Description: This function prepares the registry lookups: each ghostly range becomes one pair
+ *              of float thresholds (ghostly means above < reading <= upTo), each ghost's mask
+ *              becomes the list of evidence types it leaves, and every evidence mask is mapped to
+ *              the first ghost whose signature it contains. It must run before the first game.
+ * Parameters: None
+ * Return: None
+ ************************************************************************************************/
+void compileRegistry(void) {
+    for (int e = 0; e < EVIDENCE_TYPES; e++) {
+        EvidenceInfoType *info = &evidenceRegistry[e];
+        info->ghostlyAbove = floatBelow(info->ghostlyLow, info->lowInclusive);
+        info->ghostlyUpTo = floatBelow(info->ghostlyHigh, !info->highInclusive);
+    }
+
+    for (int g = 0; g < GHOST_TYPES; g++) {
+        GhostInfoType *info = &ghostRegistry[g];
+        int count = 0;
+
+        for (int e = 0; e < EVIDENCE_TYPES && count < EVIDENCE_PER_GHOST; e++) {
+            if (info->evidenceMask & (1u << e)) {
+                info->leaves[count++] = (EvidenceClassType)e;
+            }
+        }
+    }
+
+    for (unsigned mask = 0; mask < (1u << EVIDENCE_TYPES); mask++) {
+        ghostByMask[mask] = UNKNOWN_GHOST;
+
+        for (int g = GHOST_TYPES - 1; g >= 0; g--) {
+            if ((mask & ghostRegistry[g].evidenceMask) == ghostRegistry[g].evidenceMask) {
+                ghostByMask[mask] = g;
+            }
+        }
+    }
+}
+
+/************************************************************************************************
+ * Function: int identifyGhost(unsigned evidenceMask)
+ * Description: This function names the ghost that a set of ghostly evidence types points to.
+ * Parameters:
+ *      - unsigned evidenceMask: One bit per evidence type found to be ghostly.
+ * Return: The GhostClassType, or UNKNOWN_GHOST if no ghost matches.
+ ************************************************************************************************/
+int identifyGhost(unsigned evidenceMask) {
+    return ghostByMask[evidenceMask & ((1u << EVIDENCE_TYPES) - 1)];
+}
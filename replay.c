@@ -0,0 +1,301 @@
+#include "defs.h"
+
+#define REPLAY_MAGIC   "PPREC1"
+#define REPLAY_VERSION 1
+#define REPLAY_NO_TURN -2
+
+/*
+ * On-disk layout (native byte order):
+ *   ReplayHeaderType
+ *   ReplayEventType   events[]   (until the end of the file)
+ * Every agent turn is a REPLAY_TURN event, the REPLAY_LOCK events of the rooms it locked (in
+ * order, with whether a try-lock succeeded) and a REPLAY_END event carrying the number of random
+ * draws it made and its generator state afterwards.
+ */
+typedef struct ReplayHeaderType {
+    char magic[8];
+    uint32_t version;
+    int32_t hunterCount;
+    int32_t roomCount;
+    int32_t padding;
+    uint64_t seed;
+} ReplayHeaderType;
+
+typedef enum { REPLAY_TURN, REPLAY_LOCK, REPLAY_END } ReplayEventKindType;
+
+typedef struct ReplayEventType {
+    int32_t kind;
+    int32_t agent;
+    uint32_t value;
+    int32_t locked;
+    uint64_t rng;
+} ReplayEventType;
+
+ReplayModeType replayMode = REPLAY_OFF;
+
+static FILE *replayFile = NULL;
+static ReplayHeaderType replayHeader;
+static pthread_mutex_t turnMutex = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long long turnCount = 0;
+static int recordFailed = C_FALSE;
+static _Thread_local int turnAgent = REPLAY_NO_TURN;
+static _Thread_local uint64_t turnDraws = 0;
+
+/************************************************************************************************
+ * Function: void writeEvent(int kind, int agent, uint32_t value, int locked, uint64_t rng)
+ * Description: This function appends one event to the recording. The caller holds the turn.
+ * Parameters:
+ *      - int kind: The ReplayEventKindType.
+ *      - int agent: The hunter id, or REPLAY_GHOST.
+ *      - uint32_t value: The room id of a lock, the random draws of a finished turn.
+ *      - int locked: Whether a lock was taken.
+ *      - uint64_t rng: The agent's generator state after a finished turn.
+ * Return: None
+ ************************************************************************************************/
+static void writeEvent(int kind, int agent, uint32_t value, int locked, uint64_t rng) {
+    ReplayEventType event = { kind, agent, value, locked, rng };
+
+    if (!recordFailed && fwrite(&event, sizeof(event), 1, replayFile) != 1) {
+        recordFailed = C_TRUE;
+    }
+}
+
+/************************************************************************************************
+ * Function: void readEvent(int kind, int agent, ReplayEventType *event)
+ * Description: This function reads the next event of the recording and stops the replay if it
+ *              is not the kind of event (for the agent) the replayed run just produced.
+ * Parameters:
+ *      - int kind: The ReplayEventKindType expected.
+ *      - int agent: The agent expected.
+ *      - ReplayEventType *event: Filled with the event read.
+ * Return: None
+ ************************************************************************************************/
+static void readEvent(int kind, int agent, ReplayEventType *event) {
+    if (fread(event, sizeof(*event), 1, replayFile) != 1) {
+        fprintf(stderr, "Replay diverged at turn %llu: the recording ends early\n", turnCount);
+        exit(EXIT_FAILURE);
+    }
+
+    if (event->kind != kind || event->agent != agent) {
+        fprintf(stderr, "Replay diverged at turn %llu: agent %d did event %d, agent %d did event %d when recorded\n",
+                turnCount, agent, kind, event->agent, event->kind);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/************************************************************************************************
+ * Function: int startRecording(const char *path, HouseType *house)
+ * Description: This function starts recording the run about to be played in the house: from
+ *              now on agent turns are taken one at a time and logged to the file.
+ * Parameters:
+ *      - const char *path: The recording to write.
+ *      - HouseType *house: The house, with its agents seeded from gameOptions.seed.
+ * Return: C_TRUE on success, C_FALSE if the file could not be written.
+ ************************************************************************************************/
+int startRecording(const char *path, HouseType *house) {
+    ReplayHeaderType header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+    header.version = REPLAY_VERSION;
+    header.hunterCount = house->hunters->size;
+    header.roomCount = house->roomCount;
+    header.seed = gameOptions.seed;
+
+    replayFile = fopen(path, "wb");
+    if (replayFile == NULL) {
+        perror("Failed to open recording for writing");
+        return C_FALSE;
+    }
+
+    recordFailed = fwrite(&header, sizeof(header), 1, replayFile) != 1;
+    turnCount = 0;
+    replayMode = REPLAY_RECORDING;
+    return C_TRUE;
+}
+
+/************************************************************************************************
+ * Function: int stopRecording(void)
+ * Description: This function finishes the recording once every agent thread has been joined.
+ * Parameters: None
+ * Return: C_TRUE if the whole run was written, C_FALSE otherwise.
+ ************************************************************************************************/
+int stopRecording(void) {
+    replayMode = REPLAY_OFF;
+
+    if (fclose(replayFile) != 0) {
+        recordFailed = C_TRUE;
+    }
+    replayFile = NULL;
+
+    if (recordFailed) {
+        perror("Failed to write recording");
+        return C_FALSE;
+    }
+
+    logEvent("[RECORD] %llu turns recorded\n", turnCount);
+    return C_TRUE;
+}
+
+/************************************************************************************************
+ * Function: int openReplay(const char *path, uint64_t *seed)
+ * Description: This function opens a recording for replay and returns the seed it was made
+ *              with, which the house has to be built from for the replay to match.
+ * Parameters:
+ *      - const char *path: The recording to read.
+ *      - uint64_t *seed: Set to the recorded seed.
+ * Return: C_TRUE on success, C_FALSE if the file is not a recording.
+ ************************************************************************************************/
+int openReplay(const char *path, uint64_t *seed) {
+    replayFile = fopen(path, "rb");
+    if (replayFile == NULL) {
+        perror("Failed to open recording");
+        return C_FALSE;
+    }
+
+    if (fread(&replayHeader, sizeof(replayHeader), 1, replayFile) != 1 ||
+        memcmp(replayHeader.magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0 || replayHeader.version != REPLAY_VERSION) {
+        fprintf(stderr, "[%s] is not a PhantomPulse recording\n", path);
+        fclose(replayFile);
+        replayFile = NULL;
+        return C_FALSE;
+    }
+
+    *seed = replayHeader.seed;
+    return C_TRUE;
+}
+
+/************************************************************************************************
+ * Function: void replayHouse(HouseType *house)
+ * Description: This function re-executes a recorded run on the calling thread: it hands each
+ *              turn to the agent that took it, in recorded order, without resting in between.
+ *              Every lock outcome, draw count and generator state is checked against the
+ *              recording and the replay stops at the first difference.
+ * Parameters:
+ *      - HouseType *house: The house, built with the same options and the recorded seed.
+ * Return: None
+ ************************************************************************************************/
+void replayHouse(HouseType *house) {
+    HunterListType *hunters = house->hunters;
+    ReplayEventType event;
+    int ghostSteps = 0;
+
+    if (hunters->size != replayHeader.hunterCount || house->roomCount != replayHeader.roomCount) {
+        fprintf(stderr, "Recording was made with %d hunters in %d rooms, not %d in %d\n",
+                replayHeader.hunterCount, replayHeader.roomCount, hunters->size, house->roomCount);
+        exit(EXIT_FAILURE);
+    }
+
+    turnCount = 0;
+    replayMode = REPLAY_REPLAYING;
+
+    while (fread(&event, sizeof(event), 1, replayFile) == 1) {
+        if (event.kind != REPLAY_TURN || event.agent < REPLAY_GHOST || event.agent >= hunters->size) {
+            fprintf(stderr, "Replay diverged at turn %llu: the recording expects event %d of agent %d\n",
+                    turnCount, event.kind, event.agent);
+            exit(EXIT_FAILURE);
+        }
+
+        if (event.agent == REPLAY_GHOST) {
+            bindRng(&house->ghost->rng);
+            ghostTurn(house->ghost, ++ghostSteps);
+        } else {
+            bindRng(&hunters->hunterList[event.agent]->rng);
+            hunterTurn(hunters->hunterList[event.agent]);
+        }
+    }
+
+    bindRng(NULL);
+    releaseSearchScratch();
+    replayMode = REPLAY_OFF;
+    fclose(replayFile);
+    replayFile = NULL;
+
+    logEvent("[REPLAY] %llu turns replayed\n", turnCount);
+}
+
+/************************************************************************************************
+ * Function: void beginTurn(int agent)
+ * Description: This function starts a turn of an agent. While recording it waits until no
+ *              other agent is in a turn, so the recorded order is the order things happened in.
+ * Parameters:
+ *      - int agent: The hunter id, or REPLAY_GHOST.
+ * Return: None
+ ************************************************************************************************/
+void beginTurn(int agent) {
+    if (replayMode == REPLAY_RECORDING) {
+        pthread_mutex_lock(&turnMutex);
+        writeEvent(REPLAY_TURN, agent, 0, C_FALSE, 0);
+    } else if (replayMode == REPLAY_OFF) {
+        return;
+    }
+
+    turnAgent = agent;
+    turnDraws = randomDraws();
+}
+
+/************************************************************************************************
+ * Function: void endTurn(int agent, const RngType *rng)
+ * Description: This function ends the turn started with beginTurn, recording (or checking) how
+ *              many random numbers the agent drew and where its generator ended up.
+ * Parameters:
+ *      - int agent: The hunter id, or REPLAY_GHOST.
+ *      - const RngType *rng: The agent's generator.
+ * Return: None
+ ************************************************************************************************/
+void endTurn(int agent, const RngType *rng) {
+    if (replayMode == REPLAY_OFF) {
+        return;
+    }
+
+    uint32_t draws = (uint32_t)(randomDraws() - turnDraws);
+    turnAgent = REPLAY_NO_TURN;
+
+    if (replayMode == REPLAY_RECORDING) {
+        writeEvent(REPLAY_END, agent, draws, C_FALSE, rng->state);
+        turnCount++;
+        pthread_mutex_unlock(&turnMutex);
+        return;
+    }
+
+    ReplayEventType event;
+    readEvent(REPLAY_END, agent, &event);
+
+    if (event.value != draws || event.rng != rng->state) {
+        fprintf(stderr, "Replay diverged at turn %llu: agent %d made %u draws (recorded %u)\n",
+                turnCount, agent, draws, event.value);
+        exit(EXIT_FAILURE);
+    }
+    turnCount++;
+}
+
+/************************************************************************************************
+ * Function: int noteRoomLock(RoomType *room, int locked)
+ * Description: This function logs a room lock taken (or tried) during a turn. When replaying
+ *              it checks that the same room is locked and returns whether the recorded attempt
+ *              succeeded, so a try-lock that failed under contention fails again.
+ * Parameters:
+ *      - RoomType *room: The room.
+ *      - int locked: Whether the lock was taken.
+ * Return: Whether the caller should consider the room locked.
+ ************************************************************************************************/
+int noteRoomLock(RoomType *room, int locked) {
+    if (turnAgent == REPLAY_NO_TURN) {
+        return locked;
+    }
+
+    if (replayMode == REPLAY_RECORDING) {
+        writeEvent(REPLAY_LOCK, turnAgent, room->id, locked, 0);
+        return locked;
+    }
+
+    ReplayEventType event;
+    readEvent(REPLAY_LOCK, turnAgent, &event);
+
+    if (event.value != (uint32_t)room->id) {
+        fprintf(stderr, "Replay diverged at turn %llu: agent %d locked room %d, room %u when recorded\n",
+                turnCount, turnAgent, room->id, event.value);
+        exit(EXIT_FAILURE);
+    }
+
+    return event.locked;
+}
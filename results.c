@@ -0,0 +1,392 @@
+#include "defs.h"
+#include <errno.h>
+#include <fcntl.h>
+
+#define RESULTS_BUFFER_SIZE (64 * 1024)
+
+/*
+ * One record per run, written through a fixed buffer with no formatting calls or allocation:
+ *   jsonl  one object per line, with the hunters as an array
+ *   csv    one row per hunter (run columns repeated), after a header row
+ * The file is opened O_APPEND and every flush is a single write of whole records, so forked
+ * continuations and --jobs workers can share it without their lines interleaving: a buffer that
+ * fills up in the middle of a record writes out the records before it and keeps the partial one.
+ * Threads playing houses side by side (--houses) append whole records under resultsLock.
+ */
+static const char *outcomeNames[] = { "hunters", "ghost", "undetermined" };
+
+static int resultsFd = -1;
+static pid_t resultsOwner = 0;
+static ResultsFormatType resultsFormat = RESULTS_JSONL;
+static size_t resultsLength = 0;
+static size_t recordStart = 0;
+static pthread_mutex_t resultsLock = PTHREAD_MUTEX_INITIALIZER;
+static char resultsBuffer[RESULTS_BUFFER_SIZE];
+
+/************************************************************************************************
+ * Function: int openResults(const char *path, ResultsFormatType format)
+ * Description: This function creates (or truncates) the results file. Until it is called
+ *              writeResult does nothing.
+ * Parameters:
+ *      - const char *path: The results file.
+ *      - ResultsFormatType format: RESULTS_JSONL or RESULTS_CSV.
+ * Return: C_TRUE if the file is open, C_FALSE otherwise.
+ ************************************************************************************************/
+int openResults(const char *path, ResultsFormatType format) {
+    resultsFd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (resultsFd < 0) {
+        perror("Failed to open results file");
+        return C_FALSE;
+    }
+
+    resultsOwner = getpid();
+    resultsFormat = format;
+    resultsLength = 0;
+
+    if (format == RESULTS_CSV) {
+        static const char header[] = "run,seed,outcome,ghost,speculated,steps,ghost_steps,wall_ns,"
+                                     "hunter,name,tool,fear,timer,evidence,hunter_steps,done\n";
+        memcpy(resultsBuffer, header, sizeof(header) - 1);
+        resultsLength = sizeof(header) - 1;
+    }
+
+    return C_TRUE;
+}
+
+/************************************************************************************************
+ * Function: void writeBuffered(size_t length)
+ * Description: This function writes the first length bytes of the buffer to the results file.
+ * Parameters:
+ *      - size_t length: How many bytes, ending on a record boundary.
+ * Return: None
+ ************************************************************************************************/
+static void writeBuffered(size_t length) {
+    size_t written = 0;
+
+    while (resultsFd >= 0 && written < length) {
+        ssize_t bytes = write(resultsFd, resultsBuffer + written, length - written);
+        if (bytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Failed to write results");
+            break;
+        }
+        written += (size_t)bytes;
+    }
+}
+
+/************************************************************************************************
+ * Function: void flushResults(void)
+ * Description: This function writes out the buffered records. A process about to fork flushes
+ *              first so its children do not inherit (and write again) what it buffered.
+ * Parameters: None
+ * Return: None
+ ************************************************************************************************/
+void flushResults(void) {
+    writeBuffered(resultsLength);
+    resultsLength = 0;
+    recordStart = 0;
+}
+
+/************************************************************************************************
+ * Function: void closeResults(void)
+ * Description: This function flushes and closes the results file. Forked children inherit the
+ *              registration but not the file: only the process that opened it closes it.
+ * Parameters: None
+ * Return: None
+ ************************************************************************************************/
+void closeResults(void) {
+    if (resultsFd < 0 || getpid() != resultsOwner) {
+        return;
+    }
+
+    flushResults();
+    close(resultsFd);
+    resultsFd = -1;
+}
+
+/************************************************************************************************
+ * Function: void appendBytes(const char *bytes, size_t length)
+ * Description: This function copies bytes into the buffer. When it fills up, the records
+ *              before the one being appended are written and the partial record moves to the
+ *              front; only a single record larger than the whole buffer is written in pieces.
+ * Parameters:
+ *      - const char *bytes: The bytes.
+ *      - size_t length: How many.
+ * Return: None
+ ************************************************************************************************/
+static void appendBytes(const char *bytes, size_t length) {
+    while (length > 0) {
+        if (resultsLength == RESULTS_BUFFER_SIZE) {
+            if (recordStart > 0) {
+                writeBuffered(recordStart);
+                memmove(resultsBuffer, resultsBuffer + recordStart, resultsLength - recordStart);
+                resultsLength -= recordStart;
+                recordStart = 0;
+            } else {
+                flushResults();
+            }
+        }
+
+        size_t chunk = RESULTS_BUFFER_SIZE - resultsLength;
+        if (chunk > length) {
+            chunk = length;
+        }
+
+        memcpy(resultsBuffer + resultsLength, bytes, chunk);
+        resultsLength += chunk;
+        bytes += chunk;
+        length -= chunk;
+    }
+}
+
+/************************************************************************************************
+ * Function: void appendText(const char *text)
+ * Description: This function appends a string as is.
+ * Parameters:
+ *      - const char *text: The string.
+ * Return: None
+ ************************************************************************************************/
+static void appendText(const char *text) {
+    appendBytes(text, strlen(text));
+}
+
+/************************************************************************************************
+ * Function: void appendUnsigned(uint64_t value)
+ * Description: This function appends a number in decimal.
+ * Parameters:
+ *      - uint64_t value: The number.
+ * Return: None
+ ************************************************************************************************/
+static void appendUnsigned(uint64_t value) {
+    char digits[20];
+    int start = sizeof(digits);
+
+    do {
+        digits[--start] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    appendBytes(digits + start, sizeof(digits) - start);
+}
+
+/************************************************************************************************
+ * Function: void appendInt(int value)
+ * Description: This function appends a signed number in decimal.
+ * Parameters:
+ *      - int value: The number.
+ * Return: None
+ ************************************************************************************************/
+static void appendInt(int value) {
+    if (value < 0) {
+        appendBytes("-", 1);
+        appendUnsigned(-(int64_t)value);
+    } else {
+        appendUnsigned((uint64_t)value);
+    }
+}
+
+/************************************************************************************************
+ * Function: void appendString(const char *text)
+ * Description: This function appends a string value, quoted for the results format: always for
+ *              JSON (with quotes, backslashes and control characters escaped), and for CSV only
+ *              when it holds a comma, quote or line break (with quotes doubled).
+ * Parameters:
+ *      - const char *text: The string.
+ * Return: None
+ ************************************************************************************************/
+static void appendString(const char *text) {
+    static const char hex[] = "0123456789abcdef";
+
+    if (resultsFormat == RESULTS_CSV) {
+        if (strpbrk(text, ",\"\r\n") == NULL) {
+            appendText(text);
+            return;
+        }
+
+        appendBytes("\"", 1);
+        for (const char *c = text; *c != '\0'; c++) {
+            appendBytes(c, 1);
+            if (*c == '"') {
+                appendBytes("\"", 1);
+            }
+        }
+        appendBytes("\"", 1);
+        return;
+    }
+
+    appendBytes("\"", 1);
+    for (const char *c = text; *c != '\0'; c++) {
+        unsigned char byte = (unsigned char)*c;
+
+        if (byte == '"' || byte == '\\') {
+            char escaped[2] = { '\\', (char)byte };
+            appendBytes(escaped, 2);
+        } else if (byte < 0x20) {
+            char escaped[6] = { '\\', 'u', '0', '0', hex[byte >> 4], hex[byte & 0xF] };
+            appendBytes(escaped, 6);
+        } else {
+            appendBytes(c, 1);
+        }
+    }
+    appendBytes("\"", 1);
+}
+
+/************************************************************************************************
+ * Function: void appendJsonHunter(const HunterType *hunter)
+ * Description: This function appends a hunter as a JSON object.
+ * Parameters:
+ *      - const HunterType *hunter: The hunter.
+ * Return: None
+ ************************************************************************************************/
+static void appendJsonHunter(const HunterType *hunter) {
+    appendText("{\"name\":");
+    appendString(hunter->name);
+    appendText(",\"tool\":");
+    appendString(evidenceTypeToString(hunter->evidence));
+    appendText(",\"fear\":");
+    appendInt(hunter->fear);
+    appendText(",\"timer\":");
+    appendInt(hunter->timer);
+    appendText(",\"evidence\":");
+    appendInt(hunter->evidenceCollected);
+    appendText(",\"steps\":");
+    appendInt(hunter->steps);
+    appendText(hunter->done ? ",\"done\":true}" : ",\"done\":false}");
+}
+
+/************************************************************************************************
+ * Function: uint64_t monotonicNanoseconds(void)
+ * Description: This function reads the monotonic clock, for timing runs.
+ * Parameters: None
+ * Return: The clock in nanoseconds.
+ ************************************************************************************************/
+uint64_t monotonicNanoseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/************************************************************************************************
+ * Function: void appendRecord(HouseType *house, GameOutcomeType outcome, int run, const uint64_t *seed, uint64_t wallNs)
+ * Description: This function appends the record of a finished run to the results buffer: the
+ *              outcome, the true and the speculated ghost type, the steps every agent took and
+ *              every hunter's fear, timer and evidence.
+ * Parameters:
+ *      - HouseType *house: The finished house.
+ *      - GameOutcomeType outcome: How the run ended.
+ *      - int run: The run number within the batch (or the continuation number).
+ *      - const uint64_t *seed: The seed the run was started from, or NULL if there was none.
+ *      - uint64_t wallNs: How long the run took.
+ * Return: None
+ ************************************************************************************************/
+static void appendRecord(HouseType *house, GameOutcomeType outcome, int run, const uint64_t *seed, uint64_t wallNs) {
+    HunterListType *hunters = house->hunters;
+    const char *ghost = ghostTypeToString(house->ghost->ghostType);
+    const char *speculated = ghostTypeToString((GhostClassType)findingGhost(hunters));
+    uint64_t steps = (uint64_t)house->ghost->steps;
+
+    for (int i = 0; i < hunters->size; i++) {
+        steps += (uint64_t)hunters->hunterList[i]->steps;
+    }
+
+    recordStart = resultsLength;
+
+    if (resultsFormat == RESULTS_JSONL) {
+        appendText("{\"run\":");
+        appendInt(run);
+        appendText(",\"seed\":");
+        if (seed != NULL) {
+            appendUnsigned(*seed);
+        } else {
+            appendText("null");
+        }
+        appendText(",\"outcome\":");
+        appendString(outcomeNames[outcome]);
+        appendText(",\"ghost\":");
+        appendString(ghost);
+        appendText(",\"speculated\":");
+        appendString(speculated);
+        appendText(",\"steps\":");
+        appendUnsigned(steps);
+        appendText(",\"ghost_steps\":");
+        appendInt(house->ghost->steps);
+        appendText(",\"wall_ns\":");
+        appendUnsigned(wallNs);
+        appendText(",\"hunters\":[");
+        for (int i = 0; i < hunters->size; i++) {
+            if (i > 0) {
+                appendBytes(",", 1);
+            }
+            appendJsonHunter(hunters->hunterList[i]);
+        }
+        appendText("]}\n");
+        return;
+    }
+
+    // CSV: a run without hunters still gets a row, with the hunter columns empty
+    int i = 0;
+    do {
+        appendInt(run);
+        appendBytes(",", 1);
+        if (seed != NULL) {
+            appendUnsigned(*seed);
+        }
+        appendBytes(",", 1);
+        appendString(outcomeNames[outcome]);
+        appendBytes(",", 1);
+        appendString(ghost);
+        appendBytes(",", 1);
+        appendString(speculated);
+        appendBytes(",", 1);
+        appendUnsigned(steps);
+        appendBytes(",", 1);
+        appendInt(house->ghost->steps);
+        appendBytes(",", 1);
+        appendUnsigned(wallNs);
+
+        if (i < hunters->size) {
+            const HunterType *hunter = hunters->hunterList[i];
+            appendBytes(",", 1);
+            appendInt(i);
+            appendBytes(",", 1);
+            appendString(hunter->name);
+            appendBytes(",", 1);
+            appendString(evidenceTypeToString(hunter->evidence));
+            appendBytes(",", 1);
+            appendInt(hunter->fear);
+            appendBytes(",", 1);
+            appendInt(hunter->timer);
+            appendBytes(",", 1);
+            appendInt(hunter->evidenceCollected);
+            appendBytes(",", 1);
+            appendInt(hunter->steps);
+            appendText(hunter->done ? ",1\n" : ",0\n");
+        } else {
+            appendText(",,,,,,,,\n");
+        }
+    } while (++i < hunters->size);
+}
+
+/************************************************************************************************
+ * Function: void writeResult(HouseType *house, GameOutcomeType outcome, int run, const uint64_t *seed, uint64_t wallNs)
+ * Description: This function records a finished run with appendRecord, one whole record at a
+ *              time when several threads finish runs at once. It does nothing without --results.
+ * Parameters:
+ *      - HouseType *house: The finished house.
+ *      - GameOutcomeType outcome: How the run ended.
+ *      - int run: The run number within the batch (or the continuation number).
+ *      - const uint64_t *seed: The seed the run was started from, or NULL if there was none.
+ *      - uint64_t wallNs: How long the run took.
+ * Return: None
+ ************************************************************************************************/
+void writeResult(HouseType *house, GameOutcomeType outcome, int run, const uint64_t *seed, uint64_t wallNs) {
+    if (resultsFd < 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&resultsLock);
+    appendRecord(house, outcome, run, seed, wallNs);
+    pthread_mutex_unlock(&resultsLock);
+}
@@ -1,205 +1,568 @@
 #include "defs.h"
+#include <sched.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+/* Spare evidence slots the calling thread took from a house, and the arena epoch they were
+   allocated in. Epochs are unique across arenas, so the slots never outlive their arena's reset. */
+typedef struct EvidenceSpareCacheType {
+    uint64_t epoch;
+    EvidenceSlotType *slots;
+} EvidenceSpareCacheType;
+
+static _Thread_local EvidenceSpareCacheType spareCache;
+
+/************************************************************************************************
+ * Function: void buildHouseRooms(HouseType *house, const HouseTopologyType *topology)
+ * Description: This function creates the rooms of a run on a house topology: one
+ *              cache-line-aligned array from the house's run arena, room r standing on the
+ *              topology's room r. Only the per-run state is written; names and connections
+ *              stay shared with every other run on the topology. Evidence channels give evicted
+ *              pieces back to the house.
+ * Parameters:
+ *      - HouseType *house: The house.
+ *      - const HouseTopologyType *topology: The floor plan.
+ * Return: None
+ ************************************************************************************************/
+void buildHouseRooms(HouseType *house, const HouseTopologyType *topology) {
+    house->rooms = arenaAlloc(house->arena, (size_t)topology->roomCount * sizeof(RoomType), CACHE_LINE);
+    memset(house->rooms, 0, (size_t)topology->roomCount * sizeof(RoomType));
+    house->roomCount = topology->roomCount;
+    house->topology = topology;
+
+    for (int r = 0; r < topology->roomCount; r++) {
+        initializeRoom(&house->rooms[r], &topology->rooms[r]);
+        house->rooms[r].id = r;
+        for (int i = 0; i < EVIDENCE_TYPES; i++) {
+            house->rooms[r].evidence[i].house = house;
+        }
+    }
+}
+
+/************************************************************************************************
+ * Function: RoomType *connectedRoom(RoomType *room, int index)
+ * Description: This function gives a room's index-th connection in its run. The rooms of a run
+ *              are one array, so the neighbour is found from the room's own id.
+ * Parameters:
+ *      - RoomType *room: The room.
+ *      - int index: Which of its connections, below room->topology->connectedCount.
+ * Return: The connected room.
+ ************************************************************************************************/
+RoomType *connectedRoom(RoomType *room, int index) {
+    return room - room->id + room->topology->connected[index];
+}
 
 /************************************************************************************************
- * Function: void initializeRoom(RoomType *room, const char *name)
- * Description: This function initializes a RoomType structure, setting up its semaphore, name,
- *              and allocating memory for connectedRooms, evidenceList, and hunters. It also
- *              initializes the Room's ghost to NULL.
+ * Function: void initializeRoom(RoomType *room, const RoomTopologyType *topology)
+ * Description: This function initializes a RoomType record in place, setting up its semaphore,
+ *              pointing it at its name and connections and emptying its occupancy and evidence
+ *              channels. It also initializes the Room's ghost to NULL. The room id is
+ *              assigned by the caller.
  * Parameters:
  *      - RoomType *room: Pointer to the RoomType structure to be initialized.
- *      - const char *name: Name to be assigned to the room.
+ *      - const RoomTopologyType *topology: The room's part of the house topology.
  * Return: None
  * CHATGPT ACCESSED DECEMBER 2ND 2023
  ************************************************************************************************/
-void initializeRoom(RoomType *room, const char *name) {
+void initializeRoom(RoomType *room, const RoomTopologyType *topology) {
     if (sem_init(&(room->semaphore), 0, 1) != 0) {
         perror("Failed to initialize semaphore");
         exit(EXIT_FAILURE); 
     }
 
-    strncpy(room->name, name, sizeof(room->name) - 1);
-    room->name[sizeof(room->name) - 1] = '\0'; 
+    room->topology = topology;
 
-    room->connectedRooms = malloc(sizeof(RoomListType));
-    if (room->connectedRooms == NULL) {
-        perror("Failed to allocate memory for connectedRooms");
-        exit(EXIT_FAILURE); 
+    for (int i = 0; i < EVIDENCE_TYPES; i++) {
+        atomic_init(&room->evidence[i].incoming, NULL);
+        room->evidence[i].pending = room->evidence[i].pendingTail = NULL;
+        atomic_init(&room->evidence[i].count, 0);
+        atomic_flag_clear(&room->evidence[i].taking);
     }
-    initListOfRooms(&(room->connectedRooms));
+    atomic_init(&room->evidenceHints, 0);
+    atomic_init(&room->wakeSeq, 0);
+    atomic_init(&room->sleepers, 0);
 
-    room->evidenceList = malloc(sizeof(GhostEvidenceListType));
-    if (room->evidenceList == NULL) {
-        perror("Failed to allocate memory for evidenceList");
-        exit(EXIT_FAILURE); 
+    room->hunterCount = 0;
+    room->ghost = NULL;
+}
+
+/************************************************************************************************
+ * Function: int assignHunterToRoom(RoomType* room, HunterType* hunter)
+ * Description: This function assigns a hunter to a room if there is available space.
+ * Parameters:
+ *      - RoomType* room: Pointer to the room.
+ *      - HunterType* hunter: Pointer to the hunter to be assigned.
+ * Return:
+ *      - int: Returns C_TRUE if the hunter was assigned successfully, C_FALSE otherwise.
+ * CHATGPT ACCESSED DECEMBER 2ND 2023
+ ************************************************************************************************/
+int assignHunterToRoom(RoomType* room, HunterType* hunter) {
+    int roomAvailability = (room->hunterCount < MAX_HUNTERS) && (
+        (room->hunters[room->hunterCount] = hunter),
+        (room->hunterCount++),
+        (hunter->room = room),
+        C_TRUE
+    );
+
+    if (roomAvailability) {
+        telemetryRoom(room);
     }
-    initListOfGhosts(room->evidenceList);
 
-    room->hunters = malloc(sizeof(HunterListType));
-    if (room->hunters == NULL) {
-        perror("Failed to allocate memory for hunters");
-        exit(EXIT_FAILURE); 
+    return roomAvailability ? C_TRUE : C_FALSE;
+}
+
+
+
+/************************************************************************************************
+ * Function: void releaseHouseRooms(HouseType *house)
+ * Description: This function releases the rooms of a house: their semaphores. The rooms and the
+ *              evidence left behind in them belong to the run arena, their topology to the
+ *              caller.
+ * Parameters:
+ *      - HouseType *house: The house whose rooms need to be released.
+ * Return: None
+ * CHATGPT ACCESSED DECEMBER 2ND 2023
+ ************************************************************************************************/
+void releaseHouseRooms(HouseType *house) {
+    for (int r = 0; r < house->roomCount; r++) {
+        RoomType *room = &house->rooms[r];
+
+        sem_destroy(&(room->semaphore));
     }
-    initListOfHunters(room->hunters);
 
+    house->rooms = NULL;
+    house->roomCount = 0;
+}
 
-    room->ghost = NULL;
+/************************************************************************************************
+ * Function: RoomType* randomRoom(HouseType *house)
+ * Description: This function returns a randomly selected room of a house.
+ * Parameters:
+ *      - HouseType *house: The house.
+ * Return: RoomType* - Pointer to the randomly selected room.
+ * CHATGPT ACCESSED DECEMBER 2ND 2023
+ ************************************************************************************************/
+RoomType* randomRoom(HouseType *house) {
+    return &house->rooms[randInt(0, house->roomCount)];
 }
 
+
 /************************************************************************************************
- * Function: void initListOfRooms(RoomListType **roomList)
- * Description: This function initializes a RoomListType structure by setting its head and tail
- *              pointers to NULL.
+ * Function: void lockRoom(RoomType *room)
+ * Description: This function waits for the room semaphore. Threads of the sharded engine own
+ *              their rooms outright, so for them it does nothing. Locks taken during a recorded
+ *              or replayed turn are logged or checked. With --latency the wait is measured and
+ *              with --profile it is charged to the lock phase.
  * Parameters:
- *      - RoomListType **roomList: Pointer to a pointer to the RoomListType structure to be
- *                                 initialized.
+ *      - RoomType *room: The room to lock.
  * Return: None
- * CHATGPT ACCESSED DECEMBER 2ND 2023
  ************************************************************************************************/
-void initListOfRooms(RoomListType **roomList){
-    RoomListType *list = *roomList;
-    list->head = list->tail = NULL;
+void lockRoom(RoomType *room) {
+    if (currentShard == NULL) {
+        int previous = PROFILE_ENTER(PROFILE_LOCK);
+        uint64_t started = LATENCY_START();
+        if (onCoroutine()) {
+            while (sem_trywait(&(room->semaphore)) != 0) {
+                agentRest(0);
+            }
+        } else {
+            sem_wait(&(room->semaphore));
+        }
+        LATENCY_RECORD(LATENCY_ROOM_LOCK, started);
+        PROFILE_LEAVE(previous);
+
+        if (replayMode != REPLAY_OFF) {
+            noteRoomLock(room, C_TRUE);
+        }
+    }
 }
 
+/************************************************************************************************
+ * Function: int tryLockRoom(RoomType *room)
+ * Description: This function takes the room semaphore only if it is free (always succeeds for
+ *              sharded engine threads, see lockRoom). A replayed try-lock fails exactly when the
+ *              recorded one did.
+ * Parameters:
+ *      - RoomType *room: The room to lock.
+ * Return: C_TRUE if the room is now locked, C_FALSE if another agent holds it.
+ ************************************************************************************************/
+int tryLockRoom(RoomType *room) {
+    if (currentShard == NULL) {
+        int previous = PROFILE_ENTER(PROFILE_LOCK);
+        int locked = sem_trywait(&(room->semaphore)) == 0;
+        PROFILE_LEAVE(previous);
+
+        // Only a replay disagrees: its single thread finds free a room that was contended when recorded
+        if (replayMode != REPLAY_OFF && noteRoomLock(room, locked) != locked && locked) {
+            sem_post(&(room->semaphore));
+            locked = C_FALSE;
+        }
+        return locked;
+    }
+    return C_TRUE;
+}
 
 /************************************************************************************************
- * Function: void connectRooms(RoomType *room1, RoomType *room2)
- * Description: This function connects two rooms by creating nodes for each room and adding them
- *              to each other's connected rooms list.
+ * Function: void unlockRoom(RoomType *room)
+ * Description: This function releases a room locked with lockRoom or tryLockRoom.
  * Parameters:
- *      - RoomType *room1: Pointer to the first room to be connected.
- *      - RoomType *room2: Pointer to the second room to be connected.
+ *      - RoomType *room: The room to unlock.
  * Return: None
- * CHATGPT ACCESSED DECEMBER 2ND 2023
  ************************************************************************************************/
-void connectRooms(RoomType *room1, RoomType *room2){
-    RoomNodeType *roomNode1 = calloc(1, sizeof(RoomNodeType)), *roomNode2 = calloc(1, sizeof(RoomNodeType));
+void unlockRoom(RoomType *room) {
+    if (currentShard == NULL) {
+        sem_post(&(room->semaphore));
+    }
+}
 
-    addRoom((roomNode1->data = room1)->connectedRooms, roomNode2);
-    addRoom((roomNode2->data = room2)->connectedRooms, roomNode1);
+/************************************************************************************************
+ * Function: void dropEvidence(RoomType *room, EvidenceChannelNodeType *node)
+ * Description: This function leaves a piece of evidence in a room. It is pushed onto the
+ *              incoming stack of the channel for its type with a compare-and-swap, so the ghost
+ *              never waits for hunters picking evidence up or moving through the room. A channel
+ *              now over --evidence-cap is cut back right away unless a hunter is taking from it,
+ *              in which case that hunter does it when it is done.
+ * Parameters:
+ *      - RoomType *room: The room.
+ *      - EvidenceChannelNodeType *node: The evidence, filled in.
+ * Return: None
+ ************************************************************************************************/
+void dropEvidence(RoomType *room, EvidenceChannelNodeType *node) {
+    EvidenceChannelType *channel = &room->evidence[node->evidence.evidenceType];
+    EvidenceChannelNodeType *top = atomic_load_explicit(&channel->incoming, memory_order_relaxed);
+
+    int count = atomic_fetch_add_explicit(&channel->count, 1, memory_order_relaxed) + 1;
+
+    do {
+        node->next = top;
+    } while (!atomic_compare_exchange_weak_explicit(&channel->incoming, &top, node,
+                                                    memory_order_release, memory_order_relaxed));
+
+    if (gameOptions.evidenceCap > 0 && count > gameOptions.evidenceCap && beginTakingEvidence(channel)) {
+        endTakingEvidence(channel);
+    }
 }
 
+/************************************************************************************************
+ * Function: void evictEvidence(EvidenceChannelType *channel)
+ * Description: This function drops evidence until the channel holds no more than --evidence-cap
+ *              pieces: the oldest first, or with --evict mundane the oldest piece a ghost did not
+ *              leave (the oldest one if every piece is ghostly). Dropped pieces go back to the
+ *              house's spare evidence, so a capped channel keeps reusing the same nodes. The
+ *              caller holds the taking side.
+ * Parameters:
+ *      - EvidenceChannelType *channel: The channel.
+ * Return: None
+ ************************************************************************************************/
+static void evictEvidence(EvidenceChannelType *channel) {
+    settleEvidence(channel);
+
+    while (channel->pending != NULL && atomic_load_explicit(&channel->count, memory_order_relaxed) > gameOptions.evidenceCap) {
+        EvidenceChannelNodeType *previous = NULL;
+        EvidenceChannelNodeType *victim = channel->pending;
+
+        if (gameOptions.evictPolicy == EVICT_MUNDANE) {
+            for (EvidenceChannelNodeType *node = channel->pending; node != NULL; previous = node, node = node->next) {
+                if (!isEvidenceFromGhost(&node->evidence)) {
+                    victim = node;
+                    break;
+                }
+            }
+            if (victim == channel->pending) {
+                previous = NULL;
+            }
+        }
+
+        if (previous == NULL) {
+            channel->pending = victim->next;
+        } else {
+            previous->next = victim->next;
+        }
+        if (channel->pendingTail == victim) {
+            channel->pendingTail = previous;
+        }
+
+        atomic_fetch_sub_explicit(&channel->count, 1, memory_order_relaxed);
+        recycleChannelEvidence(channel->house, victim);
+    }
+}
 
 /************************************************************************************************
- * Function: void addRoom(RoomListType *roomList, RoomNodeType *room)
- * Description: This function adds a new room node to the given room list.
+ * Function: int beginTakingEvidence(EvidenceChannelType *channel)
+ * Description: This function claims the taking side of a channel. Only one hunter takes from a
+ *              channel at a time; a hunter that finds it claimed does not wait, it simply finds
+ *              nothing this turn.
  * Parameters:
- *      - RoomListType *roomList: Pointer to the room list.
- *      - RoomNodeType *room: Pointer to the room node to be added.
+ *      - EvidenceChannelType *channel: The channel.
+ * Return: C_TRUE if the caller may take evidence, C_FALSE otherwise.
+ ************************************************************************************************/
+int beginTakingEvidence(EvidenceChannelType *channel) {
+    return !atomic_flag_test_and_set_explicit(&channel->taking, memory_order_acquire);
+}
+
+/************************************************************************************************
+ * Function: void endTakingEvidence(EvidenceChannelType *channel)
+ * Description: This function gives up the taking side claimed with beginTakingEvidence, first
+ *              evicting evidence if the channel is over --evidence-cap.
+ * Parameters:
+ *      - EvidenceChannelType *channel: The channel.
  * Return: None
- * CHATGPT ACCESSED DECEMBER 2ND 2023
  ************************************************************************************************/
-void addRoom(RoomListType *roomList, RoomNodeType *room) {
-    room->next = NULL;
-    roomList->head ? (roomList->tail->next = room) : (roomList->head = room);
-    roomList->tail = room;
+void endTakingEvidence(EvidenceChannelType *channel) {
+    if (gameOptions.evidenceCap > 0 && atomic_load_explicit(&channel->count, memory_order_relaxed) > gameOptions.evidenceCap) {
+        evictEvidence(channel);
+    }
+
+    atomic_flag_clear_explicit(&channel->taking, memory_order_release);
 }
 
 /************************************************************************************************
- * Function: int assignHunterToRoom(RoomType* room, HunterType* hunter)
- * Description: This function assigns a hunter to a room if there is available space.
+ * Function: EvidenceChannelNodeType* settleEvidence(EvidenceChannelType *channel)
+ * Description: This function detaches everything pushed since the last call and appends it,
+ *              oldest first, to the pending list. The caller must hold the taking side (or be the
+ *              only thread left).
  * Parameters:
- *      - RoomType* room: Pointer to the room.
- *      - HunterType* hunter: Pointer to the hunter to be assigned.
- * Return:
- *      - int: Returns C_TRUE if the hunter was assigned successfully, C_FALSE otherwise.
- * CHATGPT ACCESSED DECEMBER 2ND 2023
+ *      - EvidenceChannelType *channel: The channel.
+ * Return: The oldest piece of evidence in the channel, or NULL if it is empty.
  ************************************************************************************************/
-int assignHunterToRoom(RoomType* room, HunterType* hunter) {
-    int roomAvailability = (room->hunters->size < MAX_HUNTERS) && (
-        (room->hunters->hunterList[room->hunters->size] = hunter),
-        (room->hunters->size++),
-        (hunter->room = room),
-        C_TRUE
-    );
+EvidenceChannelNodeType* settleEvidence(EvidenceChannelType *channel) {
+    EvidenceChannelNodeType *stack = atomic_exchange_explicit(&channel->incoming, NULL, memory_order_acquire);
+    EvidenceChannelNodeType *newest = stack;
+    EvidenceChannelNodeType *oldest = NULL;
 
-    return roomAvailability ? C_TRUE : C_FALSE;
+    while (stack != NULL) {
+        EvidenceChannelNodeType *next = stack->next;
+        stack->next = oldest;
+        oldest = stack;
+        stack = next;
+    }
+
+    if (oldest != NULL) {
+        if (channel->pendingTail != NULL) {
+            channel->pendingTail->next = oldest;
+        } else {
+            channel->pending = oldest;
+        }
+        channel->pendingTail = newest;
+    }
+
+    return channel->pending;
 }
 
+/************************************************************************************************
+ * Function: EvidenceChannelNodeType* takeEvidence(EvidenceChannelType *channel)
+ * Description: This function removes the oldest piece of evidence returned by settleEvidence.
+ *              The caller must hold the taking side and gives the node back with
+ *              recycleChannelEvidence once it is done with it.
+ * Parameters:
+ *      - EvidenceChannelType *channel: The channel.
+ * Return: The evidence removed, or NULL if the pending list is empty.
+ ************************************************************************************************/
+EvidenceChannelNodeType* takeEvidence(EvidenceChannelType *channel) {
+    EvidenceChannelNodeType *node = channel->pending;
 
+    if (node != NULL) {
+        channel->pending = node->next;
+        if (channel->pending == NULL) {
+            channel->pendingTail = NULL;
+        }
+        atomic_fetch_sub_explicit(&channel->count, 1, memory_order_relaxed);
+    }
+
+    return node;
+}
 
 /************************************************************************************************
- * Function: void displayRoomList(RoomListType *roomList)
- * Description: This function displays the names of rooms in a RoomListType.
+ * Function: EvidenceSlotType *takeSpareEvidence(HouseType *house)
+ * Description: This function hands out a spare evidence slot of a house. The calling thread
+ *              takes every spare the house has at once with an exchange and uses them up before
+ *              taking more, so slots are never popped one at a time by competing threads (which
+ *              could pop a slot another thread has just taken and given back). Slots left over
+ *              from an older arena epoch are forgotten; their arena has been reset.
  * Parameters:
- *      - RoomListType* roomList: Pointer to the RoomListType to be displayed.
+ *      - HouseType *house: The house.
+ * Return: A slot, or NULL if the house has none spare.
+ ************************************************************************************************/
+static EvidenceSlotType *takeSpareEvidence(HouseType *house) {
+    if (spareCache.epoch != house->arena->epoch) {
+        spareCache.epoch = house->arena->epoch;
+        spareCache.slots = NULL;
+    }
+
+    if (spareCache.slots == NULL) {
+        spareCache.slots = atomic_exchange_explicit(&house->spareEvidence, NULL, memory_order_acquire);
+    }
+
+    EvidenceSlotType *slot = spareCache.slots;
+    if (slot != NULL) {
+        spareCache.slots = slot->next;
+    }
+
+    return slot;
+}
+
+/************************************************************************************************
+ * Function: void giveSpareEvidence(HouseType *house, EvidenceSlotType *slot)
+ * Description: This function gives an evidence slot back to its house. Any thread may give one
+ *              back; it is pushed with a compare-and-swap, as dropEvidence pushes evidence.
+ * Parameters:
+ *      - HouseType *house: The house the slot was handed out by.
+ *      - EvidenceSlotType *slot: The slot, no longer used.
  * Return: None
- * CHATGPT ACCESSED DECEMBER 2ND 2023
  ************************************************************************************************/
+static void giveSpareEvidence(HouseType *house, EvidenceSlotType *slot) {
+    EvidenceSlotType *top = atomic_load_explicit(&house->spareEvidence, memory_order_relaxed);
+
+    do {
+        slot->next = top;
+    } while (!atomic_compare_exchange_weak_explicit(&house->spareEvidence, &top, slot,
+                                                    memory_order_release, memory_order_relaxed));
+}
+
+/************************************************************************************************
+ * Function: EvidenceChannelNodeType *newChannelEvidence(HouseType *house)
+ * Description: This function allocates a channel node for evidence to be left in a room of a
+ *              house, reusing one given back when there is one and taking a new one from the
+ *              run arena otherwise.
+ * Parameters:
+ *      - HouseType *house: The house.
+ * Return: The node, not filled in.
+ ************************************************************************************************/
+EvidenceChannelNodeType *newChannelEvidence(HouseType *house) {
+    EvidenceSlotType *slot = takeSpareEvidence(house);
 
-void displayRoomList(RoomListType *roomList){
-    for(RoomNodeType *currNode = roomList->head; currNode; currNode = currNode->next){
-        printf("\t%s\n", currNode->data->name);
+    if (slot == NULL) {
+        slot = arenaAlloc(house->arena, sizeof(EvidenceSlotType), _Alignof(EvidenceSlotType));
     }
+
+    return &slot->channel;
 }
 
+/************************************************************************************************
+ * Function: void recycleChannelEvidence(HouseType *house, EvidenceChannelNodeType *node)
+ * Description: This function gives back a channel node taken or evicted from a room.
+ * Parameters:
+ *      - HouseType *house: The house it was allocated for.
+ *      - EvidenceChannelNodeType *node: A node from newChannelEvidence, in no channel.
+ * Return: None
+ ************************************************************************************************/
+void recycleChannelEvidence(HouseType *house, EvidenceChannelNodeType *node) {
+    giveSpareEvidence(house, (EvidenceSlotType *)node);
+}
 
 /************************************************************************************************
- * Function: void releaseConnectedRooms(RoomListType* list)
- * Description: This function releases the memory allocated for the connected rooms in a RoomListType.
- *              It iterates through the list, frees the memory for each node, and sets the head to NULL.
+ * Function: EvidenceNodeType *newHunterEvidence(HouseType *house)
+ * Description: This function allocates a hunter's copy of a piece of evidence together with its
+ *              list node, from the same spare slots as channel nodes.
  * Parameters:
- *      - RoomListType* list: Pointer to the RoomListType whose connected rooms need to be released.
+ *      - HouseType *house: The house.
+ * Return: The node, its data pointing at the (not filled in) evidence and next NULL.
+ ************************************************************************************************/
+EvidenceNodeType *newHunterEvidence(HouseType *house) {
+    EvidenceSlotType *slot = takeSpareEvidence(house);
+
+    if (slot == NULL) {
+        slot = arenaAlloc(house->arena, sizeof(EvidenceSlotType), _Alignof(EvidenceSlotType));
+    }
+
+    slot->copy.node.data = &slot->copy.evidence;
+    slot->copy.node.next = NULL;
+    return &slot->copy.node;
+}
+
+/************************************************************************************************
+ * Function: void recycleHunterEvidence(HouseType *house, EvidenceNodeType *node)
+ * Description: This function gives back a hunter's copy of a piece of evidence with its node.
+ * Parameters:
+ *      - HouseType *house: The house it was allocated for.
+ *      - EvidenceNodeType *node: A node from newHunterEvidence, in no list.
+ * Return: None
+ ************************************************************************************************/
+void recycleHunterEvidence(HouseType *house, EvidenceNodeType *node) {
+    giveSpareEvidence(house, (EvidenceSlotType *)node);
+}
+
+/************************************************************************************************
+ * Function: void lockRoomEvidence(RoomType *room)
+ * Description: This function claims the taking side of every channel of a room, waiting for
+ *              hunters that are picking evidence up. Checkpoints use it to read a still room.
+ * Parameters:
+ *      - RoomType *room: The room.
  * Return: None
- * CHATGPT ACCESSED DECEMBER 2ND 2023
  ************************************************************************************************/
-void releaseConnectedRooms(RoomListType* list) {
-    for (RoomNodeType *currNode = list->head; currNode; list->head = currNode) {
-        RoomNodeType *nextNode = currNode->next;
-        free(currNode);
-        currNode = nextNode;
+void lockRoomEvidence(RoomType *room) {
+    for (int i = 0; i < EVIDENCE_TYPES; i++) {
+        while (!beginTakingEvidence(&room->evidence[i])) {
+            sched_yield();
+        }
     }
 }
 
 /************************************************************************************************
- * Function: void releaseRoomList(RoomListType *list)
- * Description: This function releases the memory allocated for a RoomListType. It iterates through
- *              the list, frees the memory for each node along with its contents (semaphore, evidence
- *              list, connected rooms, hunters, and the room itself), and sets the head to NULL.
+ * Function: void unlockRoomEvidence(RoomType *room)
+ * Description: This function releases the channels claimed with lockRoomEvidence.
  * Parameters:
- *      - RoomListType *list: Pointer to the RoomListType whose rooms need to be released.
+ *      - RoomType *room: The room.
  * Return: None
- * CHATGPT ACCESSED DECEMBER 2ND 2023
  ************************************************************************************************/
-void releaseRoomList(RoomListType *list){
-    RoomNodeType *currentNode = list->head;
-    while(currentNode){
-        RoomNodeType *nextNode = currentNode->next;
-        sem_destroy(&(currentNode->data->semaphore));
-        releaseEvidenceList(currentNode->data->evidenceList);
-        releaseConnectedRooms(currentNode->data->connectedRooms);
-        free(currentNode->data->connectedRooms);
-        free(currentNode->data->hunters);
-        free(currentNode->data);
-        free(currentNode);
-        currentNode = nextNode;
+void unlockRoomEvidence(RoomType *room) {
+    for (int i = 0; i < EVIDENCE_TYPES; i++) {
+        endTakingEvidence(&room->evidence[i]);
     }
-    list->head = NULL;
 }
 
 /************************************************************************************************
- * Function: RoomNodeType* randomRoom(RoomNodeType* head)
- * Description: This function returns a pointer to a randomly selected room from a linked list of
- *              rooms. It first counts the number of rooms, generates a random index, and then
- *              traverses to the selected room.
+ * Function: void wakeRoom(RoomType *room)
+ * Description: This function tells the hunters parked in a room that something happened there
+ *              (evidence was left, the ghost or another hunter came in). It does nothing unless
+ *              --wake event is on, and makes no system call when no hunter is parked.
  * Parameters:
- *      - RoomNodeType* head: Pointer to the head of the linked list of rooms.
- * Return: RoomNodeType* - Pointer to the randomly selected room.
- * CHATGPT ACCESSED DECEMBER 2ND 2023
+ *      - RoomType *room: The room.
+ * Return: None
  ************************************************************************************************/
-RoomNodeType* randomRoom(RoomNodeType* head) {
-    int count = 0;
-    RoomNodeType* current = head;
-    while (current != NULL) {
-        count++;
-        current = current->next;
+void wakeRoom(RoomType *room) {
+    if (!gameOptions.eventWakeups) {
+        return;
     }
 
-    int randomIndex = rand() % count;
+    atomic_fetch_add(&room->wakeSeq, 1);
 
-    current = head;
-    for (int i = 0; i < randomIndex; i++) {
-        current = current->next;
+    if (atomic_load(&room->sleepers) > 0) {
+        syscall(SYS_futex, (void *)&room->wakeSeq, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
     }
+}
+
+/************************************************************************************************
+ * Function: void wakeHouse(HouseType *house)
+ * Description: This function wakes every parked hunter of a house, e.g. once the game is over.
+ * Parameters:
+ *      - HouseType *house: The house.
+ * Return: None
+ ************************************************************************************************/
+void wakeHouse(HouseType *house) {
+    for (int r = 0; r < house->roomCount && gameOptions.eventWakeups; r++) {
+        wakeRoom(&house->rooms[r]);
+    }
+}
+
+/************************************************************************************************
+ * Function: void parkInRoom(RoomType *room, unsigned seen, int timeoutMs)
+ * Description: This function parks the calling hunter until its room is woken or the timeout
+ *              passes. A wakeup since the hunter read seen from the room's wakeSeq returns at
+ *              once, so an event that happened while it decided to park is never lost.
+ * Parameters:
+ *      - RoomType *room: The room the hunter is in.
+ *      - unsigned seen: The wakeSeq of the room read before deciding to park.
+ *      - int timeoutMs: How long to park at most.
+ * Return: None
+ ************************************************************************************************/
+void parkInRoom(RoomType *room, unsigned seen, int timeoutMs) {
+    struct timespec timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_nsec = (timeoutMs % 1000) * 1000000L;
 
-    return current;
+    atomic_fetch_add(&room->sleepers, 1);
+    syscall(SYS_futex, (void *)&room->wakeSeq, FUTEX_WAIT_PRIVATE, seen, &timeout, NULL, 0);
+    atomic_fetch_sub(&room->sleepers, 1);
 }
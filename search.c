@@ -0,0 +1,332 @@
+#include "defs.h"
+
+#define SEARCH_UNREACHABLE UINT16_MAX
+
+/* Breadth-first search scratch of the calling thread, reused from one search to the next. */
+static _Thread_local int *scratchParent = NULL;
+static _Thread_local int *scratchQueue = NULL;
+static _Thread_local unsigned *scratchStamp = NULL;
+static _Thread_local unsigned scratchEpoch = 0;
+static _Thread_local int scratchCapacity = 0;
+
+/************************************************************************************************
+ * Function: int isHinted(const RoomType *room, EvidenceClassType type)
+ * Description: This function checks whether a room is known to hold evidence of a type.
+ * Parameters:
+ *      - const RoomType *room: The room.
+ *      - EvidenceClassType type: The evidence type.
+ * Return: C_TRUE if it is, C_FALSE otherwise.
+ ************************************************************************************************/
+static int isHinted(const RoomType *room, EvidenceClassType type) {
+    return (atomic_load_explicit((atomic_int *)&room->evidenceHints, memory_order_relaxed) >> type) & 1;
+}
+
+/************************************************************************************************
+ * Function: void computeNextHopTables(const RoomTopologyType *rooms, int n, uint16_t *nextHop, uint16_t *distance)
+ * Description: This function fills the all-pairs tables with one breadth-first search per
+ *              destination: a room discovered from u is one step farther from the destination
+ *              than u, and u is where a hunter standing there should go next. Entries of rooms
+ *              that cannot reach each other keep a distance of SEARCH_UNREACHABLE.
+ * Parameters:
+ *      - const RoomTopologyType *rooms: The rooms of the topology, indexed by id.
+ *      - int n: The number of rooms.
+ *      - uint16_t *nextHop: Filled with n * n next rooms, by (from, destination).
+ *      - uint16_t *distance: Filled with n * n distances, by (from, destination).
+ * Return: None
+ ************************************************************************************************/
+void computeNextHopTables(const RoomTopologyType *rooms, int n, uint16_t *nextHop, uint16_t *distance) {
+    int *queue = malloc(n * sizeof(int));
+    if (queue == NULL) {
+        perror("Failed to allocate search tables");
+        exit(EXIT_FAILURE);
+    }
+
+    memset(distance, 0xFF, (size_t)n * n * sizeof(uint16_t));
+
+    for (int destination = 0; destination < n; destination++) {
+        int head = 0;
+        int tail = 0;
+
+        queue[tail++] = destination;
+        distance[(size_t)destination * n + destination] = 0;
+        nextHop[(size_t)destination * n + destination] = destination;
+
+        while (head < tail) {
+            int u = queue[head++];
+            uint16_t step = distance[(size_t)u * n + destination] + 1;
+
+            for (int e = 0; e < rooms[u].connectedCount; e++) {
+                int v = rooms[u].connected[e];
+                if (distance[(size_t)v * n + destination] == SEARCH_UNREACHABLE) {
+                    distance[(size_t)v * n + destination] = step;
+                    nextHop[(size_t)v * n + destination] = u;
+                    queue[tail++] = v;
+                }
+            }
+        }
+    }
+
+    free(queue);
+}
+
+/************************************************************************************************
+ * Function: void buildNextHopTable(SearchTableType *search, const HouseTopologyType *topology, RunArenaType *arena)
+ * Description: This function allocates and computes the all-pairs tables of a house whose
+ *              topology came without them.
+ * Parameters:
+ *      - SearchTableType *search: The table, with rooms filled in.
+ *      - const HouseTopologyType *topology: The house topology.
+ *      - RunArenaType *arena: The run arena of the house.
+ * Return: None
+ ************************************************************************************************/
+static void buildNextHopTable(SearchTableType *search, const HouseTopologyType *topology, RunArenaType *arena) {
+    int n = search->roomCount;
+    uint16_t *nextHop = arenaAlloc(arena, (size_t)n * n * sizeof(uint16_t), CACHE_LINE);
+    uint16_t *distance = arenaAlloc(arena, (size_t)n * n * sizeof(uint16_t), CACHE_LINE);
+
+    computeNextHopTables(topology->rooms, n, nextHop, distance);
+    search->nextHop = nextHop;
+    search->distance = distance;
+}
+
+/************************************************************************************************
+ * Function: void buildSearchTable(HouseType *house)
+ * Description: This function prepares directed search for a house whose floor plan is final:
+ *              it indexes the rooms, uses the next-hop tables of its topology (built once for
+ *              every run, or compiled into its house image) or builds them for small houses
+ *              whose topology has none, and marks the rooms that already hold
+ *              evidence (e.g. after a restore).
+ * Parameters:
+ *      - HouseType *house: The house.
+ * Return: None
+ ************************************************************************************************/
+void buildSearchTable(HouseType *house) {
+    SearchTableType *search = arenaAlloc(house->arena, sizeof(SearchTableType), _Alignof(SearchTableType));
+    memset(search, 0, sizeof(SearchTableType));
+
+    search->roomCount = house->roomCount;
+    search->rooms = house->rooms;
+
+    if (house->topology->nextHop != NULL) {
+        search->nextHop = house->topology->nextHop;
+        search->distance = house->topology->distance;
+    } else if (search->roomCount <= SEARCH_TABLE_MAX_ROOMS) {
+        buildNextHopTable(search, house->topology, house->arena);
+    }
+
+    house->search = search;
+
+    for (int r = 0; r < search->roomCount; r++) {
+        for (int type = 0; type < EVIDENCE_TYPES; type++) {
+            if (settleEvidence(&search->rooms[r].evidence[type]) != NULL) {
+                markEvidenceHint(house, &search->rooms[r], (EvidenceClassType)type);
+            }
+        }
+    }
+}
+
+/************************************************************************************************
+ * Function: void releaseSearchScratch(void)
+ * Description: This function frees the search scratch of the calling thread. Agent threads call
+ *              it when they finish.
+ * Parameters: None
+ * Return: None
+ ************************************************************************************************/
+void releaseSearchScratch(void) {
+    free(scratchParent);
+    free(scratchQueue);
+    free(scratchStamp);
+    scratchParent = scratchQueue = NULL;
+    scratchStamp = NULL;
+    scratchCapacity = 0;
+    scratchEpoch = 0;
+}
+
+/************************************************************************************************
+ * Function: void markEvidenceHint(HouseType *house, RoomType *room, EvidenceClassType type)
+ * Description: This function records that a room holds evidence of a type. It does nothing
+ *              unless the house uses directed search.
+ * Parameters:
+ *      - HouseType *house: The house.
+ *      - RoomType *room: The room the evidence was left in.
+ *      - EvidenceClassType type: The evidence type.
+ * Return: None
+ ************************************************************************************************/
+void markEvidenceHint(HouseType *house, RoomType *room, EvidenceClassType type) {
+    if (house->search == NULL) {
+        return;
+    }
+
+    int bit = 1 << type;
+    if (!(atomic_fetch_or(&room->evidenceHints, bit) & bit)) {
+        atomic_fetch_add(&house->search->hinted[type], 1);
+    }
+}
+
+/************************************************************************************************
+ * Function: void clearEvidenceHint(HouseType *house, RoomType *room, EvidenceClassType type)
+ * Description: This function forgets the hint of a room whose channel for the type was just
+ *              emptied. The caller holds the taking side of that channel; evidence dropped while
+ *              the hint is cleared puts it right back.
+ * Parameters:
+ *      - HouseType *house: The house.
+ *      - RoomType *room: The room.
+ *      - EvidenceClassType type: The evidence type.
+ * Return: None
+ ************************************************************************************************/
+void clearEvidenceHint(HouseType *house, RoomType *room, EvidenceClassType type) {
+    EvidenceChannelType *channel = &room->evidence[type];
+
+    if (house->search == NULL || channel->pending != NULL) {
+        return;
+    }
+
+    int bit = 1 << type;
+    if (atomic_fetch_and(&room->evidenceHints, ~bit) & bit) {
+        atomic_fetch_sub(&house->search->hinted[type], 1);
+    }
+
+    if (atomic_load(&channel->incoming) != NULL) {
+        markEvidenceHint(house, room, type);
+    }
+}
+
+/************************************************************************************************
+ * Function: int isNeighbour(const RoomType *room, int id)
+ * Description: This function checks whether a room connects to the room with the given id.
+ * Parameters:
+ *      - const RoomType *room: The room.
+ *      - int id: The other room.
+ * Return: C_TRUE if they are connected, C_FALSE otherwise.
+ ************************************************************************************************/
+static int isNeighbour(const RoomType *room, int id) {
+    for (int e = 0; e < room->topology->connectedCount; e++) {
+        if (room->topology->connected[e] == id) {
+            return C_TRUE;
+        }
+    }
+    return C_FALSE;
+}
+
+/************************************************************************************************
+ * Function: int routeToNearestHint(SearchTableType *search, HunterType *hunter)
+ * Description: This function searches breadth-first from the hunter's room for the nearest room
+ *              holding evidence of its tool and stores the way there in the hunter's route (a
+ *              stack whose top is the next room to enter). The scratch arrays are stamped with
+ *              an epoch so they never need clearing between searches.
+ * Parameters:
+ *      - SearchTableType *search: The search table.
+ *      - HunterType *hunter: The hunter.
+ * Return: C_TRUE if a route was found, C_FALSE otherwise.
+ ************************************************************************************************/
+static int routeToNearestHint(SearchTableType *search, HunterType *hunter) {
+    int n = search->roomCount;
+
+    if (scratchCapacity < n) {
+        releaseSearchScratch();
+        scratchParent = malloc(n * sizeof(int));
+        scratchQueue = malloc(n * sizeof(int));
+        scratchStamp = calloc(n, sizeof(unsigned));
+        if (scratchParent == NULL || scratchQueue == NULL || scratchStamp == NULL) {
+            perror("Failed to allocate search scratch");
+            exit(EXIT_FAILURE);
+        }
+        scratchCapacity = n;
+    }
+
+    if (++scratchEpoch == 0) {
+        memset(scratchStamp, 0, scratchCapacity * sizeof(unsigned));
+        scratchEpoch = 1;
+    }
+
+    int from = hunter->room->id;
+    int head = 0;
+    int tail = 0;
+
+    scratchQueue[tail++] = from;
+    scratchStamp[from] = scratchEpoch;
+
+    while (head < tail) {
+        int u = scratchQueue[head++];
+
+        if (u != from && isHinted(&search->rooms[u], hunter->evidence)) {
+            hunter->routeTarget = u;
+            hunter->routeLength = 0;
+
+            for (int v = u; v != from; v = scratchParent[v]) {
+                if (hunter->routeLength == hunter->routeCapacity) {
+                    int capacity = hunter->routeCapacity ? 2 * hunter->routeCapacity : 16;
+                    hunter->route = arenaGrow(hunter->house->arena, hunter->route, hunter->routeCapacity * sizeof(int),
+                                              capacity * sizeof(int), _Alignof(int));
+                    hunter->routeCapacity = capacity;
+                }
+                hunter->route[hunter->routeLength++] = v;
+            }
+            return C_TRUE;
+        }
+
+        const RoomTopologyType *room = search->rooms[u].topology;
+        for (int e = 0; e < room->connectedCount; e++) {
+            int v = room->connected[e];
+            if (scratchStamp[v] != scratchEpoch) {
+                scratchStamp[v] = scratchEpoch;
+                scratchParent[v] = u;
+                scratchQueue[tail++] = v;
+            }
+        }
+    }
+
+    return C_FALSE;
+}
+
+/************************************************************************************************
+ * Function: RoomType *chooseSearchRoom(HunterType *hunter)
+ * Description: This function picks where a hunter in directed search mode moves next: it stays
+ *              in a room holding evidence of its tool, otherwise it heads for the nearest such
+ *              room, using the next-hop table in small houses and a cached breadth-first route
+ *              in large ones. Without any such room it has no preference.
+ * Parameters:
+ *      - HunterType *hunter: The hunter about to move.
+ * Return: The hunter's own room to stay, a connected room to move to, or NULL to move randomly.
+ ************************************************************************************************/
+RoomType *chooseSearchRoom(HunterType *hunter) {
+    SearchTableType *search = hunter->house->search;
+    EvidenceClassType type = hunter->evidence;
+    int from = hunter->room->id;
+
+    if (isHinted(hunter->room, type)) {
+        return hunter->room;
+    }
+
+    if (atomic_load_explicit(&search->hinted[type], memory_order_relaxed) == 0) {
+        return NULL;
+    }
+
+    if (search->nextHop != NULL) {
+        int n = search->roomCount;
+        int best = -1;
+        uint16_t bestDistance = SEARCH_UNREACHABLE;
+
+        for (int r = 0; r < n; r++) {
+            if (search->distance[(size_t)from * n + r] < bestDistance && r != from && isHinted(&search->rooms[r], type)) {
+                best = r;
+                bestDistance = search->distance[(size_t)from * n + r];
+            }
+        }
+
+        return (best < 0) ? NULL : &search->rooms[search->nextHop[(size_t)from * n + best]];
+    }
+
+    if (hunter->routeLength > 0 && hunter->route[hunter->routeLength - 1] == from) {
+        hunter->routeLength--;
+    }
+
+    int routeValid = hunter->routeLength > 0 && isHinted(&search->rooms[hunter->routeTarget], type) &&
+                     isNeighbour(hunter->room, hunter->route[hunter->routeLength - 1]);
+
+    if (!routeValid && !routeToNearestHint(search, hunter)) {
+        return NULL;
+    }
+
+    return &search->rooms[hunter->route[hunter->routeLength - 1]];
+}
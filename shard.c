@@ -0,0 +1,728 @@
+#include "defs.h"
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+
+/* The shard driving the calling thread; NULL on the thread-per-agent engine. */
+_Thread_local ShardType *currentShard = NULL;
+
+/* Which of the shard processes this is (0 is the coordinator). */
+static int shardProcess = 0;
+
+/************************************************************************************************
+ * Function: void *mapShared(size_t size)
+ * Description: This function maps zeroed memory that stays shared with processes forked later.
+ * Parameters:
+ *      - size_t size: The number of bytes.
+ * Return: The mapping.
+ ************************************************************************************************/
+static void *mapShared(size_t size) {
+    void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        perror("Failed to map shard memory");
+        exit(EXIT_FAILURE);
+    }
+    return memory;
+}
+
+/************************************************************************************************
+ * Function: void initShardQueue(ShardQueueType *queue, size_t minimum, int owner)
+ * Description: This function allocates a queue with room for at least the given number of
+ *              messages (rounded up to a power of two), on the NUMA node of the shard that reads
+ *              it when --numa is given. Every slot starts out free for the producer whose ticket
+ *              matches its index.
+ * Parameters:
+ *      - ShardQueueType *queue: The queue to initialize.
+ *      - size_t minimum: The number of messages it must be able to hold at once.
+ *      - int owner: The shard the queue belongs to.
+ * Return: None
+ ************************************************************************************************/
+static void initShardQueue(ShardQueueType *queue, size_t minimum, int owner) {
+    size_t capacity = 2;
+    while (capacity < minimum) {
+        capacity <<= 1;
+    }
+
+    queue->slots = mapShared(capacity * sizeof(ShardQueueSlotType));
+    bindToWorkerNode(queue->slots, capacity * sizeof(ShardQueueSlotType), owner);
+
+    for (size_t i = 0; i < capacity; i++) {
+        atomic_init(&queue->slots[i].sequence, i);
+    }
+
+    queue->mask = capacity - 1;
+    queue->head = 0;
+    atomic_init(&queue->tail, 0);
+}
+
+/************************************************************************************************
+ * Function: int pushShardQueue(ShardQueueType *queue, const ShardMessageType *message)
+ * Description: This function appends a message to another shard's inbox. Producers claim a slot
+ *              by advancing the tail with a compare-and-swap and publish the message by bumping
+ *              the slot's sequence number, so no producer ever waits for another.
+ * Parameters:
+ *      - ShardQueueType *queue: The inbox to append to.
+ *      - const ShardMessageType *message: The message to copy in.
+ * Return: C_TRUE if the message was queued, C_FALSE if the queue is full.
+ ************************************************************************************************/
+static int pushShardQueue(ShardQueueType *queue, const ShardMessageType *message) {
+    size_t position = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    ShardQueueSlotType *slot;
+
+    while (C_TRUE) {
+        slot = &queue->slots[position & queue->mask];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+        if (difference == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->tail, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            return C_FALSE;
+        } else {
+            position = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+        }
+    }
+
+    slot->message = *message;
+    atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+    return C_TRUE;
+}
+
+/************************************************************************************************
+ * Function: int popShardQueue(ShardQueueType *queue, ShardMessageType *message)
+ * Description: This function takes the oldest published message out of a shard's own inbox.
+ *              Only the owning shard calls it, so the head needs no atomics.
+ * Parameters:
+ *      - ShardQueueType *queue: The inbox to read.
+ *      - ShardMessageType *message: Receives the message.
+ * Return: C_TRUE if a message was taken, C_FALSE if the inbox is empty.
+ ************************************************************************************************/
+static int popShardQueue(ShardQueueType *queue, ShardMessageType *message) {
+    ShardQueueSlotType *slot = &queue->slots[queue->head & queue->mask];
+    size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+
+    if ((intptr_t)sequence - (intptr_t)(queue->head + 1) < 0) {
+        return C_FALSE;
+    }
+
+    *message = slot->message;
+    atomic_store_explicit(&slot->sequence, queue->head + queue->mask + 1, memory_order_release);
+    queue->head++;
+    return C_TRUE;
+}
+
+/************************************************************************************************
+ * Function: void captureHunter(const HunterType *hunter, ShardAgentStateType *state)
+ * Description: This function copies what another process needs to continue a hunter. Ghostly
+ *              evidence is copied first; evidence beyond SHARD_EVIDENCE_MAX entries is dropped.
+ * Parameters:
+ *      - const HunterType *hunter: The hunter.
+ *      - ShardAgentStateType *state: Receives its state.
+ * Return: None
+ ************************************************************************************************/
+static void captureHunter(const HunterType *hunter, ShardAgentStateType *state) {
+    state->owner = shardProcess;
+    state->room = hunter->room->id;
+    state->fear = hunter->fear;
+    state->timer = hunter->timer;
+    state->evidenceCollected = hunter->evidenceCollected;
+    state->steps = hunter->steps;
+    state->rng = hunter->rng.state;
+    state->evidenceCount = 0;
+
+    for (int ghostly = C_TRUE; ghostly >= C_FALSE; ghostly--) {
+        for (EvidenceNodeType *node = hunter->ghostEvidence->head; node != NULL && state->evidenceCount < SHARD_EVIDENCE_MAX; node = node->next) {
+            if (isEvidenceFromGhost(node->data) == ghostly) {
+                state->evidence[state->evidenceCount++] = *node->data;
+            }
+        }
+    }
+}
+
+/************************************************************************************************
+ * Function: void applyHunter(HunterType *hunter, const ShardAgentStateType *state)
+ * Description: This function overwrites this process's copy of a hunter with the state another
+ *              process captured, rebuilding its evidence list.
+ * Parameters:
+ *      - HunterType *hunter: The local copy of the hunter.
+ *      - const ShardAgentStateType *state: The captured state.
+ * Return: None
+ ************************************************************************************************/
+static void applyHunter(HunterType *hunter, const ShardAgentStateType *state) {
+    hunter->fear = state->fear;
+    hunter->timer = state->timer;
+    hunter->evidenceCollected = state->evidenceCollected;
+    hunter->steps = state->steps;
+    hunter->rng.state = state->rng;
+    hunter->routeLength = 0;
+
+    // The stale list goes back to the house, and the new one is built from it
+    for (EvidenceNodeType *node = hunter->ghostEvidence->head; node != NULL;) {
+        EvidenceNodeType *next = node->next;
+        recycleHunterEvidence(hunter->house, node);
+        node = next;
+    }
+    initializeEvidence(hunter->ghostEvidence);
+
+    for (int i = 0; i < state->evidenceCount; i++) {
+        EvidenceNodeType *node = newHunterEvidence(hunter->house);
+
+        *node->data = state->evidence[i];
+        addHunterEvidence(hunter->ghostEvidence, node);
+    }
+}
+
+/************************************************************************************************
+ * Function: void captureGhost(const GhostType *ghost, ShardAgentStateType *state)
+ * Description: This function copies what another process needs to continue the ghost.
+ * Parameters:
+ *      - const GhostType *ghost: The ghost.
+ *      - ShardAgentStateType *state: Receives its state.
+ * Return: None
+ ************************************************************************************************/
+static void captureGhost(const GhostType *ghost, ShardAgentStateType *state) {
+    state->owner = shardProcess;
+    state->room = ghost->room->id;
+    state->boredom = ghost->boredomDuration;
+    state->steps = ghost->steps;
+    state->rng = ghost->rng.state;
+    state->evidenceCount = 0;
+}
+
+/************************************************************************************************
+ * Function: void applyGhost(GhostType *ghost, const ShardAgentStateType *state)
+ * Description: This function overwrites this process's copy of the ghost with captured state.
+ * Parameters:
+ *      - GhostType *ghost: The local copy of the ghost.
+ *      - const ShardAgentStateType *state: The captured state.
+ * Return: None
+ ************************************************************************************************/
+static void applyGhost(GhostType *ghost, const ShardAgentStateType *state) {
+    ghost->boredomDuration = state->boredom;
+    ghost->steps = state->steps;
+    ghost->rng.state = state->rng;
+}
+
+/************************************************************************************************
+ * Function: void sendToShard(ShardedHouseType *sharded, int room, ShardMessageType *message)
+ * Description: This function delivers a message to the shard owning a room. When that shard
+ *              runs in another process the agent's state travels with the message. Every agent is
+ *              in at most one inbox at a time and inboxes hold all of them, so a full queue is
+ *              only ever a transient state and the sender simply retries.
+ * Parameters:
+ *      - ShardedHouseType *sharded: The sharded house.
+ *      - int room: The id of the room the agent is moving into.
+ *      - const ShardMessageType *message: The message to deliver.
+ * Return: None
+ ************************************************************************************************/
+static void sendToShard(ShardedHouseType *sharded, int room, ShardMessageType *message) {
+    ShardType *target = &sharded->shards[sharded->roomShard[room]];
+
+    if (target->process != shardProcess) {
+        message->remote = C_TRUE;
+        if (message->kind == SHARD_HUNTER) {
+            captureHunter(sharded->house->hunters->hunterList[message->agent], &message->state);
+        } else {
+            captureGhost(sharded->house->ghost, &message->state);
+        }
+    }
+
+    while (!pushShardQueue(&target->inbox, message)) {
+        sched_yield();
+    }
+}
+
+/************************************************************************************************
+ * Function: void adoptHunter(ShardType *shard, HunterType *hunter)
+ * Description: This function adds a hunter to the set of hunters a shard steps.
+ * Parameters:
+ *      - ShardType *shard: The shard taking the hunter.
+ *      - HunterType *hunter: The hunter.
+ * Return: None
+ ************************************************************************************************/
+static void adoptHunter(ShardType *shard, HunterType *hunter) {
+    if (shard->hunterCount == shard->hunterCapacity) {
+        int capacity = shard->hunterCapacity ? 2 * shard->hunterCapacity : MAX_HUNTERS;
+        shard->hunters = arenaGrow(shard->sharded->house->arena, shard->hunters, shard->hunterCapacity * sizeof(HunterType *),
+                                   capacity * sizeof(HunterType *), _Alignof(HunterType *));
+        shard->hunterCapacity = capacity;
+    }
+
+    shard->hunters[shard->hunterCount++] = hunter;
+}
+
+/************************************************************************************************
+ * Function: int shardMoveHunter(ShardType *shard, HunterType *hunter, RoomType *target)
+ * Description: This function moves a hunter on a sharded engine thread. A place in the target
+ *              room is reserved on its atomic occupancy counter first, which is the only state
+ *              shards share; the hunter then leaves its room. Moves inside the shard finish right
+ *              away, moves across a boundary are left pending for the worker to send once the
+ *              step is over.
+ * Parameters:
+ *      - ShardType *shard: The shard running the hunter.
+ *      - HunterType *hunter: The moving hunter.
+ *      - RoomType *target: The room it wants to enter.
+ * Return: C_TRUE if the hunter moved, C_FALSE if the room was full, C_HANDED_OFF if the hunter
+ *         now belongs to another shard.
+ ************************************************************************************************/
+int shardMoveHunter(ShardType *shard, HunterType *hunter, RoomType *target) {
+    ShardedHouseType *sharded = shard->sharded;
+    atomic_int *occupancy = &sharded->occupancy[target->id];
+
+    int occupied = atomic_load_explicit(occupancy, memory_order_relaxed);
+    do {
+        if (occupied >= MAX_HUNTERS) {
+            TELEMETRY_COUNT(moveFailures, 1);
+            return C_FALSE;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(occupancy, &occupied, occupied + 1,
+                                                    memory_order_acq_rel, memory_order_relaxed));
+
+    RoomType *oldRoom = hunter->room;
+    rerepositionHunter(hunter, C_FALSE);
+    atomic_fetch_sub_explicit(&sharded->occupancy[oldRoom->id], 1, memory_order_release);
+
+    hunter->timer--;
+    TELEMETRY_COUNT(moves, 1);
+    logEvent("[HUNTER MOVE] [%s] has moved into [%s]\n", hunter->name, target->topology->name);
+
+    if (sharded->roomShard[target->id] == shard->id) {
+        assignHunterToRoom(target, hunter);
+        return C_TRUE;
+    }
+
+    hunter->room = target;
+    shard->pendingHunter = hunter;
+    return C_HANDED_OFF;
+}
+
+/************************************************************************************************
+ * Function: int shardHandOffGhost(ShardType *shard, GhostType *ghost)
+ * Description: This function checks whether the room the ghost just moved into belongs to another
+ *              shard, in which case the ghost is left pending for the worker to send.
+ * Parameters:
+ *      - ShardType *shard: The shard running the ghost.
+ *      - GhostType *ghost: The ghost, already pointing at its new room.
+ * Return: C_TRUE if the ghost is handed off, C_FALSE if the room is local.
+ ************************************************************************************************/
+int shardHandOffGhost(ShardType *shard, GhostType *ghost) {
+    if (shard->sharded->roomShard[ghost->room->id] == shard->id) {
+        return C_FALSE;
+    }
+
+    shard->pendingGhost = ghost;
+    return C_TRUE;
+}
+
+/************************************************************************************************
+ * Function: int drainShardInbox(ShardType *shard)
+ * Description: This function links every agent that arrived from another shard into its room.
+ * Parameters:
+ *      - ShardType *shard: The receiving shard.
+ * Return: The number of agents received.
+ ************************************************************************************************/
+static int drainShardInbox(ShardType *shard) {
+    HouseType *house = shard->sharded->house;
+    ShardMessageType message;
+    int received = 0;
+
+    while (popShardQueue(&shard->inbox, &message)) {
+        RoomType *room = &shard->sharded->rooms[message.room];
+
+        if (message.kind == SHARD_HUNTER) {
+            HunterType *hunter = house->hunters->hunterList[message.agent];
+            if (message.remote) {
+                applyHunter(hunter, &message.state);
+            }
+            assignHunterToRoom(room, hunter);
+            adoptHunter(shard, hunter);
+        } else {
+            if (message.remote) {
+                applyGhost(house->ghost, &message.state);
+            }
+            house->ghost->room = room;
+            room->ghost = house->ghost;
+            if (message.active) {
+                shard->ghost = house->ghost;
+            }
+        }
+
+        received++;
+    }
+
+    return received;
+}
+
+/************************************************************************************************
+ * Function: void stepShardHunters(ShardType *shard)
+ * Description: This function gives every hunter of the shard one turn. Hunters that crossed into
+ *              another shard are sent there; hunters that stopped leave the house.
+ * Parameters:
+ *      - ShardType *shard: The shard to step.
+ * Return: None
+ ************************************************************************************************/
+static void stepShardHunters(ShardType *shard) {
+    ShardedHouseType *sharded = shard->sharded;
+    int i = 0;
+
+    while (i < shard->hunterCount) {
+        HunterType *hunter = shard->hunters[i];
+
+        bindRng(&hunter->rng);
+        int keepGoing = hunterStep(hunter);
+        shard->steps++;
+
+        if (shard->pendingHunter == hunter) {
+            ShardMessageType message = { .kind = SHARD_HUNTER, .agent = hunter->id, .room = hunter->room->id, .active = C_TRUE };
+            shard->pendingHunter = NULL;
+            shard->hunters[i] = shard->hunters[--shard->hunterCount];
+            shard->handoffs++;
+            sendToShard(sharded, message.room, &message);
+            continue;
+        }
+
+        if (!keepGoing) {
+            atomic_fetch_sub_explicit(&sharded->occupancy[hunter->room->id], 1, memory_order_release);
+            finishHunter(hunter);
+            if (sharded->processCount > 1) {
+                captureHunter(hunter, &sharded->results[hunter->id]);
+            }
+            shard->hunters[i] = shard->hunters[--shard->hunterCount];
+            atomic_fetch_sub_explicit(&sharded->activeAgents, 1, memory_order_release);
+            continue;
+        }
+
+        i++;
+    }
+}
+
+/************************************************************************************************
+ * Function: void stepShardGhost(ShardType *shard)
+ * Description: This function gives the ghost its turn if the shard owns it, sending it on when it
+ *              moved into another shard. A ghost that stopped haunting is still linked into its
+ *              last room so hunters keep finding it.
+ * Parameters:
+ *      - ShardType *shard: The shard to step.
+ * Return: None
+ ************************************************************************************************/
+static void stepShardGhost(ShardType *shard) {
+    GhostType *ghost = shard->ghost;
+    if (ghost == NULL) {
+        return;
+    }
+
+    bindRng(&ghost->rng);
+    int keepGoing = ghostStep(ghost);
+    shard->steps++;
+
+    if (shard->pendingGhost == ghost) {
+        ShardMessageType message = { .kind = SHARD_GHOST, .room = ghost->room->id, .active = keepGoing };
+        shard->pendingGhost = NULL;
+        shard->ghost = NULL;
+        shard->handoffs++;
+        sendToShard(shard->sharded, message.room, &message);
+    }
+
+    if (!keepGoing) {
+        if (shard->sharded->processCount > 1) {
+            captureGhost(ghost, &shard->sharded->results[shard->sharded->house->hunters->size]);
+        }
+        shard->ghost = NULL;
+        atomic_fetch_sub_explicit(&shard->sharded->activeAgents, 1, memory_order_release);
+    }
+}
+
+/************************************************************************************************
+ * Function: void *shardThread(void *arg)
+ * Description: This function is the worker of one shard. It alternates between receiving agents
+ *              and stepping the ones it owns until no agent anywhere is still active. Rooms are
+ *              never locked: only this thread touches the rooms, hunters and evidence of its shard.
+ *              A win found by any shard is copied into the house so its agents stop too.
+ * Parameters:
+ *      - void *arg: The ShardType to run.
+ * Return: NULL
+ ************************************************************************************************/
+static void *shardThread(void *arg) {
+    ShardType *shard = (ShardType *)arg;
+    ShardedHouseType *sharded = shard->sharded;
+    currentShard = shard;
+
+    while (atomic_load_explicit(&sharded->activeAgents, memory_order_acquire) > 0) {
+        if (atomic_load_explicit(&sharded->gameOver, memory_order_relaxed)) {
+            atomic_store(&sharded->house->gameOver, C_TRUE);
+        }
+
+        drainShardInbox(shard);
+
+        if (shard->hunterCount == 0 && shard->ghost == NULL) {
+            sched_yield();
+            continue;
+        }
+
+        stepShardHunters(shard);
+        stepShardGhost(shard);
+    }
+
+    drainShardInbox(shard);
+    telemetryFlush();
+    latencyFlush();
+    releaseSearchScratch();
+    bindRng(NULL);
+    currentShard = NULL;
+    return NULL;
+}
+
+/************************************************************************************************
+ * Function: void partitionRooms(ShardedHouseType *sharded, int roomCount)
+ * Description: This function splits the rooms into contiguous regions: rooms are ordered
+ *              breadth-first from the van and the order is cut into equal chunks, so most
+ *              connections stay inside a shard.
+ * Parameters:
+ *      - ShardedHouseType *sharded: The sharded house with its rooms array filled in.
+ *      - int roomCount: The number of rooms.
+ * Return: None
+ ************************************************************************************************/
+static void partitionRooms(ShardedHouseType *sharded, int roomCount) {
+    int *order = arenaAlloc(sharded->house->arena, roomCount * sizeof(int), _Alignof(int));
+    char *seen = arenaAlloc(sharded->house->arena, roomCount, 1);
+    memset(seen, 0, roomCount);
+
+    int tail = 0;
+    for (int start = 0; start < roomCount; start++) {
+        if (seen[start]) {
+            continue;
+        }
+
+        seen[start] = C_TRUE;
+        order[tail++] = start;
+
+        for (int head = tail - 1; head < tail; head++) {
+            const RoomTopologyType *room = sharded->rooms[order[head]].topology;
+            for (int e = 0; e < room->connectedCount; e++) {
+                int id = room->connected[e];
+                if (!seen[id]) {
+                    seen[id] = C_TRUE;
+                    order[tail++] = id;
+                }
+            }
+        }
+    }
+
+    for (int k = 0; k < roomCount; k++) {
+        sharded->roomShard[order[k]] = (int)((long long)k * sharded->shardCount / roomCount);
+    }
+}
+
+/************************************************************************************************
+ * Function: int shardCountEvidence(ShardType *shard)
+ * Description: This function counts a hunter reaching its evidence limit on the counter shared by
+ *              every shard, ending the game for all of them at the third.
+ * Parameters:
+ *      - ShardType *shard: The shard running the hunter.
+ * Return: The number of hunters that reached the limit so far.
+ ************************************************************************************************/
+int shardCountEvidence(ShardType *shard) {
+    int total = atomic_fetch_add(&shard->sharded->evidenceCollected, 1) + 1;
+
+    if (total >= 3) {
+        atomic_store(&shard->sharded->gameOver, C_TRUE);
+    }
+
+    return total;
+}
+
+/************************************************************************************************
+ * Function: void runShardProcess(ShardedHouseType *sharded)
+ * Description: This function runs the shards assigned to the calling process: it takes the
+ *              agents standing in their rooms and runs one worker thread per shard until every
+ *              agent of the house has stopped.
+ * Parameters:
+ *      - ShardedHouseType *sharded: The sharded house.
+ * Return: None
+ ************************************************************************************************/
+static void runShardProcess(ShardedHouseType *sharded) {
+    HouseType *house = sharded->house;
+
+    for (int i = 0; i < house->hunters->size; i++) {
+        HunterType *hunter = house->hunters->hunterList[i];
+        ShardType *shard = &sharded->shards[sharded->roomShard[hunter->room->id]];
+
+        if (!hunter->done && shard->process == shardProcess) {
+            adoptHunter(shard, hunter);
+        }
+    }
+
+    ShardType *ghostShard = &sharded->shards[sharded->roomShard[house->ghost->room->id]];
+    if (ghostShard->process == shardProcess) {
+        ghostShard->ghost = house->ghost;
+    }
+
+    for (int s = shardProcess; s < sharded->shardCount; s += sharded->processCount) {
+        createWorkerThread(&sharded->shards[s].thread, s, shardThread, &sharded->shards[s]);
+    }
+
+    for (int s = shardProcess; s < sharded->shardCount; s += sharded->processCount) {
+        pthread_join(sharded->shards[s].thread, NULL);
+        sharded->shards[s].hunters = NULL;
+    }
+}
+
+/************************************************************************************************
+ * Function: void mergeShardResults(ShardedHouseType *sharded)
+ * Description: This function brings the coordinator's copy of the house up to date after a
+ *              multi-process run: agents last run by another process get the state that process
+ *              published, and rooms owned by other processes are emptied (every hunter has left
+ *              the house by now) before the ghost is linked into its final room.
+ * Parameters:
+ *      - ShardedHouseType *sharded: The sharded house.
+ * Return: None
+ ************************************************************************************************/
+static void mergeShardResults(ShardedHouseType *sharded) {
+    HouseType *house = sharded->house;
+    int hunterCount = house->hunters->size;
+
+    for (int r = 0; r < house->roomCount; r++) {
+        if (sharded->shards[sharded->roomShard[r]].process != 0) {
+            house->rooms[r].hunterCount = 0;
+            house->rooms[r].ghost = NULL;
+        }
+    }
+
+    for (int i = 0; i < hunterCount; i++) {
+        ShardAgentStateType *state = &sharded->results[i];
+        if (state->owner > 0) {
+            HunterType *hunter = house->hunters->hunterList[i];
+            applyHunter(hunter, state);
+            hunter->room = &sharded->rooms[state->room];
+            hunter->done = C_TRUE;
+        }
+    }
+
+    ShardAgentStateType *ghostState = &sharded->results[hunterCount];
+    if (ghostState->owner > 0) {
+        applyGhost(house->ghost, ghostState);
+        house->ghost->room = &sharded->rooms[ghostState->room];
+    }
+    house->ghost->room->ghost = house->ghost;
+}
+
+/************************************************************************************************
+ * Function: void runShardedHouse(HouseType *house, int shardCount, int processCount)
+ * Description: This function plays a house on shardCount worker threads instead of one thread per
+ *              agent. Each worker owns a region of rooms and runs every agent standing in it;
+ *              agents crossing a region boundary travel through the lock-free inbox of the
+ *              receiving shard. With processCount above one the shards are dealt out to forked
+ *              processes: the queues, room occupancy and results live in shared memory, agents
+ *              carry their state across, and this process merges the results at the end.
+ *              Rest durations are not slept, turns follow one another directly.
+ * Parameters:
+ *      - HouseType *house: The house to play, set up as for runGame.
+ *      - int shardCount: The number of shards (capped at the number of rooms).
+ *      - int processCount: The number of processes (capped at the number of shards).
+ * Return: None
+ ************************************************************************************************/
+void runShardedHouse(HouseType *house, int shardCount, int processCount) {
+    int roomCount = house->roomCount;
+    int hunterCount = house->hunters->size;
+    if (shardCount > roomCount) {
+        shardCount = roomCount;
+    }
+    if (processCount > shardCount) {
+        processCount = shardCount;
+    }
+    if (processCount < 1) {
+        processCount = 1;
+    }
+
+    ShardedHouseType *sharded = mapShared(sizeof(ShardedHouseType));
+    sharded->house = house;
+    sharded->shardCount = shardCount;
+    sharded->processCount = processCount;
+    sharded->rooms = house->rooms;
+    sharded->roomShard = arenaAlloc(house->arena, roomCount * sizeof(int), _Alignof(int));
+    sharded->occupancy = mapShared(roomCount * sizeof(atomic_int));
+    sharded->results = mapShared((hunterCount + 1) * sizeof(ShardAgentStateType));
+    sharded->shards = mapShared(shardCount * sizeof(ShardType));
+
+    for (int r = 0; r < roomCount; r++) {
+        atomic_init(&sharded->occupancy[r], house->rooms[r].hunterCount);
+    }
+
+    for (int i = 0; i <= hunterCount; i++) {
+        sharded->results[i].owner = -1;
+    }
+
+    partitionRooms(sharded, roomCount);
+
+    int agents = 1;
+    for (int i = 0; i < hunterCount; i++) {
+        agents += !house->hunters->hunterList[i]->done;
+    }
+    atomic_init(&sharded->activeAgents, agents);
+    atomic_init(&sharded->gameOver, atomic_load(&house->gameOver));
+    atomic_init(&sharded->evidenceCollected, atomic_load(&house->evidenceCollected));
+
+    for (int s = 0; s < shardCount; s++) {
+        ShardType *shard = &sharded->shards[s];
+        shard->id = s;
+        shard->process = s % processCount;
+        shard->sharded = sharded;
+        initShardQueue(&shard->inbox, agents + 1, s);
+    }
+
+    fflush(stdout);
+
+    pid_t *children = arenaAlloc(house->arena, processCount * sizeof(pid_t), _Alignof(pid_t));
+    for (int p = 1; p < processCount; p++) {
+        children[p] = fork();
+
+        if (children[p] < 0) {
+            perror("Failed to fork shard process");
+            for (int q = 1; q < p; q++) {
+                kill(children[q], SIGKILL);
+            }
+            exit(EXIT_FAILURE);
+        }
+
+        if (children[p] == 0) {
+            shardProcess = p;
+            runShardProcess(sharded);
+            fflush(stdout);
+            _exit(EXIT_SUCCESS);
+        }
+    }
+
+    runShardProcess(sharded);
+
+    for (int p = 1; p < processCount; p++) {
+        waitpid(children[p], NULL, 0);
+    }
+
+    if (processCount > 1) {
+        mergeShardResults(sharded);
+    }
+
+    atomic_store(&house->evidenceCollected, atomic_load(&sharded->evidenceCollected));
+    if (atomic_load(&sharded->gameOver)) {
+        atomic_store(&house->gameOver, C_TRUE);
+    }
+
+    uint64_t steps = 0;
+    uint64_t handoffs = 0;
+    for (int s = 0; s < shardCount; s++) {
+        steps += sharded->shards[s].steps;
+        handoffs += sharded->shards[s].handoffs;
+        munmap(sharded->shards[s].inbox.slots, (sharded->shards[s].inbox.mask + 1) * sizeof(ShardQueueSlotType));
+    }
+
+    logEvent("[SHARDS] %d shards in %d processes ran %llu agent steps with %llu handoffs\n",
+             shardCount, processCount, (unsigned long long)steps, (unsigned long long)handoffs);
+
+    munmap(sharded->shards, shardCount * sizeof(ShardType));
+    munmap(sharded->results, (hunterCount + 1) * sizeof(ShardAgentStateType));
+    munmap(sharded->occupancy, roomCount * sizeof(atomic_int));
+    munmap(sharded, sizeof(ShardedHouseType));
+}
@@ -0,0 +1,535 @@
+#include "defs.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#define SNAPSHOT_MAGIC   "PPSNAP1"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_NO_ROOM -1
+
+/*
+ * On-disk layout (native byte order, every section 8 byte aligned):
+ *   SnapshotHeaderType
+ *   SnapshotRoomType      rooms[roomCount]
+ *   int32_t               adjacency[adjacencyCount]     (room ids, each room's connected slice in turn)
+ *   SnapshotHunterType    hunters[hunterCount]
+ *   SnapshotEvidenceType  evidence[evidenceCount]       (room lists first, then hunter lists)
+ * Pointers are stored as room/hunter indices so the image can be restored at any address.
+ */
+typedef struct SnapshotHeaderType {
+    char magic[8];
+    uint32_t version;
+    uint32_t roomCount;
+    uint32_t adjacencyCount;
+    uint32_t hunterCount;
+    uint32_t evidenceCount;
+    int32_t totalEvidenceCollected;
+    uint64_t houseRng;
+    int32_t ghostType;
+    int32_t ghostRoom;
+    int32_t ghostBoredom;
+    int32_t ghostRest;
+    int32_t ghostLinked;
+    int32_t padding;
+    uint64_t ghostRng;
+} SnapshotHeaderType;
+
+typedef struct SnapshotRoomType {
+    char name[MAX_STR];
+    uint32_t adjacencyStart;
+    uint32_t adjacencyCount;
+    uint32_t evidenceStart;
+    uint32_t evidenceCount;
+    int32_t occupants[MAX_HUNTERS];
+    int32_t occupantCount;
+    int32_t padding;
+} SnapshotRoomType;
+
+typedef struct SnapshotHunterType {
+    char name[MAX_STR];
+    int32_t room;
+    int32_t evidence;
+    int32_t fear;
+    int32_t timer;
+    int32_t restDuration;
+    int32_t evidenceCollected;
+    int32_t done;
+    uint32_t evidenceStart;
+    uint32_t evidenceCount;
+    int32_t padding;
+    uint64_t rng;
+} SnapshotHunterType;
+
+typedef struct SnapshotEvidenceType {
+    int32_t evidenceType;
+    float readingInfo;
+} SnapshotEvidenceType;
+
+/* *******************************************************************************************
+ * Function: int countEvidenceNodes(const GhostEvidenceListType *list)
+ * Description: This function counts the nodes of an evidence list.
+ * Parameters:
+ *      - const GhostEvidenceListType *list: The list to count.
+ * Return: The number of nodes in the list.
+ ********************************************************************************************/
+static int countEvidenceNodes(const GhostEvidenceListType *list) {
+    int count = 0;
+    for (const EvidenceNodeType *node = list->head; node != NULL; node = node->next) {
+        count++;
+    }
+    return count;
+}
+
+/* *******************************************************************************************
+ * Function: int countRoomEvidence(RoomType *room)
+ * Description: This function counts the evidence left in a room, over all its channels. The
+ *              channels must be claimed (lockRoomEvidence) or the house idle.
+ * Parameters:
+ *      - RoomType *room: The room to count.
+ * Return: The number of pieces of evidence in the room.
+ ********************************************************************************************/
+static int countRoomEvidence(RoomType *room) {
+    int count = 0;
+    for (int i = 0; i < EVIDENCE_TYPES; i++) {
+        for (const EvidenceChannelNodeType *node = settleEvidence(&room->evidence[i]); node != NULL; node = node->next) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/* *******************************************************************************************
+ * Function: int writeRoomEvidence(FILE *file, RoomType *room)
+ * Description: This function writes the evidence left in a room as SnapshotEvidenceTypes,
+ *              one channel after the other, oldest first within each.
+ * Parameters:
+ *      - FILE *file: The snapshot file.
+ *      - RoomType *room: The room to write.
+ * Return: C_TRUE on success, C_FALSE on a write error.
+ ********************************************************************************************/
+static int writeRoomEvidence(FILE *file, RoomType *room) {
+    for (int i = 0; i < EVIDENCE_TYPES; i++) {
+        for (const EvidenceChannelNodeType *node = room->evidence[i].pending; node != NULL; node = node->next) {
+            SnapshotEvidenceType record = { node->evidence.evidenceType, node->evidence.readingInfo };
+            if (fwrite(&record, sizeof(record), 1, file) != 1) {
+                return C_FALSE;
+            }
+        }
+    }
+    return C_TRUE;
+}
+
+/* *******************************************************************************************
+ * Function: int writeEvidenceNodes(FILE *file, const GhostEvidenceListType *list)
+ * Description: This function writes every node of an evidence list as a SnapshotEvidenceType.
+ * Parameters:
+ *      - FILE *file: The snapshot file.
+ *      - const GhostEvidenceListType *list: The list to write.
+ * Return: C_TRUE on success, C_FALSE on a write error.
+ ********************************************************************************************/
+static int writeEvidenceNodes(FILE *file, const GhostEvidenceListType *list) {
+    for (const EvidenceNodeType *node = list->head; node != NULL; node = node->next) {
+        SnapshotEvidenceType record = { node->data->evidenceType, node->data->readingInfo };
+        if (fwrite(&record, sizeof(record), 1, file) != 1) {
+            return C_FALSE;
+        }
+    }
+    return C_TRUE;
+}
+
+/* *******************************************************************************************
+ * Function: int saveHouseSnapshot(HouseType *house, const char *path)
+ * Description: This function writes the complete state of a house to a compact binary snapshot:
+ *              rooms with their adjacency, occupants and evidence, every hunter with its fear,
+ *              timer, collected evidence and generator, the ghost and the house generator. The
+ *              caller must make sure no agent changes the house while it is being written
+ *              (see checkpointHouse).
+ * Parameters:
+ *      - HouseType *house: The house to save.
+ *      - const char *path: The file to write.
+ * Return: C_TRUE on success, C_FALSE otherwise.
+ ********************************************************************************************/
+int saveHouseSnapshot(HouseType *house, const char *path) {
+    SnapshotHeaderType header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.roomCount = house->roomCount;
+    header.hunterCount = house->hunters->size;
+    header.totalEvidenceCollected = atomic_load(&house->evidenceCollected);
+    header.houseRng = house->rng.state;
+    header.ghostType = house->ghost->ghostType;
+    header.ghostRoom = house->ghost->room ? house->ghost->room->id : SNAPSHOT_NO_ROOM;
+    header.ghostBoredom = house->ghost->boredomDuration;
+    header.ghostRest = house->ghost->restDuration;
+    header.ghostLinked = house->ghost->room != NULL && house->ghost->room->ghost == house->ghost;
+    header.ghostRng = house->ghost->rng.state;
+
+    for (int r = 0; r < house->roomCount; r++) {
+        header.adjacencyCount += house->rooms[r].topology->connectedCount;
+        header.evidenceCount += countRoomEvidence(&house->rooms[r]);
+    }
+    for (int i = 0; i < house->hunters->size; i++) {
+        header.evidenceCount += countEvidenceNodes(house->hunters->hunterList[i]->ghostEvidence);
+    }
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        perror("Failed to open snapshot for writing");
+        return C_FALSE;
+    }
+
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    uint32_t adjacencyStart = 0;
+    uint32_t evidenceStart = 0;
+    for (int r = 0; ok && r < house->roomCount; r++) {
+        RoomType *room = &house->rooms[r];
+        SnapshotRoomType record;
+        memset(&record, 0, sizeof(record));
+
+        strncpy(record.name, room->topology->name, sizeof(record.name) - 1);
+        record.adjacencyStart = adjacencyStart;
+        record.adjacencyCount = room->topology->connectedCount;
+        record.evidenceStart = evidenceStart;
+        record.evidenceCount = countRoomEvidence(room);
+        record.occupantCount = room->hunterCount;
+
+        for (int i = 0; i < room->hunterCount; i++) {
+            record.occupants[i] = SNAPSHOT_NO_ROOM;
+            for (int h = 0; h < house->hunters->size; h++) {
+                if (house->hunters->hunterList[h] == room->hunters[i]) {
+                    record.occupants[i] = h;
+                }
+            }
+        }
+
+        adjacencyStart += record.adjacencyCount;
+        evidenceStart += record.evidenceCount;
+        ok = fwrite(&record, sizeof(record), 1, file) == 1;
+    }
+
+    for (int r = 0; ok && r < house->roomCount; r++) {
+        const RoomTopologyType *room = house->rooms[r].topology;
+        ok = fwrite(room->connected, sizeof(int32_t), room->connectedCount, file) == (size_t)room->connectedCount;
+    }
+
+    if (ok && header.adjacencyCount % 2 != 0) {
+        int32_t padding = 0;
+        ok = fwrite(&padding, sizeof(padding), 1, file) == 1;
+    }
+
+    for (int i = 0; ok && i < house->hunters->size; i++) {
+        HunterType *hunter = house->hunters->hunterList[i];
+        SnapshotHunterType record;
+        memset(&record, 0, sizeof(record));
+
+        memcpy(record.name, hunter->name, sizeof(record.name));
+        record.room = hunter->room ? hunter->room->id : SNAPSHOT_NO_ROOM;
+        record.evidence = hunter->evidence;
+        record.fear = hunter->fear;
+        record.timer = hunter->timer;
+        record.restDuration = hunter->restDuration;
+        record.evidenceCollected = hunter->evidenceCollected;
+        record.done = hunter->done;
+        record.evidenceStart = evidenceStart;
+        record.evidenceCount = countEvidenceNodes(hunter->ghostEvidence);
+        record.rng = hunter->rng.state;
+
+        evidenceStart += record.evidenceCount;
+        ok = fwrite(&record, sizeof(record), 1, file) == 1;
+    }
+
+    for (int r = 0; ok && r < house->roomCount; r++) {
+        ok = writeRoomEvidence(file, &house->rooms[r]);
+    }
+    for (int i = 0; ok && i < house->hunters->size; i++) {
+        ok = writeEvidenceNodes(file, house->hunters->hunterList[i]->ghostEvidence);
+    }
+
+    if (fclose(file) != 0) {
+        ok = C_FALSE;
+    }
+
+    if (!ok) {
+        perror("Failed to write snapshot");
+        return C_FALSE;
+    }
+
+    return C_TRUE;
+}
+
+/* *******************************************************************************************
+ * Function: int checkpointHouse(HouseType *house, const char *path)
+ * Description: This function saves a consistent snapshot of a running game. It pauses the
+ *              agent turns, so every hunter is between steps: no evidence is halfway from a
+ *              room to a hunter's list, and fear, timers, steps and evidence counts agree with
+ *              each other. It also takes every room semaphore (in room order, which cannot
+ *              deadlock with hunters because they only ever try-lock a second room) and the
+ *              taking side of every channel. The caller, the ghost between its own turns or
+ *              the tick engine between ticks, must not be inside a turn.
+ * Parameters:
+ *      - HouseType *house: The house to save.
+ *      - const char *path: The file to write.
+ * Return: C_TRUE on success, C_FALSE otherwise.
+ ********************************************************************************************/
+int checkpointHouse(HouseType *house, const char *path) {
+    pauseTurns();
+
+    for (int r = 0; r < house->roomCount; r++) {
+        sem_wait(&(house->rooms[r].semaphore));
+        lockRoomEvidence(&house->rooms[r]);
+    }
+
+    int saved = saveHouseSnapshot(house, path);
+
+    for (int r = 0; r < house->roomCount; r++) {
+        unlockRoomEvidence(&house->rooms[r]);
+        sem_post(&(house->rooms[r].semaphore));
+    }
+
+    resumeTurns();
+
+    if (saved) {
+        logEvent("[CHECKPOINT] House saved to [%s]\n", path);
+    }
+
+    return saved;
+}
+
+/* *******************************************************************************************
+ * Function: const void *mapHouseSnapshot(const char *path, size_t *size)
+ * Description: This function maps a snapshot file read-only. The mapping is shared between
+ *              forked continuations, so restoring thousands of them never rereads the file.
+ * Parameters:
+ *      - const char *path: The snapshot file.
+ *      - size_t *size: Receives the size of the mapping.
+ * Return: The mapped image, or NULL on failure.
+ ********************************************************************************************/
+const void *mapHouseSnapshot(const char *path, size_t *size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open snapshot");
+        return NULL;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(SnapshotHeaderType)) {
+        fprintf(stderr, "Snapshot [%s] is too small\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    void *image = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (image == MAP_FAILED) {
+        perror("Failed to map snapshot");
+        return NULL;
+    }
+
+    *size = info.st_size;
+    return image;
+}
+
+/* *******************************************************************************************
+ * Function: void unmapHouseSnapshot(const void *image, size_t size)
+ * Description: This function releases a mapping made by mapHouseSnapshot.
+ * Parameters:
+ *      - const void *image: The mapped image.
+ *      - size_t size: The size of the mapping.
+ * Return: None
+ ********************************************************************************************/
+void unmapHouseSnapshot(const void *image, size_t size) {
+    munmap((void *)image, size);
+}
+
+/* *******************************************************************************************
+ * Function: void restoreRoomEvidence(RoomType *room, HouseType *house, const SnapshotEvidenceType *records, uint32_t count)
+ * Description: This function drops a run of snapshot evidence records back into a room.
+ * Parameters:
+ *      - RoomType *room: The room to fill.
+ *      - HouseType *house: The house the room is in.
+ *      - const SnapshotEvidenceType *records: The first record.
+ *      - uint32_t count: The number of records.
+ * Return: None
+ ********************************************************************************************/
+static void restoreRoomEvidence(RoomType *room, HouseType *house, const SnapshotEvidenceType *records, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        EvidenceChannelNodeType *node = newChannelEvidence(house);
+
+        node->evidence.evidenceType = (EvidenceClassType)records[i].evidenceType;
+        node->evidence.readingInfo = records[i].readingInfo;
+        dropEvidence(room, node);
+    }
+}
+
+/* *******************************************************************************************
+ * Function: void restoreEvidenceNodes(GhostEvidenceListType *list, HouseType *house, const SnapshotEvidenceType *records, uint32_t count)
+ * Description: This function appends a run of snapshot evidence records to an evidence list.
+ * Parameters:
+ *      - GhostEvidenceListType *list: The list to fill.
+ *      - HouseType *house: The house of the list's hunter.
+ *      - const SnapshotEvidenceType *records: The first record.
+ *      - uint32_t count: The number of records.
+ * Return: None
+ ********************************************************************************************/
+static void restoreEvidenceNodes(GhostEvidenceListType *list, HouseType *house, const SnapshotEvidenceType *records, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        EvidenceNodeType *node = newHunterEvidence(house);
+
+        node->data->evidenceType = (EvidenceClassType)records[i].evidenceType;
+        node->data->readingInfo = records[i].readingInfo;
+        addRoomEvidence(list, node);
+    }
+}
+
+/* *******************************************************************************************
+ * Function: int restoreHouseSnapshot(HouseType *house, RunArenaType *arena, const void *image, size_t size)
+ * Description: This function rebuilds a house from a mapped snapshot. Its topology (copied
+ *              into the arena, as the snapshot is unmapped afterwards), rooms, room occupancy (in the original order), evidence lists, hunters and the ghost
+ *              are recreated exactly, including every generator state, so an unseeded restore
+ *              continues the saved game where it stopped.
+ * Parameters:
+ *      - HouseType *house: The house to build.
+ *      - RunArenaType *arena: The arena the house is allocated from.
+ *      - const void *image: The mapped snapshot.
+ *      - size_t size: The size of the mapping.
+ * Return: C_TRUE on success, C_FALSE if the image is not a valid snapshot.
+ ********************************************************************************************/
+int restoreHouseSnapshot(HouseType *house, RunArenaType *arena, const void *image, size_t size) {
+    const SnapshotHeaderType *header = image;
+
+    if (size < sizeof(*header) || memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != SNAPSHOT_VERSION || header->roomCount == 0) {
+        fprintf(stderr, "Not a PhantomPulse snapshot\n");
+        return C_FALSE;
+    }
+
+    const char *cursor = (const char *)image + sizeof(*header);
+    const SnapshotRoomType *roomRecords = (const SnapshotRoomType *)cursor;
+    cursor += header->roomCount * sizeof(SnapshotRoomType);
+    const int32_t *adjacency = (const int32_t *)cursor;
+    cursor += ((header->adjacencyCount + 1) & ~1u) * sizeof(int32_t);
+    const SnapshotHunterType *hunterRecords = (const SnapshotHunterType *)cursor;
+    cursor += header->hunterCount * sizeof(SnapshotHunterType);
+    const SnapshotEvidenceType *evidence = (const SnapshotEvidenceType *)cursor;
+    cursor += header->evidenceCount * sizeof(SnapshotEvidenceType);
+
+    if ((size_t)(cursor - (const char *)image) > size) {
+        fprintf(stderr, "Snapshot is truncated\n");
+        return C_FALSE;
+    }
+
+    for (uint32_t i = 0; i < header->adjacencyCount; i++) {
+        if (adjacency[i] < 0 || (uint32_t)adjacency[i] >= header->roomCount) {
+            fprintf(stderr, "Snapshot has an invalid connection\n");
+            return C_FALSE;
+        }
+    }
+    for (uint32_t i = 0; i < header->hunterCount; i++) {
+        if (hunterRecords[i].room < 0 || (uint32_t)hunterRecords[i].room >= header->roomCount) {
+            fprintf(stderr, "Snapshot has a hunter outside the house\n");
+            return C_FALSE;
+        }
+        if (hunterRecords[i].evidence < 0 || hunterRecords[i].evidence >= EVIDENCE_TYPES ||
+            (uint64_t)hunterRecords[i].evidenceStart + hunterRecords[i].evidenceCount > header->evidenceCount) {
+            fprintf(stderr, "Snapshot has an invalid hunter\n");
+            return C_FALSE;
+        }
+    }
+    if (header->ghostType < 0 || header->ghostType >= GHOST_TYPES) {
+        fprintf(stderr, "Snapshot has a ghost of an unknown type\n");
+        return C_FALSE;
+    }
+    if (header->ghostRoom != SNAPSHOT_NO_ROOM && (header->ghostRoom < 0 || (uint32_t)header->ghostRoom >= header->roomCount)) {
+        fprintf(stderr, "Snapshot has the ghost outside the house\n");
+        return C_FALSE;
+    }
+    for (uint32_t i = 0; i < header->evidenceCount; i++) {
+        if (evidence[i].evidenceType < 0 || evidence[i].evidenceType >= EVIDENCE_TYPES) {
+            fprintf(stderr, "Snapshot has evidence of an unknown type\n");
+            return C_FALSE;
+        }
+    }
+    for (uint32_t i = 0; i < header->roomCount; i++) {
+        if ((uint64_t)roomRecords[i].adjacencyStart + roomRecords[i].adjacencyCount > header->adjacencyCount ||
+            (uint64_t)roomRecords[i].evidenceStart + roomRecords[i].evidenceCount > header->evidenceCount ||
+            roomRecords[i].occupantCount < 0 || roomRecords[i].occupantCount > MAX_HUNTERS) {
+            fprintf(stderr, "Snapshot has an invalid room\n");
+            return C_FALSE;
+        }
+        for (int o = 0; o < roomRecords[i].occupantCount; o++) {
+            if (roomRecords[i].occupants[o] < 0 || (uint32_t)roomRecords[i].occupants[o] >= header->hunterCount) {
+                fprintf(stderr, "Snapshot has an invalid room occupant\n");
+                return C_FALSE;
+            }
+        }
+    }
+
+    initializeHouse(house, arena);
+    house->rng.state = header->houseRng;
+    atomic_store(&house->evidenceCollected, header->totalEvidenceCollected);
+
+    HouseTopologyType *topology = arenaAlloc(arena, sizeof(HouseTopologyType), _Alignof(HouseTopologyType));
+    RoomTopologyType *roomTopologies = arenaAlloc(arena, header->roomCount * sizeof(RoomTopologyType), CACHE_LINE);
+    int32_t *connections = arenaAlloc(arena, ((size_t)header->adjacencyCount + 1) * sizeof(int32_t), CACHE_LINE);
+    char (*names)[MAX_STR] = arenaAlloc(arena, header->roomCount * sizeof(*names), CACHE_LINE);
+
+    memcpy(connections, adjacency, header->adjacencyCount * sizeof(int32_t));
+    for (uint32_t i = 0; i < header->roomCount; i++) {
+        strncpy(names[i], roomRecords[i].name, MAX_STR - 1);
+        names[i][MAX_STR - 1] = '\0';
+        roomTopologies[i].name = names[i];
+        roomTopologies[i].connected = connections + roomRecords[i].adjacencyStart;
+        roomTopologies[i].connectedCount = roomRecords[i].adjacencyCount;
+    }
+
+    topology->roomCount = header->roomCount;
+    topology->connectionCount = header->adjacencyCount;
+    topology->rooms = roomTopologies;
+    topology->nextHop = topology->distance = NULL;
+
+    buildHouseRooms(house, topology);
+    RoomType *rooms = house->rooms;
+
+    for (uint32_t i = 0; i < header->roomCount; i++) {
+        const SnapshotRoomType *record = &roomRecords[i];
+
+        restoreRoomEvidence(&rooms[i], house, evidence + record->evidenceStart, record->evidenceCount);
+    }
+
+    for (uint32_t i = 0; i < header->hunterCount; i++) {
+        const SnapshotHunterType *record = &hunterRecords[i];
+        HunterType *hunter;
+
+        initializeHunter((char *)record->name, &rooms[record->room], record->evidence, record->restDuration, arena, &hunter);
+        hunter->fear = record->fear;
+        hunter->timer = record->timer;
+        hunter->evidenceCollected = record->evidenceCollected;
+        hunter->done = record->done;
+        hunter->rng.state = record->rng;
+        hunter->house = house;
+        hunter->id = i;
+        restoreEvidenceNodes(hunter->ghostEvidence, house, evidence + record->evidenceStart, record->evidenceCount);
+
+        appendHunterToList(house->hunters, hunter);
+    }
+
+    for (uint32_t i = 0; i < header->roomCount; i++) {
+        for (int o = 0; o < roomRecords[i].occupantCount; o++) {
+            assignHunterToRoom(&rooms[i], house->hunters->hunterList[roomRecords[i].occupants[o]]);
+        }
+    }
+
+    RoomType *ghostRoom = header->ghostRoom == SNAPSHOT_NO_ROOM ? &rooms[0] : &rooms[header->ghostRoom];
+    initializeGhost((GhostClassType)header->ghostType, ghostRoom, header->ghostRest, house->ghost);
+    house->ghost->boredomDuration = header->ghostBoredom;
+    house->ghost->rng.state = header->ghostRng;
+    house->ghost->house = house;
+    if (header->ghostLinked) {
+        ghostRoom->ghost = house->ghost;
+    }
+
+    return C_TRUE;
+}
@@ -0,0 +1,130 @@
+#include "defs.h"
+
+static const char *runStatNames[RUN_STATS] = {
+    "hunters win", "ghost wins", "undetermined", "agent steps", "wall ns", "hunter fear", "evidence"
+};
+
+/************************************************************************************************
+ * Function: void initRunStats(RunStatsType *stats)
+ * Description: This function empties a set of accumulators.
+ * Parameters:
+ *      - RunStatsType *stats: The accumulators.
+ * Return: None
+ ************************************************************************************************/
+void initRunStats(RunStatsType *stats) {
+    memset(stats, 0, sizeof(*stats));
+}
+
+/************************************************************************************************
+ * Function: void addSample(StatAccumulatorType *accumulator, double value)
+ * Description: This function adds one sample with Welford's update, which keeps the variance
+ *              accurate without summing squares.
+ * Parameters:
+ *      - StatAccumulatorType *accumulator: The accumulator.
+ *      - double value: The sample.
+ * Return: None
+ ************************************************************************************************/
+static void addSample(StatAccumulatorType *accumulator, double value) {
+    accumulator->count++;
+
+    double delta = value - accumulator->mean;
+    accumulator->mean += delta / (double)accumulator->count;
+    accumulator->m2 += delta * (value - accumulator->mean);
+
+    if (accumulator->count == 1 || value < accumulator->min) {
+        accumulator->min = value;
+    }
+    if (accumulator->count == 1 || value > accumulator->max) {
+        accumulator->max = value;
+    }
+}
+
+/************************************************************************************************
+ * Function: void addRunStats(RunStatsType *stats, HouseType *house, GameOutcomeType outcome, uint64_t wallNs)
+ * Description: This function adds a finished run: its outcome, the steps every agent took, its
+ *              wall time and the fear and evidence its hunters ended with.
+ * Parameters:
+ *      - RunStatsType *stats: The worker's accumulators.
+ *      - HouseType *house: The finished house.
+ *      - GameOutcomeType outcome: How the run ended.
+ *      - uint64_t wallNs: How long the run took.
+ * Return: None
+ ************************************************************************************************/
+void addRunStats(RunStatsType *stats, HouseType *house, GameOutcomeType outcome, uint64_t wallNs) {
+    HunterListType *hunters = house->hunters;
+    uint64_t steps = (uint64_t)house->ghost->steps;
+    int fear = 0;
+    int evidence = 0;
+
+    for (int i = 0; i < hunters->size; i++) {
+        steps += (uint64_t)hunters->hunterList[i]->steps;
+        fear += hunters->hunterList[i]->fear;
+        evidence += hunters->hunterList[i]->evidenceCollected;
+    }
+
+    addSample(&stats->metrics[RUN_STAT_HUNTERS_WIN], outcome == OUTCOME_HUNTERS_WIN);
+    addSample(&stats->metrics[RUN_STAT_GHOST_WIN], outcome == OUTCOME_GHOST_WIN);
+    addSample(&stats->metrics[RUN_STAT_UNDETERMINED], outcome == OUTCOME_UNDETERMINED);
+    addSample(&stats->metrics[RUN_STAT_STEPS], (double)steps);
+    addSample(&stats->metrics[RUN_STAT_WALL], (double)wallNs);
+    addSample(&stats->metrics[RUN_STAT_FEAR], fear);
+    addSample(&stats->metrics[RUN_STAT_EVIDENCE], evidence);
+}
+
+/************************************************************************************************
+ * Function: void mergeRunStats(RunStatsType *into, const RunStatsType *from)
+ * Description: This function adds another worker's accumulators with the pairwise update of
+ *              Chan et al., as if its runs had been added one by one. Workers only ever write
+ *              their own accumulators, and they are merged once the worker has finished, so no
+ *              lock is taken.
+ * Parameters:
+ *      - RunStatsType *into: The accumulators merged into.
+ *      - const RunStatsType *from: The worker's accumulators.
+ * Return: None
+ ************************************************************************************************/
+void mergeRunStats(RunStatsType *into, const RunStatsType *from) {
+    for (int kind = 0; kind < RUN_STATS; kind++) {
+        StatAccumulatorType *a = &into->metrics[kind];
+        const StatAccumulatorType *b = &from->metrics[kind];
+
+        if (b->count == 0) {
+            continue;
+        }
+        if (a->count == 0) {
+            *a = *b;
+            continue;
+        }
+
+        double count = (double)(a->count + b->count);
+        double delta = b->mean - a->mean;
+
+        a->mean += delta * (double)b->count / count;
+        a->m2 += b->m2 + delta * delta * (double)a->count * (double)b->count / count;
+        a->count += b->count;
+        a->min = (b->min < a->min) ? b->min : a->min;
+        a->max = (b->max > a->max) ? b->max : a->max;
+    }
+}
+
+/************************************************************************************************
+ * Function: void printRunStats(const RunStatsType *stats)
+ * Description: This function prints the count, mean, sample standard deviation, minimum and
+ *              maximum of every metric with samples.
+ * Parameters:
+ *      - const RunStatsType *stats: The merged accumulators.
+ * Return: None
+ ************************************************************************************************/
+void printRunStats(const RunStatsType *stats) {
+    printf("[STATS] %-14s %10s %14s %14s %14s %14s\n", "", "count", "mean", "stddev", "min", "max");
+    for (int kind = 0; kind < RUN_STATS; kind++) {
+        const StatAccumulatorType *accumulator = &stats->metrics[kind];
+
+        if (accumulator->count == 0) {
+            continue;
+        }
+
+        double variance = (accumulator->count > 1) ? accumulator->m2 / (double)(accumulator->count - 1) : 0.0;
+        printf("[STATS] %-14s %10llu %14.6g %14.6g %14.6g %14.6g\n", runStatNames[kind], (unsigned long long)accumulator->count,
+               accumulator->mean, sqrt(variance), accumulator->min, accumulator->max);
+    }
+}
@@ -0,0 +1,167 @@
+#include "defs.h"
+#include <sys/mman.h>
+#include <fcntl.h>
+
+TelemetryType *telemetry = NULL;
+_Thread_local TelemetryPendingType telemetryPending;
+
+static char telemetryName[MAX_NAME_LENGTH];
+
+/************************************************************************************************
+ * Function: int openTelemetry(const char *name)
+ * Description: This function creates the POSIX shared memory segment that live counters are
+ *              published to and maps it into the simulator. Until it is called every telemetry
+ *              update is a single NULL check.
+ * Parameters:
+ *      - const char *name: The segment name, e.g. "/phantom-pulse".
+ * Return: C_TRUE if the segment is mapped, C_FALSE otherwise.
+ ************************************************************************************************/
+int openTelemetry(const char *name) {
+    int fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("Failed to create telemetry segment");
+        return C_FALSE;
+    }
+
+    if (ftruncate(fd, sizeof(TelemetryType)) != 0) {
+        perror("Failed to size telemetry segment");
+        close(fd);
+        shm_unlink(name);
+        return C_FALSE;
+    }
+
+    void *segment = mmap(NULL, sizeof(TelemetryType), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (segment == MAP_FAILED) {
+        perror("Failed to map telemetry segment");
+        shm_unlink(name);
+        return C_FALSE;
+    }
+
+    telemetry = segment;
+    telemetry->pid = getpid();
+    telemetry->magic = TELEMETRY_MAGIC;
+
+    strncpy(telemetryName, name, sizeof(telemetryName) - 1);
+    return C_TRUE;
+}
+
+/************************************************************************************************
+ * Function: void closeTelemetry(void)
+ * Description: This function marks the segment as finished and unlinks its name. Viewers that
+ *              already mapped it keep seeing the final counters.
+ * Parameters: None
+ * Return: None
+ ************************************************************************************************/
+void closeTelemetry(void) {
+    if (telemetry == NULL) {
+        return;
+    }
+
+    atomic_store_explicit(&telemetry->finished, C_TRUE, memory_order_relaxed);
+    munmap(telemetry, sizeof(TelemetryType));
+    shm_unlink(telemetryName);
+    telemetry = NULL;
+}
+
+/************************************************************************************************
+ * Function: void telemetryBeginRun(HouseType *house)
+ * Description: This function publishes the names and starting state of the rooms and hunters of
+ *              a run that is about to start. Only the first TELEMETRY_MAX_ROOMS rooms and
+ *              MAX_HUNTERS hunters are shown.
+ * Parameters:
+ *      - HouseType *house: The house about to be played.
+ * Return: None
+ ************************************************************************************************/
+void telemetryBeginRun(HouseType *house) {
+    if (telemetry == NULL) {
+        return;
+    }
+
+    int roomCount = 0;
+    for (; roomCount < house->roomCount && roomCount < TELEMETRY_MAX_ROOMS; roomCount++) {
+        strncpy(telemetry->roomNames[roomCount], house->rooms[roomCount].topology->name, MAX_STR - 1);
+        telemetryRoom(&house->rooms[roomCount]);
+    }
+    TELEMETRY_SET(roomCount, roomCount);
+
+    int hunterCount = 0;
+    for (; hunterCount < house->hunters->size && hunterCount < MAX_HUNTERS; hunterCount++) {
+        strncpy(telemetry->hunterNames[hunterCount], house->hunters->hunterList[hunterCount]->name, MAX_STR - 1);
+        telemetryHunter(house->hunters->hunterList[hunterCount]);
+    }
+    TELEMETRY_SET(hunterCount, hunterCount);
+
+    TELEMETRY_SET(ghostBoredom, house->ghost->boredomDuration);
+    TELEMETRY_SET(ghostRoom, house->ghost->room->id);
+}
+
+/************************************************************************************************
+ * Function: void telemetryFlush(void)
+ * Description: This function publishes the step counters the calling thread has summed up since
+ *              its last flush. Agent threads call it when they stop.
+ * Parameters: None
+ * Return: None
+ ************************************************************************************************/
+void telemetryFlush(void) {
+    if (telemetry != NULL && telemetryPending.updates > 0) {
+        TELEMETRY_ADD(agentSteps, telemetryPending.agentSteps);
+        TELEMETRY_ADD(evidenceProduced, telemetryPending.evidenceProduced);
+        TELEMETRY_ADD(evidenceCollected, telemetryPending.evidenceCollected);
+        TELEMETRY_ADD(moves, telemetryPending.moves);
+        TELEMETRY_ADD(moveFailures, telemetryPending.moveFailures);
+    }
+
+    memset(&telemetryPending, 0, sizeof(telemetryPending));
+}
+
+/************************************************************************************************
+ * Function: void telemetryEndRun(GameOutcomeType outcome)
+ * Description: This function counts a finished run and its outcome, with whatever step counts
+ *              the calling thread has not published yet.
+ * Parameters:
+ *      - GameOutcomeType outcome: How the run ended.
+ * Return: None
+ ************************************************************************************************/
+void telemetryEndRun(GameOutcomeType outcome) {
+    telemetryFlush();
+    TELEMETRY_ADD(runsCompleted, 1);
+
+    if (outcome == OUTCOME_HUNTERS_WIN) {
+        TELEMETRY_ADD(runsHuntersWon, 1);
+    } else if (outcome == OUTCOME_GHOST_WIN) {
+        TELEMETRY_ADD(runsGhostWon, 1);
+    }
+}
+
+/************************************************************************************************
+ * Function: void telemetryHunter(HunterType *hunter)
+ * Description: This function publishes the current fear and boredom timer of a hunter.
+ * Parameters:
+ *      - HunterType *hunter: The hunter to publish.
+ * Return: None
+ ************************************************************************************************/
+void telemetryHunter(HunterType *hunter) {
+    if (telemetry == NULL || hunter->id >= MAX_HUNTERS) {
+        return;
+    }
+
+    TELEMETRY_SET(hunterFear[hunter->id], hunter->fear);
+    TELEMETRY_SET(hunterTimer[hunter->id], hunter->timer);
+}
+
+/************************************************************************************************
+ * Function: void telemetryRoom(RoomType *room)
+ * Description: This function publishes how many hunters are in a room.
+ * Parameters:
+ *      - RoomType *room: The room to publish.
+ * Return: None
+ ************************************************************************************************/
+void telemetryRoom(RoomType *room) {
+    if (telemetry == NULL || room->id >= TELEMETRY_MAX_ROOMS) {
+        return;
+    }
+
+    TELEMETRY_SET(roomOccupancy[room->id], room->hunterCount);
+}
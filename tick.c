@@ -0,0 +1,315 @@
+#include "defs.h"
+
+/* What an agent decided to do in a tick. Agents decide in parallel and each writes only its own
+   intent and its own private state (generator, step count, route, boredom); the house is not
+   written until the commit applies the intents. */
+typedef enum { TICK_NOTHING, TICK_GRAB, TICK_MOVE, TICK_REVIEW } TickActionType;
+
+typedef struct TickIntentType {
+    _Alignas(CACHE_LINE) TickActionType action;
+    RoomType *target;
+    EvidenceChannelNodeType *evidence;
+} TickIntentType;
+
+/* A house played in ticks. intents holds the hunters' by index and then the ghost's: the
+   decisions of the tick being played, while the house holds the state of the last one. */
+typedef struct TickEngineType {
+    HouseType *house;
+    TickIntentType *intents;
+    int agentCount;
+    int workerCount;
+    uint64_t tick;
+    int running;
+    int ghostActive;
+    pthread_barrier_t started;
+    pthread_barrier_t decided;
+} TickEngineType;
+
+typedef struct TickWorkerType {
+    TickEngineType *engine;
+    int id;
+} TickWorkerType;
+
+/************************************************************************************************
+ * Function: void decideHunter(HunterType *hunter, TickIntentType *intent)
+ * Description: This function makes a hunter's choice for the tick, as hunterStep would, from the
+ *              state the last tick left: it collects when evidence of its tool is there (60% of
+ *              the time), picks the room it moves to, or reviews evidence.
+ * Parameters:
+ *      - HunterType *hunter: The hunter, with its generator bound.
+ *      - TickIntentType *intent: Filled with its choice.
+ * Return: None
+ ************************************************************************************************/
+static void decideHunter(HunterType *hunter, TickIntentType *intent) {
+    hunter->steps++;
+
+    int action = randInt(0, 3);
+
+    if (action == 0) {
+        EvidenceChannelType *channel = &hunter->room->evidence[hunter->evidence];
+        if (atomic_load_explicit(&channel->count, memory_order_relaxed) > 0 && randInt(0, 100) < 60) {
+            intent->action = TICK_GRAB;
+        }
+    } else if (action == 1) {
+        intent->target = chooseHunterMove(hunter);
+        if (intent->target != hunter->room) {
+            intent->action = TICK_MOVE;
+        }
+    } else {
+        intent->action = TICK_REVIEW;
+    }
+}
+
+/************************************************************************************************
+ * Function: void decideGhost(GhostType *ghost, TickIntentType *intent)
+ * Description: This function makes the ghost's choice for the tick, as ghostStep would: with
+ *              hunters in its room it stays interested and may leave evidence, otherwise it
+ *              gets more bored and may move or leave evidence. The evidence is created here
+ *              and only left in the room by the commit.
+ * Parameters:
+ *      - GhostType *ghost: The ghost, with its generator bound.
+ *      - TickIntentType *intent: Filled with its choice.
+ * Return: None
+ ************************************************************************************************/
+static void decideGhost(GhostType *ghost, TickIntentType *intent) {
+    ghost->steps++;
+
+    if (isGhostHere(ghost)) {
+        int pickMove = randInt(0, 2);
+
+        ghost->boredomDuration = BOREDOM_MAX;
+        if (pickMove) {
+            intent->evidence = makeGhostEvidence(ghost);
+        }
+    } else {
+        int pickMove = randInt(0, 3);
+
+        ghost->boredomDuration--;
+        if (pickMove == 0) {
+            intent->target = chooseGhostMove(ghost);
+        } else if (pickMove == 1) {
+            intent->evidence = makeGhostEvidence(ghost);
+        }
+    }
+}
+
+/************************************************************************************************
+ * Function: void decideAgent(TickEngineType *engine, int agent)
+ * Description: This function clears an agent's intent and, if it still plays, lets it decide.
+ * Parameters:
+ *      - TickEngineType *engine: The engine.
+ *      - int agent: The hunter index, or the number of hunters for the ghost.
+ * Return: None
+ ************************************************************************************************/
+static void decideAgent(TickEngineType *engine, int agent) {
+    HunterListType *hunters = engine->house->hunters;
+    TickIntentType *intent = &engine->intents[agent];
+
+    intent->action = TICK_NOTHING;
+    intent->target = NULL;
+    intent->evidence = NULL;
+
+    if (agent < hunters->size) {
+        if (!hunters->hunterList[agent]->done) {
+            bindRng(&hunters->hunterList[agent]->rng);
+            decideHunter(hunters->hunterList[agent], intent);
+        }
+    } else if (engine->ghostActive) {
+        bindRng(&engine->house->ghost->rng);
+        decideGhost(engine->house->ghost, intent);
+    }
+}
+
+/************************************************************************************************
+ * Function: void commitHunter(HouseType *house, HunterType *hunter, TickIntentType *intent)
+ * Description: This function applies a hunter's intent to the house as it stands after the
+ *              agents committed before it: a room filled up meanwhile turns it away and
+ *              evidence already taken is not there to collect. Fear and boredom are then
+ *              updated and the hunter leaves the game if that was its last step.
+ * Parameters:
+ *      - HouseType *house: The house.
+ *      - HunterType *hunter: The hunter.
+ *      - TickIntentType *intent: What it decided.
+ * Return: None
+ ************************************************************************************************/
+static void commitHunter(HouseType *house, HunterType *hunter, TickIntentType *intent) {
+    bindRng(&hunter->rng);
+    enterCheckedTurn();
+
+    if (intent->action == TICK_GRAB) {
+        collectEvidence(hunter);
+    } else if (intent->action == TICK_MOVE) {
+        moveHunter(hunter, intent->target);
+    } else if (intent->action == TICK_REVIEW) {
+        lockRoom(hunter->room);
+        if (hunter->room->hunterCount > 1) {
+            verifyEvidence(hunter);
+        }
+        unlockRoom(hunter->room);
+    }
+
+    if (didHunterFindGhost(hunter)) {
+        hunter->fear++;
+        hunter->timer = BOREDOM_MAX;
+    }
+
+    TELEMETRY_COUNT(agentSteps, 1);
+    telemetryHunter(hunter);
+
+    if (!hunterKeepsHunting(hunter)) {
+        finishHunter(hunter);
+    }
+
+    leaveCheckedTurn(house, hunter->name);
+}
+
+/************************************************************************************************
+ * Function: void commitTick(TickEngineType *engine)
+ * Description: This function applies the intents of a tick on one thread in a fixed order:
+ *              the ghost first, then the hunters starting from a different one every tick so
+ *              no hunter always wins a full room or a contested piece of evidence. The order
+ *              depends only on the tick, so every run from the same seed plays the same,
+ *              whatever the number of workers.
+ * Parameters:
+ *      - TickEngineType *engine: The engine, with every intent decided.
+ * Return: None
+ ************************************************************************************************/
+static void commitTick(TickEngineType *engine) {
+    HouseType *house = engine->house;
+    HunterListType *hunters = house->hunters;
+    GhostType *ghost = house->ghost;
+    TickIntentType *ghostIntent = &engine->intents[hunters->size];
+
+    if (engine->ghostActive) {
+        bindRng(&ghost->rng);
+        enterCheckedTurn();
+
+        if (ghostIntent->target != NULL) {
+            placeGhost(ghost, ghostIntent->target);
+        }
+        if (ghostIntent->evidence != NULL) {
+            leaveGhostEvidence(ghost, ghostIntent->evidence);
+        }
+
+        TELEMETRY_COUNT(agentSteps, 1);
+        TELEMETRY_SET(ghostBoredom, ghost->boredomDuration);
+        leaveCheckedTurn(house, "the ghost");
+    }
+
+    int running = C_FALSE;
+    for (int k = 0; k < hunters->size; k++) {
+        int i = (int)((engine->tick + k) % hunters->size);
+        HunterType *hunter = hunters->hunterList[i];
+
+        if (!hunter->done) {
+            commitHunter(house, hunter, &engine->intents[i]);
+            running |= !hunter->done;
+        }
+    }
+
+    // The ghost's checkpoint is taken between ticks, when every agent is between steps
+    if (engine->ghostActive && gameOptions.checkpointPath != NULL && ghost->steps == gameOptions.checkpointAt) {
+        checkpointHouse(house, gameOptions.checkpointPath);
+    }
+
+    engine->ghostActive = engine->ghostActive && ghostKeepsHaunting(ghost);
+    engine->running = running || engine->ghostActive;
+    engine->tick++;
+    bindRng(NULL);
+}
+
+/************************************************************************************************
+ * Function: void *tickWorker(void *arg)
+ * Description: This function is the body of a tick worker: every tick it waits for the tick to
+ *              start, decides for its share of the agents (every workerCount-th one) and waits
+ *              for the others to finish deciding. Worker 0, the thread that called
+ *              runTickHouse, then commits the tick.
+ * Parameters:
+ *      - void *arg: The worker's TickWorkerType.
+ * Return: NULL
+ ************************************************************************************************/
+static void *tickWorker(void *arg) {
+    TickWorkerType *worker = arg;
+    TickEngineType *engine = worker->engine;
+
+    for (;;) {
+        pthread_barrier_wait(&engine->started);
+        if (!engine->running) {
+            break;
+        }
+
+        for (int agent = worker->id; agent < engine->agentCount; agent += engine->workerCount) {
+            decideAgent(engine, agent);
+        }
+        bindRng(NULL);
+
+        pthread_barrier_wait(&engine->decided);
+        if (worker->id == 0) {
+            commitTick(engine);
+        }
+    }
+
+    telemetryFlush();
+    latencyFlush();
+    releaseSearchScratch();
+    return NULL;
+}
+
+/************************************************************************************************
+ * Function: void runTickHouse(HouseType *house, int workerCount)
+ * Description: This function plays a house in bulk-synchronous ticks. In every tick all agents
+ *              decide in parallel on workerCount threads, reading only what the previous tick
+ *              left (the house is not written while they decide), and then the calling thread
+ *              commits their intents in a deterministic order, resolving full rooms and
+ *              evidence wanted twice. Every agent takes one step per tick; rests are not slept.
+ *              The game only depends on the seed, never on the scheduling of the threads.
+ * Parameters:
+ *      - HouseType *house: The house to play in.
+ *      - int workerCount: The number of threads deciding (capped at the number of agents).
+ * Return: None
+ ************************************************************************************************/
+void runTickHouse(HouseType *house, int workerCount) {
+    TickEngineType engine;
+    int agentCount = house->hunters->size + 1;
+
+    if (workerCount > agentCount) {
+        workerCount = agentCount;
+    }
+    if (workerCount < 1) {
+        workerCount = 1;
+    }
+
+    memset(&engine, 0, sizeof(engine));
+    engine.house = house;
+    engine.agentCount = agentCount;
+    engine.workerCount = workerCount;
+    engine.intents = arenaAlloc(house->arena, agentCount * sizeof(TickIntentType), CACHE_LINE);
+    engine.ghostActive = C_TRUE;
+    engine.running = C_TRUE;
+    pthread_barrier_init(&engine.started, NULL, workerCount);
+    pthread_barrier_init(&engine.decided, NULL, workerCount);
+
+    TickWorkerType *workers = arenaAlloc(house->arena, workerCount * sizeof(TickWorkerType), _Alignof(TickWorkerType));
+    pthread_t *threads = arenaAlloc(house->arena, workerCount * sizeof(pthread_t), _Alignof(pthread_t));
+
+    for (int w = 0; w < workerCount; w++) {
+        workers[w].engine = &engine;
+        workers[w].id = w;
+    }
+    // The barriers count every worker, so a missing one would leave the others waiting forever
+    for (int w = 1; w < workerCount; w++) {
+        if (createWorkerThread(&threads[w], w, tickWorker, &workers[w]) != 0) {
+            perror("Failed to start tick worker");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    tickWorker(&workers[0]);
+
+    for (int w = 1; w < workerCount; w++) {
+        pthread_join(threads[w], NULL);
+    }
+
+    pthread_barrier_destroy(&engine.started);
+    pthread_barrier_destroy(&engine.decided);
+}
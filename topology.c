@@ -0,0 +1,251 @@
+#include "defs.h"
+#include <dirent.h>
+#include <sched.h>
+#include <sys/syscall.h>
+
+#ifndef MPOL_DEFAULT
+#define MPOL_DEFAULT   0
+#define MPOL_PREFERRED 1
+#endif
+#ifndef MPOL_MF_MOVE
+#define MPOL_MF_MOVE   (1 << 1)
+#endif
+
+#define TOPOLOGY_MAX_NODES 64
+
+/* The CPUs this process may run on, in the order workers are placed on them, and their nodes. */
+typedef struct TopologyType {
+    int cpuCount;
+    int nodeCount;
+    int *cpus;
+    int *cpuNodes;
+} TopologyType;
+
+static TopologyType topology;
+static int processPlaced = C_FALSE;
+
+/************************************************************************************************
+ * Function: int readCpuNode(int cpu)
+ * Description: This function finds the NUMA node of a CPU from the nodeN entry sysfs keeps in
+ *              the CPU's directory.
+ * Parameters:
+ *      - int cpu: The CPU.
+ * Return: The node, or 0 when the kernel does not say (no NUMA).
+ ************************************************************************************************/
+static int readCpuNode(int cpu) {
+    char path[MAX_STR];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        return 0;
+    }
+
+    int node = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9') {
+            node = (int)strtol(entry->d_name + 4, NULL, 10);
+            break;
+        }
+    }
+
+    closedir(dir);
+    return (node >= 0 && node < TOPOLOGY_MAX_NODES) ? node : 0;
+}
+
+/************************************************************************************************
+ * Function: int loadTopology(PinModeType mode)
+ * Description: This function lists the CPUs the process is allowed to run on with their NUMA
+ *              nodes and orders them for placing workers: compact fills one node before the
+ *              next, spread deals workers out across the nodes in turn.
+ * Parameters:
+ *      - PinModeType mode: PIN_COMPACT or PIN_SPREAD.
+ * Return: C_TRUE on success, C_FALSE if the CPUs could not be read.
+ ************************************************************************************************/
+int loadTopology(PinModeType mode) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        perror("Failed to read CPU affinity");
+        return C_FALSE;
+    }
+
+    int count = CPU_COUNT(&allowed);
+    int *cpus = malloc(count * sizeof(int));
+    int *nodes = malloc(count * sizeof(int));
+    topology.cpus = malloc(count * sizeof(int));
+    topology.cpuNodes = malloc(count * sizeof(int));
+
+    if (cpus == NULL || nodes == NULL || topology.cpus == NULL || topology.cpuNodes == NULL) {
+        perror("Failed to allocate topology");
+        exit(EXIT_FAILURE);
+    }
+
+    int perNode[TOPOLOGY_MAX_NODES] = {0};
+    int found = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE && found < count; cpu++) {
+        if (CPU_ISSET(cpu, &allowed)) {
+            cpus[found] = cpu;
+            nodes[found] = readCpuNode(cpu);
+            perNode[nodes[found]]++;
+            found++;
+        }
+    }
+
+    topology.cpuCount = found;
+    topology.nodeCount = 0;
+    for (int node = 0; node < TOPOLOGY_MAX_NODES; node++) {
+        topology.nodeCount += perNode[node] > 0;
+    }
+
+    // Both orders take each node's CPUs in ascending order; spread takes one per node per round
+    int placed = 0;
+    int taken[TOPOLOGY_MAX_NODES] = {0};
+    while (placed < found) {
+        for (int node = 0; node < TOPOLOGY_MAX_NODES; node++) {
+            int want = (mode == PIN_SPREAD) ? 1 : perNode[node];
+
+            for (int i = 0; i < found && want > 0; i++) {
+                if (nodes[i] != node || i < taken[node]) {
+                    continue;
+                }
+                topology.cpus[placed] = cpus[i];
+                topology.cpuNodes[placed] = node;
+                taken[node] = i + 1;
+                placed++;
+                want--;
+            }
+        }
+    }
+
+    free(cpus);
+    free(nodes);
+    return C_TRUE;
+}
+
+/************************************************************************************************
+ * Function: void printTopology(void)
+ * Description: This function reports the CPUs and nodes workers are placed on, in placement
+ *              order, and whether their memory follows them.
+ * Parameters: None
+ * Return: None
+ ************************************************************************************************/
+void printTopology(void) {
+    printf("[TOPOLOGY] %d CPUs on %d NUMA nodes, workers pinned %s, memory %s\n", topology.cpuCount, topology.nodeCount,
+           (gameOptions.pinMode == PIN_SPREAD) ? "spread across nodes" : "compact",
+           gameOptions.numa ? "on the worker's node" : "wherever it is first touched");
+    printf("[TOPOLOGY] worker order:");
+    for (int i = 0; i < topology.cpuCount; i++) {
+        printf(" %d(n%d)", topology.cpus[i], topology.cpuNodes[i]);
+    }
+    printf("\n");
+}
+
+/************************************************************************************************
+ * Function: int workerNode(int worker)
+ * Description: This function gives the NUMA node a worker is placed on.
+ * Parameters:
+ *      - int worker: The worker number.
+ * Return: The node, or -1 when workers are not placed.
+ ************************************************************************************************/
+int workerNode(int worker) {
+    if (topology.cpuCount == 0) {
+        return -1;
+    }
+    return topology.cpuNodes[worker % topology.cpuCount];
+}
+
+/************************************************************************************************
+ * Function: void setWorkerMemoryPolicy(int node)
+ * Description: This function makes the calling thread allocate from the given node (falling
+ *              back to others when it is full), or restores the default policy. Threads and
+ *              processes it creates afterwards inherit the policy.
+ * Parameters:
+ *      - int node: The node, or -1 for the default policy.
+ * Return: None
+ ************************************************************************************************/
+static void setWorkerMemoryPolicy(int node) {
+    if (!gameOptions.numa) {
+        return;
+    }
+
+    unsigned long mask = (node >= 0) ? 1UL << node : 0;
+    syscall(SYS_set_mempolicy, (node >= 0) ? MPOL_PREFERRED : MPOL_DEFAULT, (node >= 0) ? &mask : NULL,
+            (node >= 0) ? (unsigned long)TOPOLOGY_MAX_NODES : 0UL);
+}
+
+/************************************************************************************************
+ * Function: void placeCurrentWorker(int worker)
+ * Description: This function pins the calling thread to its worker's CPU and, with --numa, makes
+ *              it allocate on that CPU's node. Forked workers call it before building anything;
+ *              the threads they start afterwards inherit the placement instead of taking CPUs
+ *              of their own.
+ * Parameters:
+ *      - int worker: The worker number.
+ * Return: None
+ ************************************************************************************************/
+void placeCurrentWorker(int worker) {
+    if (topology.cpuCount == 0) {
+        return;
+    }
+
+    cpu_set_t cpu;
+    CPU_ZERO(&cpu);
+    CPU_SET(topology.cpus[worker % topology.cpuCount], &cpu);
+    sched_setaffinity(0, sizeof(cpu), &cpu);
+    setWorkerMemoryPolicy(workerNode(worker));
+    processPlaced = C_TRUE;
+}
+
+/************************************************************************************************
+ * Function: int createWorkerThread(pthread_t *thread, int worker, void *(*body)(void *), void *arg)
+ * Description: This function starts a worker thread. With --pin it is created pinned to its
+ *              CPU; with --numa it inherits a preferred-node policy for its node, set on the
+ *              calling thread just for the creation, so even its first allocation is local.
+ * Parameters:
+ *      - pthread_t *thread: Receives the thread.
+ *      - int worker: The worker number, which picks the CPU.
+ *      - void *(*body)(void *): The thread body.
+ *      - void *arg: Its argument.
+ * Return: The pthread_create result.
+ ************************************************************************************************/
+int createWorkerThread(pthread_t *thread, int worker, void *(*body)(void *), void *arg) {
+    if (topology.cpuCount == 0 || processPlaced) {
+        return pthread_create(thread, NULL, body, arg);
+    }
+
+    pthread_attr_t attributes;
+    cpu_set_t cpu;
+
+    CPU_ZERO(&cpu);
+    CPU_SET(topology.cpus[worker % topology.cpuCount], &cpu);
+    pthread_attr_init(&attributes);
+    pthread_attr_setaffinity_np(&attributes, sizeof(cpu), &cpu);
+
+    setWorkerMemoryPolicy(workerNode(worker));
+    int created = pthread_create(thread, &attributes, body, arg);
+    setWorkerMemoryPolicy(-1);
+
+    pthread_attr_destroy(&attributes);
+    return created;
+}
+
+/************************************************************************************************
+ * Function: void bindToWorkerNode(void *memory, size_t size, int worker)
+ * Description: This function moves a page-aligned mapping a worker reads most (e.g. its inbox)
+ *              to the worker's node. It does nothing without --numa.
+ * Parameters:
+ *      - void *memory: The mapping.
+ *      - size_t size: Its size.
+ *      - int worker: The worker number.
+ * Return: None
+ ************************************************************************************************/
+void bindToWorkerNode(void *memory, size_t size, int worker) {
+    int node = workerNode(worker);
+    if (!gameOptions.numa || node < 0) {
+        return;
+    }
+
+    unsigned long mask = 1UL << node;
+    syscall(SYS_mbind, memory, size, MPOL_PREFERRED, &mask, (unsigned long)TOPOLOGY_MAX_NODES, MPOL_MF_MOVE);
+}
@@ -3,21 +3,19 @@
 /************************************************************************************************
  * Function: const char* evidenceTypeToString(EvidenceClassType evidence)
  * Description: This function converts an EvidenceClassType enum value to a corresponding string.
- *              It uses a static array of strings and checks the validity of the input before
- *              returning the corresponding string.
+ *              It checks the validity of the input before returning the name from the evidence
+ *              registry.
  * Parameters:
  *      - EvidenceClassType evidence: The evidence type to be converted to a string.
  * Return: const char* - Pointer to the string representation of the evidence type.
  * CHATGPT ACCESSED DECEMBER 2ND 2023
  ************************************************************************************************/
 const char* evidenceTypeToString(EvidenceClassType evidence) {
-    const char* evidenceStrings[] = {"EMF", "TEMPERATURE", "FINGERPRINTS", "SOUND", "INVALID"};
-    
-    if (evidence >= 0 && evidence < sizeof(evidenceStrings) / sizeof(evidenceStrings[0])) {
-        return evidenceStrings[evidence];
+    if (evidence >= 0 && evidence < EVIDENCE_TYPES) {
+        return evidenceRegistry[evidence].name;
     }
 
-    return evidenceStrings[sizeof(evidenceStrings) / sizeof(evidenceStrings[0]) - 1];  // Default to "INVALID"
+    return "INVALID";
 }
 
 /************************************************************************************************
@@ -45,24 +43,91 @@ void evidenceToString(EvidenceClassType type, char* str) {
 /************************************************************************************************
  * Function: const char* ghostTypeToString(GhostClassType ghost)
  * Description: This function converts a GhostClassType enum value to a corresponding string
- *              and returns the result. It uses a static array of strings and checks the
- *              validity of the input before returning the string.
+ *              and returns the result. It checks the validity of the input before returning
+ *              the name from the ghost registry.
  * Parameters:
  *      - GhostClassType ghost: The ghost type to be converted to a string.
  * Return: const char*: The string representation of the ghost type.
  * CHATGPT ACCESSED DECEMBER 2ND 2023
  ************************************************************************************************/
 const char* ghostTypeToString(GhostClassType ghost) {
-    const char* ghostStrings[] = {"POLTERGEIST", "BANSHEE", "BULLIES", "PHANTOM"};
-
-    if (ghost >= 0 && ghost < sizeof(ghostStrings) / sizeof(ghostStrings[0])) {
-        return ghostStrings[ghost];
+    if (ghost >= 0 && ghost < GHOST_TYPES) {
+        return ghostRegistry[ghost].name;
     } else {
         return "UNKNOWN";
     }
 }
 
 
+static _Thread_local RngType fallbackRng = { 0x9E3779B97F4A7C15ULL };
+static _Thread_local RngType *boundRng = NULL;
+static _Thread_local uint64_t drawCount = 0;
+
+/************************************************************************************************
+ * Function: void seedRng(RngType *rng, uint64_t seed)
+ * Description: This function seeds a generator with a splitmix64 scramble of the given seed so
+ *              that nearby seeds (seed, seed + 1, ...) still produce unrelated streams. The state
+ *              is never left at zero, which xorshift cannot escape from.
+ * Parameters:
+ *      - RngType *rng: The generator to seed.
+ *      - uint64_t seed: The seed value.
+ * Return: None
+ ************************************************************************************************/
+void seedRng(RngType *rng, uint64_t seed) {
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+
+    rng->state = z ? z : 0x9E3779B97F4A7C15ULL;
+}
+
+/************************************************************************************************
+ * Function: void bindRng(RngType *rng)
+ * Description: This function makes the given generator the source of randInt/randFloat for the
+ *              calling thread. Agents bind their own generator when their thread starts, so each
+ *              agent's draws are independent of the others and can be saved in a snapshot.
+ *              Passing NULL returns the thread to its private fallback generator.
+ * Parameters:
+ *      - RngType *rng: The generator to bind, or NULL.
+ * Return: None
+ ************************************************************************************************/
+void bindRng(RngType *rng) {
+    boundRng = rng;
+}
+
+/************************************************************************************************
+ * Function: uint64_t nextRandom(void)
+ * Description: This function advances the calling thread's bound generator (xorshift64*) and
+ *              returns the next 64-bit value.
+ * Parameters: None
+ * Return: uint64_t: The next random value.
+ ************************************************************************************************/
+uint64_t nextRandom(void) {
+    RngType *rng = boundRng ? boundRng : &fallbackRng;
+    uint64_t x = rng->state;
+
+    drawCount++;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    rng->state = x;
+
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+/************************************************************************************************
+ * Function: uint64_t randomDraws(void)
+ * Description: This function counts the random numbers drawn on the calling thread so far, from
+ *              whichever generator was bound. Record/replay compares it turn by turn.
+ * Parameters: None
+ * Return: uint64_t: The number of draws.
+ ************************************************************************************************/
+uint64_t randomDraws(void) {
+    return drawCount;
+}
+
+
 /************************************************************************************************
  * Function: int randInt(int min, int max)
  * Description: This function generates a random integer in the range [min, max).
@@ -73,7 +138,7 @@ const char* ghostTypeToString(GhostClassType ghost) {
  * CHATGPT ACCESSED DECEMBER 2ND 2023
  ************************************************************************************************/
 int randInt(int min, int max) {
-    return rand() % (max - min) + min;
+    return (int)(nextRandom() % (uint64_t)(max - min)) + min;
 }
 
 
@@ -87,7 +152,7 @@ int randInt(int min, int max) {
  * CHATGPT ACCESSED DECEMBER 2ND 2023
  ************************************************************************************************/
 float randFloat(float a, float b) {
-    return ((float)rand()) / (float)RAND_MAX * (b - a) + a;
+    return (float)(nextRandom() >> 40) / (float)(1 << 24) * (b - a) + a;
 }
 
 